@@ -45,6 +45,7 @@ struct KeyboardInput : public QObject
     }
 
     bool toggle_show_eye_tracking_point() { return get_key_press(Qt::Key_E); }
+    bool toggle_frame_timing() { return get_key_press(Qt::Key_F); }
 
 
 protected:
@@ -1,19 +1,22 @@
 #ifndef OSCSENDER_H
 #define OSCSENDER_H
 
+#include <QDebug>
+
 #include <osc/OscOutboundPacketStream.h>
 #include <ip/UdpSocket.h>
 
+// sends from the gui and the simulation thread (every message is packed in its own buffer)
 class OSCSender {
 public:
     OSCSender()
         : transmitSocket(IpEndpointName( "127.0.0.1", 57120))
-        , buffer(1024)
     { }
     void send_float(const char* msg, double val)
     {
         //qDebug() << "osc:" << msg << val;
-        osc::OutboundPacketStream p(&buffer[0], buffer.size());
+        char buffer[1024];
+        osc::OutboundPacketStream p(buffer, sizeof(buffer));
         p << osc::BeginBundleImmediate
             << osc::BeginMessage( msg )
                 << val << osc::EndMessage
@@ -27,7 +30,6 @@ public:
 
 protected:
     UdpTransmitSocket transmitSocket;
-    std::vector<char> buffer;
 };
 
 #endif // OSCSENDER_H
@@ -0,0 +1,96 @@
+#include <QElapsedTimer>
+#include <stdio.h>
+#include "car.h"
+
+// drives a fixed input schedule (as a replay does) for 60 s with frames of 16/17 ms (misc::TimeDelta)
+// and compares every scheme/rate against RK4 at 20 kHz
+
+namespace {
+
+const qreal duration = 60; // [s]
+
+struct Result {
+    qreal distance = 0; // [m]
+    qreal liters = 0; // [L]
+    QVector<qreal> kmh; // at the end of every frame
+    qreal ns_per_second = 0; // cost per simulated second
+};
+
+// input of the scripted driver at time t
+void drive(Car& car, const qreal t)
+{
+    car.throttle = t < 40 ? 0.8 : (t < 44 ? 0 : 0.3);
+    car.braking = t >= 40 && t < 44 ? 0.5 : 0;
+    const int gear = t < 2 ? 0 : (t < 5 ? 1 : (t < 9 ? 2 : (t < 14 ? 3 : (t < 45 ? 4 : 3))));
+    if (gear != car.gearbox.get_gear())
+        car.gearbox.set_gear(gear);
+}
+
+// same as SimulationCore::step without the track
+void step(Car& car, const qreal h, const qreal t, const Integrator::Scheme scheme, Result& r)
+{
+    car.gearbox.auto_clutch_control(&car);
+    const qreal alpha = 0.03 * sin(t / 10); // some hills [rad]
+    car.tick(h, alpha, scheme);
+    r.liters += car.engine.get_consumption_L_s() * h;
+    r.distance += car.speed * h;
+}
+
+Result run(const Integrator& integrator)
+{
+    Car car(nullptr);
+    car.reset(false);
+    Result r;
+    QElapsedTimer timer;
+    timer.start();
+    qreal t = 0;
+    qreal accumulator = 0;
+    for (int frame = 0; t < duration; frame++) {
+        const qreal dt = frame % 3 ? 0.017 : 0.016;
+        drive(car, t);
+        if (!integrator.fixed_step)
+            step(car, dt, t, integrator.scheme, r);
+        else {
+            const qreal h = integrator.step();
+            accumulator += dt;
+            for (qreal ts = t; accumulator >= h; accumulator -= h, ts += h)
+                step(car, h, ts, integrator.scheme, r);
+        }
+        t += dt;
+        r.kmh.append(Gearbox::speed2kmh(car.speed));
+    }
+    r.ns_per_second = timer.nsecsElapsed() / duration;
+    return r;
+}
+
+Integrator make(const Integrator::Scheme scheme, const qreal rate)
+{
+    Integrator i;
+    i.scheme = scheme;
+    i.rate = rate;
+    return i;
+}
+
+void compare(const char* name, const Integrator& integrator, const Result& reference)
+{
+    const Result r = run(integrator);
+    qreal max_kmh_error = 0;
+    for (int i = 0; i < r.kmh.size() && i < reference.kmh.size(); i++)
+        max_kmh_error = std::max(max_kmh_error, fabs(r.kmh[i] - reference.kmh[i]));
+    printf("%-18s %6.0f Hz | distance %+8.3f m | liters %+7.3f %% | max speed error %7.4f km/h | %8.1f us per simulated s\n",
+           name, integrator.fixed_step ? integrator.rate : 0, r.distance - reference.distance,
+           (r.liters / reference.liters - 1) * 100, max_kmh_error, r.ns_per_second / 1000);
+}
+
+} // namespace
+
+int main()
+{
+    const Result reference = run(make(Integrator::RK4, 20000));
+    printf("reference: RK4 at 20 kHz, distance %.2f m, %.4f L\n", reference.distance, reference.liters);
+    compare("legacy (per frame)", Integrator::legacy(), reference);
+    for (const Integrator::Scheme scheme : { Integrator::SemiImplicitEuler, Integrator::RK4 })
+        for (const qreal rate : { 100., 250., 1000., 4000. })
+            compare(Integrator::scheme_name(scheme), make(scheme, rate), reference);
+    return 0;
+}
@@ -0,0 +1,13 @@
+# Accuracy vs. cost of the physics integration schemes (see integrator.h)
+# build: qmake integrator_benchmark.pro && make && ./integrator_benchmark
+
+QT       += core gui svg
+
+TARGET = integrator_benchmark
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../simulation_core.pri)
+
+SOURCES += integrator_benchmark.cpp
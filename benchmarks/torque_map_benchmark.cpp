@@ -0,0 +1,66 @@
+#include <QElapsedTimer>
+#include <random>
+#include <stdio.h>
+#include "torque_map.h"
+
+// throttle & rpm samples similar to a drive (rpm may leave 0..1)
+static void make_samples(QVector<qreal>& throttle, QVector<qreal>& rpm, const int n)
+{
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<qreal> throttle_dist(0, 1);
+    std::uniform_real_distribution<qreal> rpm_dist(-0.05, 1.05);
+    throttle.resize(n);
+    rpm.resize(n);
+    for (int i = 0; i < n; i++) {
+        throttle[i] = throttle_dist(rng);
+        rpm[i] = rpm_dist(rng);
+    }
+}
+
+// returns max. abs. difference between grid and ramps
+static qreal max_error(const TorqueMap& tm, const QVector<qreal>& throttle, const QVector<qreal>& rpm)
+{
+    qreal err = 0;
+    for (int i = 0; i < throttle.size(); i++)
+        err = std::max(err, fabs(tm.get_torque(throttle[i], rpm[i]) - tm.get_torque_ramps(throttle[i], rpm[i])));
+    return err;
+}
+
+template <typename F>
+static qreal time_ns(F f, const QVector<qreal>& throttle, const QVector<qreal>& rpm, const int repetitions, qreal& sum)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int r = 0; r < repetitions; r++)
+        for (int i = 0; i < throttle.size(); i++)
+            sum += f(throttle[i], rpm[i]);
+    return qreal(timer.nsecsElapsed()) / (repetitions * throttle.size());
+}
+
+int main()
+{
+    const int n = 1 << 16;
+    const int repetitions = 50;
+    QVector<qreal> throttle, rpm;
+    make_samples(throttle, rpm, n);
+
+    TorqueMap tm;
+    printf("default ramps, grid %d x %d: max error %.3g\n", tm.resolution_throttle(), tm.resolution_rpm(), max_error(tm, throttle, rpm));
+
+    // knots not on grid lines
+    QList<TorqueMap::TorqueRamp> ramps = tm.get_torque_ramps();
+    ramps[0].throttle = 0.37;
+    ramps[0].rpm2torque[1].rx() = 0.233;
+    ramps[1].rpm2torque[3].rx() = 0.777;
+    TorqueMap tm_odd;
+    tm_odd.set_torque_ramps(ramps);
+    printf("shifted knots, grid %d x %d: max error %.3g\n", tm_odd.resolution_throttle(), tm_odd.resolution_rpm(), max_error(tm_odd, throttle, rpm));
+    tm_odd.set_resolution(101, 401);
+    printf("shifted knots, grid %d x %d: max error %.3g\n", tm_odd.resolution_throttle(), tm_odd.resolution_rpm(), max_error(tm_odd, throttle, rpm));
+
+    qreal sum = 0; // keeps the compiler from dropping the loops
+    const qreal t_ramps = time_ns([&tm](qreal t, qreal r) { return tm.get_torque_ramps(t, r); }, throttle, rpm, repetitions, sum);
+    const qreal t_grid = time_ns([&tm](qreal t, qreal r) { return tm.get_torque(t, r); }, throttle, rpm, repetitions, sum);
+    printf("ramps: %.2f ns/lookup, grid: %.2f ns/lookup, speedup: %.1fx (%g)\n", t_ramps, t_grid, t_ramps / t_grid, sum);
+    return 0;
+}
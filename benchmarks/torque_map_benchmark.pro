@@ -0,0 +1,16 @@
+# Benchmark of the baked TorqueMap grid vs. the piecewise linear ramp scan
+# build: qmake torque_map_benchmark.pro && make && ./torque_map_benchmark
+
+QT       += core
+QT       -= gui
+
+TARGET = torque_map_benchmark
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += torque_map_benchmark.cpp
+
+HEADERS += ../torque_map.h
@@ -0,0 +1,131 @@
+#include <QElapsedTimer>
+#include <QVector>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "vehicle_batch.h"
+
+// drives N vehicles for 60 s at 1 kHz (as SimulationCore::step does with a started track, without the track),
+// once as N Cars with Car::tick and once as one VehicleBatch, and checks that the trajectories agree.
+// they aren't identical: the batch takes the engine braking from a table and sin/cos from a polynomial
+
+namespace {
+
+const int n = 256; // vehicles
+const qreal duration = 60; // [s]
+const qreal h = 0.001; // [s]
+const qreal max_speed_deviation = 1e-3; // [m/s]
+const qreal max_liters_deviation = 1e-4; // relative
+
+struct Result {
+    QVector<qreal> speed; // every 100th step, per vehicle
+    QVector<qreal> liters; // per vehicle
+    qreal ns_per_vehicle_second = 0; // cost per vehicle and simulated second
+};
+
+// input of the scripted driver of vehicle i at time t (every vehicle with its own phase)
+struct Input {
+    qreal throttle, braking, alpha;
+    int gear;
+};
+
+Input drive(const int i, qreal t)
+{
+    const qreal phase = i * 0.37;
+    t = fmod(t + phase, duration);
+    Input in;
+    in.throttle = t < 40 ? 0.5 + 0.4 * sin(t + i) : (t < 44 ? 0 : 0.3);
+    in.braking = t >= 40 && t < 44 ? 0.5 : 0;
+    in.gear = t < 2 ? 0 : (t < 5 ? 1 : (t < 9 ? 2 : (t < 14 ? 3 : (t < 45 ? 4 : 3))));
+    in.alpha = 0.05 * sin(t / 10 + phase); // some hills [rad]
+    return in;
+}
+
+Result run_cars()
+{
+    Result r;
+    QVector<Car*> cars;
+    for (int i = 0; i < n; i++) {
+        cars.append(new Car(nullptr));
+        cars.last()->reset(false);
+    }
+    r.liters.fill(0, n);
+    QVector<qreal> alpha(n, 0);
+    QElapsedTimer timer;
+    timer.start();
+    const int steps = (int) (duration / h);
+    for (int s = 0; s < steps; s++) {
+        const qreal t = s * h;
+        for (int i = 0; i < n; i++) {
+            Car& car = *cars[i];
+            if (s % 16 == 0) { // input changes per frame
+                const Input in = drive(i, t);
+                car.throttle = in.throttle;
+                car.braking = in.braking;
+                alpha[i] = in.alpha;
+                if (in.gear != car.gearbox.get_gear())
+                    car.gearbox.set_gear(in.gear);
+            }
+            car.gearbox.auto_clutch_control(&car);
+            car.tick(h, alpha[i]);
+            r.liters[i] += car.engine.get_consumption_L_s() * h;
+            if (s % 100 == 0)
+                r.speed.append(car.speed);
+        }
+    }
+    r.ns_per_vehicle_second = timer.nsecsElapsed() / duration / n;
+    qDeleteAll(cars);
+    return r;
+}
+
+Result run_batch()
+{
+    Result r;
+    Car prototype(nullptr);
+    VehicleBatch batch(prototype, n);
+    batch.reset();
+    QElapsedTimer timer;
+    timer.start();
+    const int steps = (int) (duration / h);
+    for (int s = 0; s < steps; s++) {
+        const qreal t = s * h;
+        if (s % 16 == 0) {
+            for (int i = 0; i < n; i++) {
+                const Input in = drive(i, t);
+                batch.throttle[i] = in.throttle;
+                batch.braking[i] = in.braking;
+                batch.alpha[i] = in.alpha;
+                batch.set_gear(i, in.gear);
+            }
+        }
+        batch.tick(h);
+        if (s % 100 == 0)
+            for (int i = 0; i < n; i++)
+                r.speed.append(batch.speed[i]);
+    }
+    r.ns_per_vehicle_second = timer.nsecsElapsed() / duration / n;
+    for (int i = 0; i < n; i++)
+        r.liters.append(batch.liters_used[i]);
+    return r;
+}
+
+} // namespace
+
+int main()
+{
+    const Result cars = run_cars();
+    const Result batch = run_batch();
+    qreal speed_deviation = 0, liters_deviation = 0;
+    for (int i = 0; i < cars.speed.size(); i++)
+        speed_deviation = std::max(speed_deviation, fabs(cars.speed[i] - batch.speed[i]));
+    for (int i = 0; i < n; i++)
+        liters_deviation = std::max(liters_deviation, fabs(cars.liters[i] - batch.liters[i]) / std::max(cars.liters[i], 1e-9));
+    const bool equivalent = speed_deviation <= max_speed_deviation && liters_deviation <= max_liters_deviation;
+    printf("%d vehicles, %.0f s at %.0f Hz\n", n, duration, 1 / h);
+    printf("Car::tick     %8.2f us per vehicle and simulated s\n", cars.ns_per_vehicle_second / 1000);
+    printf("VehicleBatch  %8.2f us per vehicle and simulated s\n", batch.ns_per_vehicle_second / 1000);
+    printf("speedup: %.2fx\n", cars.ns_per_vehicle_second / batch.ns_per_vehicle_second);
+    printf("max deviation: speed %.2e m/s (<= %.0e), liters %.2e (<= %.0e): %s\n", speed_deviation, max_speed_deviation,
+           liters_deviation, max_liters_deviation, equivalent ? "equivalent" : "DIFFERENT");
+    return equivalent ? 0 : 1;
+}
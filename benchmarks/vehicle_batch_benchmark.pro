@@ -0,0 +1,13 @@
+# N Cars with Car::tick vs. one VehicleBatch of N vehicles (see vehicle_batch.h): speed and equivalence
+# build: qmake vehicle_batch_benchmark.pro && make && ./vehicle_batch_benchmark (CONFIG+=avx2 for the AVX2 kernels)
+
+QT       += core gui svg
+
+TARGET = vehicle_batch_benchmark
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../simulation_core.pri)
+
+SOURCES += vehicle_batch_benchmark.cpp
@@ -0,0 +1,81 @@
+#include <QElapsedTimer>
+#include <stdio.h>
+#include "vehicle_spec.h"
+
+// drives a fixed input schedule for 60 s at 1 kHz (as SimulationCore::step does, without the track),
+// once with Car::tick and once with the specialization of VehicleRegistry, and checks that both are identical
+
+namespace {
+
+const qreal duration = 60; // [s]
+const qreal h = 0.001; // [s]
+const int repetitions = 50;
+
+struct Result {
+    QVector<qreal> speed; // every step
+    qreal liters = 0;
+    qreal ns_per_second = 0; // cost per simulated second
+};
+
+// input of the scripted driver at time t
+void drive(Car& car, const qreal t)
+{
+    car.throttle = t < 40 ? 0.8 : (t < 44 ? 0 : 0.3);
+    car.braking = t >= 40 && t < 44 ? 0.5 : 0;
+    const int gear = t < 2 ? 0 : (t < 5 ? 1 : (t < 9 ? 2 : (t < 14 ? 3 : (t < 45 ? 4 : 3))));
+    if (gear != car.gearbox.get_gear())
+        car.gearbox.set_gear(gear);
+}
+
+Result run(const VehicleKernel* kernel)
+{
+    Result r;
+    QElapsedTimer timer;
+    timer.start();
+    for (int rep = 0; rep < repetitions; rep++) {
+        Car car(nullptr);
+        car.reset(false);
+        r.liters = 0;
+        r.speed.clear();
+        const int steps = (int) (duration / h);
+        for (int i = 0; i < steps; i++) {
+            const qreal t = i * h;
+            if (i % 16 == 0) // input changes per frame
+                drive(car, t);
+            car.gearbox.auto_clutch_control(&car);
+            const qreal alpha = 0.03 * sin(t / 10); // some hills [rad]
+            if (kernel) {
+                kernel->tick(car, h, alpha);
+                r.liters += kernel->consumption_L_s(car.engine) * h;
+            } else {
+                car.tick(h, alpha);
+                r.liters += car.engine.get_consumption_L_s() * h;
+            }
+            r.speed.append(car.speed);
+        }
+    }
+    r.ns_per_second = timer.nsecsElapsed() / duration / repetitions;
+    return r;
+}
+
+} // namespace
+
+int main()
+{
+    Car car(nullptr);
+    std::unique_ptr<VehicleKernel> kernel = VehicleRegistry::create(car);
+    if (!kernel) {
+        printf("no specialization fits the default car\n");
+        return 1;
+    }
+    const Result generic = run(nullptr);
+    const Result specialized = run(kernel.get());
+    int mismatches = 0;
+    for (int i = 0; i < generic.speed.size(); i++)
+        mismatches += generic.speed[i] != specialized.speed[i];
+    printf("Car::tick         %8.1f us per simulated s | %.6f L\n", generic.ns_per_second / 1000, generic.liters);
+    printf("%-17s %8.1f us per simulated s | %.6f L | %d of %d steps differ\n", kernel->name(),
+           specialized.ns_per_second / 1000, specialized.liters, mismatches, generic.speed.size());
+    printf("speedup: %.2fx\n", generic.ns_per_second / specialized.ns_per_second);
+    return mismatches ? 1 : 0;
+}
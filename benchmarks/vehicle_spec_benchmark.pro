@@ -0,0 +1,13 @@
+# Car::tick vs. the compile time specialized tick of VehicleRegistry (see vehicle_spec.h)
+# build: qmake vehicle_spec_benchmark.pro && make && ./vehicle_spec_benchmark
+
+QT       += core gui svg
+
+TARGET = vehicle_spec_benchmark
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../simulation_core.pri)
+
+SOURCES += vehicle_spec_benchmark.cpp
@@ -1,8 +1,6 @@
-#include "stdafx.h"
 #include <QDateTime>
 #include "car.h"
 #include "logging.h"
-#include "qcarviz.h"
 
 void Car::save_log(const bool intro_run, QDateTime& program_start_time) {
     Q_UNUSED(program_start_time);
@@ -26,7 +24,7 @@ void Car::save_log(const bool intro_run, QDateTime& program_start_time) {
     log.reset();
 }
 
-qreal Car::tick(qreal dt, qreal const alpha, bool const replay)
+qreal Car::tick(qreal dt, qreal const alpha, Integrator::Scheme const scheme)
 {
     //dt = 0.017;
     if (dt <= 0)
@@ -34,14 +32,20 @@ qreal Car::tick(qreal dt, qreal const alpha, bool const replay)
 //    if (dt > 0.1)
 //        dt = 0.1;
 
-    //logging
-    if (log && !replay) {
-        log->add_item(throttle, braking, gearbox.get_gear(), dt);
+    Q_ASSERT(!isnan(engine.angular_velocity));
+    gearbox.tick(dt);
+    switch (scheme) {
+        case Integrator::SemiImplicitEuler: step_euler(dt, alpha); break;
+        case Integrator::RK4: step_rk4(dt, alpha); break;
     }
+    Q_ASSERT(!isnan(speed));
+    Q_ASSERT(!isnan(engine.angular_velocity));
+    return current_acceleration;
+}
 
+qreal Car::net_force(qreal const dt, qreal const alpha)
+{
     // get forward force
-    Q_ASSERT(!isnan(engine.angular_velocity));
-    gearbox.tick(dt);
     engine.update_torque(gearbox.gear_change() ? 0 : throttle);
     qreal F = gearbox.torque2force_engine2wheels(engine, speed, dt);
     //current_wheel_force = F;
@@ -51,29 +55,68 @@ qreal Car::tick(qreal dt, qreal const alpha, bool const replay)
     qreal rolling_resistance = resistances::rolling(rolling_resistance_coefficient, alpha, mass);
     qreal uphill_resistance = resistances::uphill(mass, alpha);
     current_single_resistance = drag_resistance;
-    osc->send_float("/uphill_resistance", uphill_resistance);
     current_accumulated_resistance = drag_resistance + rolling_resistance + uphill_resistance;
 
     F -= current_accumulated_resistance;
     F -= braking * max_breaking_force; // breaking force
+    return F;
+}
 
-    // calculate acceleration
+qreal Car::force2acceleration(qreal const F)
+{
     qreal const mass_factor = gearbox.mass_factors[gearbox.get_gear()];
-    qreal a;
     if (F > 0) {
-        a = F / (mass * mass_factor);
+        return F / (mass * mass_factor);
     } else {
-        a = F * mass_factor / mass;
+        return F * mass_factor / mass;
         //a = (F * (1+engine.rpm*0.01) / mass); // TODO: das ist sicherlich nicht *ganz* richtig...
     }
+}
+
+void Car::step_euler(qreal const dt, qreal const alpha)
+{
+    // calculate acceleration
+    qreal const a = force2acceleration(net_force(dt, alpha));
     // update speed & rpm
     speed += a * dt;
     if (speed < 0) // TODO: sure?
         speed = 0;
-    Q_ASSERT(!isnan(speed));
-    Q_ASSERT(!isnan(engine.angular_velocity));
     gearbox.update_engine_speed(engine, speed, dt);
-    Q_ASSERT(!isnan(engine.angular_velocity));
     current_acceleration = a;
-    return a;
+}
+
+void Car::step_rk4(qreal const dt, qreal const alpha)
+{
+    // with a fully engaged clutch the engine speed follows the wheels and isn't a state of its own
+    bool const locked = gearbox.clutch.engage && !gearbox.clutch.acting();
+    qreal const v0 = speed;
+    qreal const w0 = engine.angular_velocity;
+    // derivatives of speed (dv) and engine speed (dw) at (v, w)
+    auto derive = [&](qreal const v, qreal const w, qreal& dv, qreal& dw) {
+        speed = std::max(v, 0.);
+        engine.angular_velocity = locked ? Engine::rpm2angular_velocity(gearbox.speed2engine_rpm(speed)) : w;
+        dv = force2acceleration(net_force(dt, alpha));
+        dw = (engine.torque_out - engine.torque_counter) / engine.inertia;
+    };
+    qreal dv1, dw1, dv2, dw2, dv3, dw3, dv4, dw4;
+    derive(v0, w0, dv1, dw1);
+    // torques & resistances are reported for the beginning of the step (as with euler)
+    qreal const torque = engine.torque, torque_out = engine.torque_out, torque_counter = engine.torque_counter;
+    qreal const accumulated_resistance = current_accumulated_resistance, single_resistance = current_single_resistance;
+    derive(v0 + 0.5 * dt * dv1, w0 + 0.5 * dt * dw1, dv2, dw2);
+    derive(v0 + 0.5 * dt * dv2, w0 + 0.5 * dt * dw2, dv3, dw3);
+    derive(v0 + dt * dv3, w0 + dt * dw3, dv4, dw4);
+    engine.torque = torque;
+    engine.torque_out = torque_out;
+    engine.torque_counter = torque_counter;
+    current_accumulated_resistance = accumulated_resistance;
+    current_single_resistance = single_resistance;
+
+    qreal const a = (dv1 + 2 * dv2 + 2 * dv3 + dv4) / 6;
+    speed = std::max(v0 + dt * a, 0.);
+    if (locked)
+        engine.set_rpm(gearbox.speed2engine_rpm(speed));
+    else
+        engine.angular_velocity = w0 + dt * (dw1 + 2 * dw2 + 2 * dw3 + dw4) / 6;
+    current_acceleration = a;
 }
@@ -4,7 +4,9 @@
 #include "engine.h"
 #include "gearbox.h"
 #include "resistances.h"
+#include "integrator.h"
 #include <memory>
+#include <QDateTime>
 
 struct Log;
 
@@ -37,7 +39,7 @@ public:
 
     // throttle: (0..1), alpha: up/downhill [rad]
     // returns acceleration [m/s^2]
-    qreal tick(qreal const dt, qreal const alpha, bool const replay);
+    qreal tick(qreal const dt, qreal const alpha, Integrator::Scheme const scheme = Integrator::SemiImplicitEuler);
 
     OSCSender* osc = nullptr;
 
@@ -58,6 +60,15 @@ public:
     Gearbox gearbox;
 
     std::shared_ptr<Log> log;
+
+protected:
+    // wheel force minus all resistances [N] for the current speed & engine speed
+    // (updates engine.torque, torque_out and torque_counter)
+    qreal net_force(qreal const dt, qreal const alpha);
+    // force [N] => acceleration [m/s^2] (mass factor of the current gear)
+    qreal force2acceleration(qreal const F);
+    void step_euler(qreal const dt, qreal const alpha);
+    void step_rk4(qreal const dt, qreal const alpha);
 };
 
 inline QDataStream &operator<<(QDataStream &out, const Car &car)
@@ -17,7 +17,6 @@ TEMPLATE = app
 LIBS += -framework IOKit
 LIBS += -framework CoreFoundation
 LIBS += -L/usr/local/Cellar/boost/1.67.0_1/lib -lboost_thread-mt -lboost_system-mt
-LIBS += -L$$PWD/lib/quazip/release -lquazip -lz
 
 #DEFINES += CAR_VIZ_FINAL_STUDY
 DEFINES += CAR_VIZ_MAX_RUNS=4
@@ -36,62 +35,36 @@ INCLUDEPATH += . \
 CONFIG += c++11 precompile_header
 PRECOMPILED_HEADER = stdafx.h
 
+include(simulation_core.pri)
+
 SOURCES += main.cpp\
         mainwindow.cpp \
-    engine.cpp \
     lib/qcustomplot/qcustomplot.cpp \
-    lib/oscpack_1_1_0/osc/OscOutboundPacketStream.cpp \
-    lib/oscpack_1_1_0/osc/OscPrintReceivedElements.cpp \
-    lib/oscpack_1_1_0/osc/OscReceivedElements.cpp \
-    lib/oscpack_1_1_0/osc/OscTypes.cpp \
-    lib/oscpack_1_1_0/ip/IpEndpointName.cpp \
-    lib/oscpack_1_1_0/ip/posix/NetworkingUtils.cpp \
-    lib/oscpack_1_1_0/ip/posix/UdpSocket.cpp \
     qtrackeditor.cpp \
     lib/HID/HID.cpp \
     qcarviz.cpp \
-    car.cpp \
     hudwindow.cpp \
     qhudwidget.cpp \
     hud.cpp \
-    fedi_volume.cpp
+    fedi_volume.cpp \
+    simulation_thread.cpp \
+    scene_renderer.cpp
 
 HEADERS  += mainwindow.h \
-    engine.h \
     lib/qcustomplot/qcustomplot.h \
-    lib/oscpack_1_1_0/osc/MessageMappingOscPacketListener.h \
-    lib/oscpack_1_1_0/osc/OscException.h \
-    lib/oscpack_1_1_0/osc/OscHostEndianness.h \
-    lib/oscpack_1_1_0/osc/OscOutboundPacketStream.h \
-    lib/oscpack_1_1_0/osc/OscPacketListener.h \
-    lib/oscpack_1_1_0/osc/OscPrintReceivedElements.h \
-    lib/oscpack_1_1_0/osc/OscReceivedElements.h \
-    lib/oscpack_1_1_0/osc/OscTypes.h \
-    lib/oscpack_1_1_0/ip/IpEndpointName.h \
-    lib/oscpack_1_1_0/ip/NetworkingUtils.h \
-    lib/oscpack_1_1_0/ip/PacketListener.h \
-    lib/oscpack_1_1_0/ip/TimerListener.h \
-    lib/oscpack_1_1_0/ip/UdpSocket.h \
-    consumption_map.h \
-    torque_map.h \
-    gearbox.h \
-    car.h \
-    resistances.h \
     qcarviz.h \
     qtrackeditor.h \
-    track.h \
     lib/HID/HID.h \
-    OSCSender.h \
     hud.h \
-    speed_observer.h \
-    misc.h \
     KeyboardInput.h \
-    logging.h \
     wingman_input.h \
     hudwindow.h \
     qhudwidget.h \
     stdafx.h \
-    fedi_volume.h
+    fedi_volume.h \
+    simulation_thread.h \
+    triple_buffer.h \
+    scene_renderer.h
 
 FORMS    += mainwindow.ui \
     hudwindow.ui \
@@ -0,0 +1,125 @@
+#include "consumption_map.h"
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegularExpression>
+#include <QVector>
+#include <QDebug>
+
+constexpr int ConsumptionMap::GRID_N_RPM;
+constexpr int ConsumptionMap::GRID_N_TORQUE;
+constexpr qreal ConsumptionMap::GRID_RPM_MAX;
+
+namespace {
+
+// index i of the interval [axis[i], axis[i+1]] containing x (clamped), f: position within the interval (0..1)
+void find_interval(const QVector<qreal>& axis, qreal const x, int& i, qreal& f)
+{
+    if (axis.size() == 1 || x <= axis.first()) {
+        i = 0;
+        f = 0;
+        return;
+    }
+    if (x >= axis.last()) {
+        i = axis.size() - 2;
+        f = 1;
+        return;
+    }
+    i = std::upper_bound(axis.begin(), axis.end(), x) - axis.begin() - 1;
+    f = (x - axis[i]) / (axis[i+1] - axis[i]);
+}
+
+bool ascending(const QVector<qreal>& axis)
+{
+    for (int i = 1; i < axis.size(); i++)
+        if (axis[i] <= axis[i-1])
+            return false;
+    return true;
+}
+
+} // namespace
+
+bool ConsumptionMap::load_bsfc_csv(const QString& filename, qreal const max_rpm, qreal const max_torque, qreal* min_bsfc)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "ConsumptionMap: can't open" << filename;
+        return false;
+    }
+    const QRegularExpression separator("[,;\\t]");
+    QVector<qreal> torque_axis; // [N*m]
+    QVector<qreal> rpm_axis; // [u/min]
+    QVector<QVector<qreal>> bsfc; // [rpm][torque], [g/kWh]
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+        const QStringList cells = line.split(separator);
+        if (torque_axis.isEmpty()) {
+            for (int i = 1; i < cells.size(); i++) {
+                bool ok;
+                torque_axis.append(cells[i].trimmed().toDouble(&ok));
+                if (!ok) {
+                    qWarning() << "ConsumptionMap: invalid torque" << cells[i] << "in" << filename;
+                    return false;
+                }
+            }
+            continue;
+        }
+        bool ok;
+        rpm_axis.append(cells[0].trimmed().toDouble(&ok));
+        if (!ok) {
+            qWarning() << "ConsumptionMap: invalid rpm" << cells[0] << "in" << filename;
+            return false;
+        }
+        QVector<qreal> row(torque_axis.size(), NAN);
+        int valid = 0;
+        for (int i = 1; i < cells.size() && i <= torque_axis.size(); i++) {
+            const qreal value = cells[i].trimmed().toDouble(&ok);
+            if (ok && value > 0) {
+                row[i-1] = value;
+                valid++;
+            }
+        }
+        if (!valid) {
+            qWarning() << "ConsumptionMap: no values for rpm" << rpm_axis.last() << "in" << filename;
+            return false;
+        }
+        // fill the empty cells from their neighbours
+        for (int i = 1; i < row.size(); i++)
+            if (std::isnan(row[i]))
+                row[i] = row[i-1];
+        for (int i = row.size() - 2; i >= 0; i--)
+            if (std::isnan(row[i]))
+                row[i] = row[i+1];
+        bsfc.append(row);
+    }
+    if (torque_axis.isEmpty() || rpm_axis.isEmpty() || !ascending(torque_axis) || !ascending(rpm_axis)) {
+        qWarning() << "ConsumptionMap: empty or unsorted axes in" << filename;
+        return false;
+    }
+
+    qreal min = bsfc[0][0];
+    for (const QVector<qreal>& row : bsfc)
+        for (const qreal value : row)
+            min = std::min(min, value);
+
+    // resample the (non-uniform) table into the grid
+    grid.resize(GRID_N_RPM, GRID_N_TORQUE, 0, GRID_RPM_MAX, 0, 1);
+    grid.bake([&](qreal rpm, qreal torque) {
+        int ir, it;
+        qreal fr, ft;
+        find_interval(rpm_axis, rpm * max_rpm, ir, fr);
+        find_interval(torque_axis, torque * max_torque, it, ft);
+        const int ir1 = std::min(ir + 1, rpm_axis.size() - 1);
+        const int it1 = std::min(it + 1, torque_axis.size() - 1);
+        const qreal v0 = bsfc[ir][it] + ft * (bsfc[ir][it1] - bsfc[ir][it]);
+        const qreal v1 = bsfc[ir1][it] + ft * (bsfc[ir1][it1] - bsfc[ir1][it]);
+        return (v0 + fr * (v1 - v0)) / min;
+    });
+    measured = true;
+    if (min_bsfc)
+        *min_bsfc = min;
+    return true;
+}
@@ -5,11 +5,16 @@
 #include <QtGlobal>
 #include <QPointF>
 #include <QTransform>
+#include <QString>
+#include <QDataStream>
+#include "grid2d.h"
 
 template<class T> inline T sqr(const T x) { return x*x; }
 
 // ConsumptionMap translates (relative) torque & rpm to (relative) consumption (100%- (e.g.) 150%) [1-1.5]
-// it is currently implemented as an ellipse at a specific point in the torque/rpm diagram
+// by default it is implemented as an ellipse at a specific point in the torque/rpm diagram,
+// alternatively a measured BSFC map can be loaded from a CSV file (see load_bsfc_csv).
+// either one is baked into a uniform rpm x torque grid, get_rel_consumption() is a bilinear lookup in that grid
 struct ConsumptionMap {
 public:
     ConsumptionMap()
@@ -21,21 +26,83 @@ public:
 //            for (ulong i = 0; i < ARR_SIZE(x2c); i++) {
 //                d2consumption.append(QPointF(x2c[i][0], x2c[i][1]));
 //            }
+        bake_ellipse();
     }
 
     // both torque & rpm must be relative! (0-1)
-    qreal get_rel_consumption(qreal const rpm, qreal const torque) const {
+    inline qreal get_rel_consumption(qreal const rpm, qreal const torque) const {
+        return grid.get(rpm, torque);
+    }
+    // the baked grid (x=rpm, y=torque)
+    const Grid2D& get_grid() const { return grid; }
+
+    // both torque & rpm must be relative! (0-1)
+    // the ellipse function itself (used for baking the grid)
+    qreal get_rel_consumption_ellipse(qreal const rpm, qreal const torque) const {
         const QPointF x = transform.map(QPointF(rpm, torque));
         const qreal e = sqr(x.x() / ellipse.x()) + sqr(x.y() / ellipse.y()); // ellipse function
         //return log(e + 1) * 0.2 + 1; // mapping
         return pow(e, 0.7) * 0.1 + 1;
     }
 
-//protected:
+    const QPointF& get_ellipse() const { return ellipse; }
+    const QTransform& get_transform() const { return transform; }
+    // replaces a loaded BSFC map
+    void set_ellipse(const QPointF& ellipse, const QTransform& transform) {
+        this->ellipse = ellipse;
+        this->transform = transform;
+        bake_ellipse();
+    }
+
+    // loads a measured BSFC map [g/kWh], max_rpm [u/min] and max_torque [N*m] make the axes relative.
+    // format: first line: (ignored), torque_0, torque_1, .. [N*m]
+    //         other lines: rpm [u/min], bsfc_0, bsfc_1, ..
+    // separators: ',' ';' or tab, both axes ascending, lines starting with '#' are ignored,
+    // empty cells (e.g. above the full load curve) take the value of their neighbour in the same line.
+    // the consumption is made relative to the minimum BSFC, which is returned in min_bsfc (=> Engine::base_consumption).
+    // returns false (and leaves the map unchanged) if the file can't be read
+    bool load_bsfc_csv(const QString& filename, qreal const max_rpm, qreal const max_torque, qreal* min_bsfc = nullptr);
+    bool is_measured() const { return measured; }
+
+    // the grid of a measured map (the ellipse is stored by Engine), in logs >= 2.2
+    void write_measured(QDataStream& out) const {
+        out << measured;
+        if (measured)
+            out << grid;
+    }
+    // keeps the ellipse if the stream has no valid measured grid
+    void read_measured(QDataStream& in) {
+        bool is_measured;
+        in >> is_measured;
+        if (!is_measured)
+            return;
+        Grid2D measured_grid;
+        in >> measured_grid;
+        if (in.status() != QDataStream::Ok)
+            return;
+        grid = measured_grid;
+        measured = true;
+    }
+
+    // grid: 0.01 steps along rpm (up to 1.2 for over-revving), 0.01 along torque
+    // (max. error vs. the ellipse function: 5e-4)
+    static constexpr int GRID_N_RPM = 121;
+    static constexpr int GRID_N_TORQUE = 101;
+    static constexpr qreal GRID_RPM_MAX = 1.2;
+
+protected:
+    void bake_ellipse() {
+        grid.resize(GRID_N_RPM, GRID_N_TORQUE, 0, GRID_RPM_MAX, 0, 1);
+        grid.bake([this](qreal rpm, qreal torque) { return get_rel_consumption_ellipse(rpm, torque); });
+        measured = false;
+    }
+
     //QPointF center;
     QPointF ellipse; // a/b parameter
     QTransform transform; // takes care of rotation & translation of the ellipse
 //        QVector<QPointF> d2consumption; // maps the iso-lines of the ellipse to relative consumption, must be sorted by x
+    Grid2D grid; // x=rpm, y=torque
+    bool measured = false;
 };
 
 #endif // CONSUMPTION_MAP_H
@@ -0,0 +1,147 @@
+#include "driver_model.h"
+#include <boost/algorithm/clamp.hpp>
+
+void DriverModel::reset(const SimulationCore& /*core*/)
+{
+    cruise_factor = std::max(0.5, style.cruise_factor + style.cruise_spread * normal(rng));
+    speed_offset = style.speed_noise * normal(rng);
+    integral = 0;
+    perceived_steering = 0;
+    shift_t = style.min_shift_interval;
+    next_sign = 0;
+    speed_limit = style.default_kmh;
+    next_stop = 0;
+    stop_t = 0;
+    green_t = 0;
+    target_kmh = 0;
+}
+
+void DriverModel::advance_signs(const Track& track, const qreal pos)
+{
+    if (next_sign > track.signs.size() || (next_sign > 0 && track.signs[next_sign-1].at_length > pos)) {
+        // moved back (or another track): from the start
+        next_sign = 0;
+        speed_limit = style.default_kmh;
+    }
+    for ( ; next_sign < track.signs.size(); next_sign++) { // sorted by prepare_track
+        const Track::Sign& s = track.signs[next_sign];
+        if (s.at_length > pos)
+            break;
+        if (s.is_speed_sign())
+            speed_limit = s.speed_limit();
+    }
+}
+
+qreal DriverModel::plan_speed(const SimulationCore& core, const qreal dt, qreal& required_decel)
+{
+    const Track& track = core.track;
+    const qreal pos = core.current_pos;
+    const qreal speed = core.car.speed;
+    required_decel = 0;
+    advance_signs(track, pos);
+    qreal v = Gearbox::kmh2speed(std::max(0., speed_limit * cruise_factor + speed_offset));
+    // the constraint: speed v_c [m/s] at distance d [m]
+    auto constrain = [&](const qreal v_c, const qreal d) {
+        v = std::min(v, approach_speed(v_c, d));
+        if (speed > v) // at the line: brake hard
+            required_decel = std::max(required_decel, (speed * speed - v_c * v_c) / (2 * std::max(d, 0.5)));
+    };
+
+    // the stop sign ahead: stand for stop_time (StopSignObserver: slower than 3 m/s within 70 units)
+    while (next_stop < track.signs.size() && track.signs[next_stop].type != Track::Sign::Stop)
+        next_stop++;
+    if (next_stop < track.signs.size()) {
+        const qreal d = meters(track.signs[next_stop].at_length - pos);
+        if (speed < 0.3 && d < meters(70))
+            stop_t += dt;
+        if (stop_t >= style.stop_time || d < -meters(10)) {
+            next_stop++;
+            stop_t = 0;
+        }
+    }
+
+    // the signs ahead: from the cursor (and the signs right at pos before it)
+    int first = next_sign;
+    while (first > 0 && track.signs[first-1].at_length >= pos)
+        first--;
+    bool first_light = true;
+    for (int i = first; i < track.signs.size(); i++) {
+        const Track::Sign& s = track.signs[i];
+        const qreal d = meters(s.at_length - pos);
+        if (d > style.lookahead)
+            break;
+        if (s.is_speed_sign()) {
+            constrain(Gearbox::kmh2speed(s.speed_limit() * cruise_factor), d);
+        } else if (s.type == Track::Sign::Stop && i == next_stop) {
+            constrain(0, d - 2);
+        } else if (s.type == Track::Sign::TrafficLight) {
+            // stop in front of the light, but within its trigger distance (otherwise it never turns green)
+            const qreal stop_distance = std::min(5., meters(s.traffic_light_info.trigger_distance) / 2);
+            const bool go = s.traffic_light_state == Track::Sign::Yellow || s.traffic_light_state == Track::Sign::Green;
+            if (first_light) {
+                green_t = go ? green_t + dt : 0;
+                first_light = false;
+            }
+            if (!go || (green_t < style.reaction_time && speed < 0.5))
+                constrain(0, d - stop_distance);
+        }
+    }
+    return v;
+}
+
+void DriverModel::shift(SimulationCore& core, const qreal dt)
+{
+    Gearbox& gearbox = core.car.gearbox;
+    shift_t += dt;
+    if (gearbox.gear_change() || shift_t < style.min_shift_interval)
+        return;
+    const int gear = gearbox.get_gear();
+    const qreal rpm = gearbox.speed2engine_rpm(core.car.speed); // of the wheels, the clutch may still slip
+    if (rpm > style.upshift_rpm && gear + 1 < gearbox.gears.size() && core.car.throttle > 0
+            && rpm * gearbox.gears[gear+1] / gearbox.gears[gear] > style.downshift_rpm) {
+        gearbox.gear_up();
+        shift_t = 0;
+    } else if (rpm < style.downshift_rpm && gear > 0) {
+        gearbox.gear_down();
+        shift_t = 0;
+    }
+}
+
+void DriverModel::drive(SimulationCore& core, const qreal dt)
+{
+    Car& car = core.car;
+
+    // wandering target speed
+    const qreal tc = style.speed_noise_time;
+    speed_offset += -speed_offset / tc * dt + style.speed_noise * sqrt(2 * dt / tc) * normal(rng);
+
+    qreal required_decel;
+    target_kmh = Gearbox::speed2kmh(plan_speed(core, dt, required_decel));
+    const qreal error = target_kmh - core.get_kmh(); // [km/h]
+
+    qreal throttle = 0, braking = 0;
+    if (target_kmh < 0.5 && car.speed < 0.3) { // standing
+        braking = 1;
+        integral = 0;
+    } else {
+        throttle = style.kp * error + style.ki * integral + style.pedal_noise * normal(rng);
+        braking = std::max(style.kb * (-error - style.brake_tolerance), required_decel * car.mass / car.max_breaking_force);
+        if (braking > 0)
+            throttle = 0;
+        // no windup while the throttle is saturated
+        if ((throttle > 0 || error > 0) && (throttle < style.max_throttle || error < 0))
+            integral = boost::algorithm::clamp(integral + error * dt, 0., style.max_throttle / style.ki);
+    }
+    const qreal max_change = style.pedal_rate * dt;
+    car.throttle = boost::algorithm::clamp(throttle, car.throttle - max_change, car.throttle + max_change);
+    car.throttle = boost::algorithm::clamp(car.throttle, 0., style.max_throttle);
+    car.braking = boost::algorithm::clamp(braking, car.braking - max_change, car.braking + max_change);
+    car.braking = boost::algorithm::clamp(car.braking, 0., 1.);
+
+    shift(core, dt);
+
+    // counter the steering of the turn signs (like the WingMan wheel), reacting with a lag
+    perceived_steering += (core.steering - perceived_steering) * std::min(1., dt / style.reaction_time);
+    const qreal wheel = boost::algorithm::clamp(style.steering_gain * perceived_steering, -1., 1.);
+    core.user_steering -= wheel * dt * 1.5;
+}
@@ -0,0 +1,88 @@
+#ifndef DRIVER_MODEL_H
+#define DRIVER_MODEL_H
+
+#include <random>
+#include "simulation_core.h"
+
+// Driver produces the input of a live run every frame (car.throttle, car.braking, gear and user_steering),
+// in place of the human at the keyboard / WingMan wheel. See SimulationCore::drive_run.
+class Driver
+{
+public:
+    virtual ~Driver() {}
+    // a new run starts on the prepared track of core
+    virtual void reset(const SimulationCore& core) = 0;
+    // sets the input for the next frame of dt [s]
+    virtual void drive(SimulationCore& core, const qreal dt) = 0;
+};
+
+// how a DriverModel drives. the defaults are a calm, law-abiding driver
+struct DriverStyle {
+    qreal cruise_factor = 0.95; // target speed relative to the speed limit
+    qreal cruise_spread = 0.05; // standard deviation of cruise_factor between runs
+    qreal default_kmh = 50; // before the first speed sign
+    qreal decel = 2; // [m/s^2] planned deceleration for lower limits, stop signs and red lights
+    qreal lookahead = 200; // [m] how far ahead signs are taken into account
+    qreal max_throttle = 0.8;
+    qreal kp = 0.08; // throttle per km/h below the target
+    qreal ki = 0.02; // throttle per (km/h * s)
+    qreal kb = 0.05; // braking per km/h above the target (+ brake_tolerance)
+    qreal brake_tolerance = 3; // [km/h] above the target before braking
+    qreal pedal_rate = 2; // max pedal change per second
+    qreal upshift_rpm = 2500;
+    qreal downshift_rpm = 1200;
+    qreal min_shift_interval = 1; // [s]
+    qreal reaction_time = 0.7; // [s] until a green light is noticed, lag of the steering reaction
+    qreal steering_gain = 2; // wheel per unit of steering
+    qreal stop_time = 1; // [s] standing at a stop sign
+    qreal speed_noise = 2; // [km/h] standard deviation of the wandering target speed
+    qreal speed_noise_time = 5; // [s] correlation time of the speed noise
+    qreal pedal_noise = 0.02; // standard deviation of the throttle jitter
+};
+
+// DriverModel is a rule based driver: it follows the speed limits of the track (planning ahead to be slow enough
+// at lower limits, stop signs and red traffic lights), shifts by rpm and counters the steering of the turn signs.
+// the style is varied per run and the input is noisy, so that no two runs (seeds) are the same.
+class DriverModel : public Driver
+{
+public:
+    DriverModel(const DriverStyle& style = DriverStyle(), const unsigned seed = 0) : style(style), rng(seed) {}
+
+    void reset(const SimulationCore& core) override;
+    void drive(SimulationCore& core, const qreal dt) override;
+
+    // target speed [km/h] of the last frame
+    qreal get_target_kmh() const { return target_kmh; }
+
+    DriverStyle style;
+
+protected:
+    // position in meters (the track_path is in units)
+    static qreal meters(const qreal units) { return units / SimulationCore::PATH_UNITS_PER_METER; }
+    // [m/s] allowed now to reach speed within distance [m] with the planned deceleration
+    qreal approach_speed(const qreal speed, const qreal distance) const {
+        return sqrt(speed * speed + 2 * style.decel * std::max(0., distance));
+    }
+    // moves the sign cursor to pos (and the speed limit with it), the position only grows during a run
+    void advance_signs(const Track& track, const qreal pos);
+    // target speed [m/s] and the deceleration [m/s^2] needed to keep the limits, signs and lights ahead
+    qreal plan_speed(const SimulationCore& core, const qreal dt, qreal& required_decel);
+    void shift(SimulationCore& core, const qreal dt);
+
+    std::mt19937_64 rng;
+    std::normal_distribution<qreal> normal;
+
+    qreal cruise_factor = 1; // of this run
+    qreal speed_offset = 0; // [km/h] wandering (Ornstein-Uhlenbeck) part of the target speed
+    qreal integral = 0; // of the speed error [km/h * s]
+    qreal perceived_steering = 0;
+    qreal shift_t = 0; // [s] since the last gear change
+    int next_sign = 0; // index of the first sign after the position of the last frame (in track.signs)
+    qreal speed_limit = 0; // [km/h] of the last speed sign before next_sign
+    int next_stop = 0; // index of the first stop sign not stopped at yet (in track.signs)
+    qreal stop_t = 0; // [s] standing at the stop sign
+    qreal green_t = 0; // [s] since the light ahead allows to go
+    qreal target_kmh = 0;
+};
+
+#endif // DRIVER_MODEL_H
@@ -1,4 +1,3 @@
-#include "stdafx.h"
 #include "engine.h"
 #include "gearbox.h"
 #include "car.h"
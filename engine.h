@@ -18,7 +18,8 @@ struct ConsumptionMonitor
         ml_counter += dt * liters_s;
         if (ml_counter >= ml_per_tick * 0.001) {
             ml_counter -= ml_per_tick * 0.001;
-            osc->send_float("/consumption_tick", liters_per_100km_cont);
+            if (osc)
+                osc->send_float("/consumption_tick", liters_per_100km_cont);
         }
     }
     inline double l_100km_instantaneous(const double liter_s, const double speed) {
@@ -69,14 +70,23 @@ public:
             throttle = min_throttle;
         torque = max_torque * torque_map.get_torque(throttle, rel_rpm());
         //Q_ASSERT(torque != 0);
-        torque_out = torque - engine_braking_coefficient * pow(std::max(rpm(), 0.) / 60, 1.1)
-                            - engine_braking_offset;
+        torque_out = torque - braking_torque(rpm());
         //printf("%.3f %.3f\n", torque, torque_out);
         Q_ASSERT(!isnan(torque_out));
         Q_ASSERT(torque_out <= torque);
         return torque_out;
     }
 
+    // friction & pumping losses [N*m] at rpm [u/min]
+    inline qreal braking_torque(qreal const rpm) const {
+        return engine_braking_coefficient * pow(std::max(rpm, 0.) / 60, 1.1) + engine_braking_offset;
+    }
+
+    // loads a measured BSFC map (see ConsumptionMap::load_bsfc_csv), base_consumption becomes its minimum
+    bool load_bsfc_csv(const QString& filename) {
+        return consumption_map.load_bsfc_csv(filename, max_rpm, max_torque, &base_consumption);
+    }
+
     // returns [kW]
     inline qreal power_output() const {
         return angular_velocity * torque / 1000;
@@ -84,8 +94,12 @@ public:
 
     // returns [g/h] (?)
     inline qreal get_consumption() const {
-        qreal const power = power_output();
-        qreal rel_consumption = consumption_map.get_rel_consumption(rel_rpm(), torque / max_torque);
+        return get_consumption(angular_velocity, torque);
+    }
+    // same for any operating point: angular_velocity [rad/s], torque [N*m]
+    inline qreal get_consumption(qreal const angular_velocity, qreal const torque) const {
+        qreal const power = angular_velocity * torque / 1000;
+        qreal rel_consumption = consumption_map.get_rel_consumption(angular_velocity * 60 / (2*M_PI) / max_rpm, torque / max_torque);
         return rel_consumption * base_consumption * power;
     }
 
@@ -133,14 +147,17 @@ public:
 
 inline QDataStream &operator<<(QDataStream &out, const Engine &engine)
 {
-    out << engine.consumption_map.ellipse << engine.consumption_map.transform << engine.base_consumption << engine.torque_map.torque_ramps << engine.max_rpm <<
+    out << engine.consumption_map.get_ellipse() << engine.consumption_map.get_transform() << engine.base_consumption << engine.torque_map << engine.max_rpm <<
            engine.max_torque << engine.engine_braking_coefficient << engine.engine_braking_offset << engine.min_throttle << engine.inertia;
     return out;
 }
 
 inline QDataStream &operator>>(QDataStream &in, Engine &engine) {
-    in >> engine.consumption_map.ellipse >> engine.consumption_map.transform >> engine.base_consumption >> engine.torque_map.torque_ramps >> engine.max_rpm >>
+    QPointF ellipse;
+    QTransform transform;
+    in >> ellipse >> transform >> engine.base_consumption >> engine.torque_map >> engine.max_rpm >>
            engine.max_torque >> engine.engine_braking_coefficient >> engine.engine_braking_offset >> engine.min_throttle >> engine.inertia;
+    engine.consumption_map.set_ellipse(ellipse, transform);
     return in;
 }
 
@@ -0,0 +1,176 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <QtGlobal>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <math.h>
+
+// the timed parts of a frame
+enum FrameSection {
+    FrameTick, // the simulation steps since the previous frame (simulation thread)
+    FrameHud, // time, speedometer, consumption, gear
+    FrameRoad,
+    FrameSigns,
+    FrameTrees,
+    FrameCar,
+    FrameArrow,
+    FramePresent, // the rest of the frame: overlays, flush to the screen, waiting for the next paint
+    __FrameSection_length
+};
+
+inline const char* frame_section_name(const FrameSection s) {
+    switch (s) {
+        case FrameTick: return "tick";
+        case FrameHud: return "hud";
+        case FrameRoad: return "road";
+        case FrameSigns: return "signs";
+        case FrameTrees: return "trees";
+        case FrameCar: return "car";
+        case FrameArrow: return "arrow";
+        case FramePresent: return "present";
+        case __FrameSection_length: break;
+    }
+    Q_ASSERT(false);
+    return "";
+}
+
+// the timing of one frame [ms]
+struct FrameTiming {
+    float interval = 0; // from the start of this frame to the start of the next one
+    float sections[__FrameSection_length] = {};
+};
+
+// adds the time between the laps to the sections of timing (does nothing without timing)
+struct FrameSectionClock {
+    FrameSectionClock(FrameTiming* timing) : timing(timing) {
+        if (timing)
+            timer.start();
+    }
+    // the time since the previous lap belongs to s
+    void lap(const FrameSection s) {
+        if (!timing)
+            return;
+        const qint64 t = timer.nsecsElapsed();
+        timing->sections[s] += (t - last) * 1e-6f;
+        last = t;
+    }
+
+    FrameTiming* timing;
+    QElapsedTimer timer;
+    qint64 last = 0;
+};
+
+// FrameTimingRing keeps the latest CAPACITY frames, for the overlay graph. not synchronized: push() and latest()
+// belong to the same thread (the gui thread, which times the frames and draws the graph)
+class FrameTimingRing
+{
+public:
+    static const int CAPACITY = 512; // power of 2
+
+    void push(const FrameTiming& f) {
+        frames[count % CAPACITY] = f;
+        count++;
+    }
+    // copies the latest (up to n) frames into out, oldest first, returns how many
+    int latest(FrameTiming* out, int n) const {
+        n = (int) std::min<quint64>(std::min(n, (int) CAPACITY), count);
+        for (int i = 0; i < n; i++)
+            out[i] = frames[(count - n + i) % CAPACITY];
+        return n;
+    }
+    // all frames pushed so far
+    quint64 size() const { return count; }
+
+protected:
+    std::array<FrameTiming, CAPACITY> frames;
+    quint64 count = 0;
+};
+
+// the frame timing of a run, stored in its Log
+struct FrameTimingSummary {
+    qint32 frames = 0;
+    qint32 dropped = 0; // refresh intervals without a new frame
+    qreal refresh_interval = 0; // of the screen [ms]
+    qreal p50 = 0, p95 = 0, p99 = 0, max = 0; // of the frame intervals [ms]
+    qreal section_mean[__FrameSection_length] = {}; // [ms]
+};
+
+inline QDataStream &operator<<(QDataStream &out, const FrameTimingSummary &s)
+{
+    out << s.frames << s.dropped << s.refresh_interval << s.p50 << s.p95 << s.p99 << s.max;
+    for (int i = 0; i < __FrameSection_length; i++)
+        out << s.section_mean[i];
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, FrameTimingSummary &s) {
+    in >> s.frames >> s.dropped >> s.refresh_interval >> s.p50 >> s.p95 >> s.p99 >> s.max;
+    for (int i = 0; i < __FrameSection_length; i++)
+        in >> s.section_mean[i];
+    return in;
+}
+
+// FrameTimingStats collects all frames of a run (the ring only keeps the latest ones): the frame intervals in a
+// histogram of BIN_MS bins (the percentiles are exact to a bin), the sections as sums
+class FrameTimingStats
+{
+public:
+    static constexpr qreal BIN_MS = 0.1;
+    static const int BINS = 2500; // longer intervals (> 250 ms) count in the last bin
+
+    // refresh_interval: of the screen [ms], frames with a longer interval dropped some
+    void reset(const qreal refresh_interval) {
+        histogram.assign(BINS, 0);
+        summary_ = FrameTimingSummary();
+        summary_.refresh_interval = refresh_interval;
+        section_sum.fill(0);
+    }
+    void add(const FrameTiming& f) {
+        if (histogram.empty())
+            reset(1000. / 60);
+        histogram[std::min(BINS - 1, (int) (f.interval / BIN_MS))]++;
+        summary_.frames++;
+        summary_.max = std::max(summary_.max, (qreal) f.interval);
+        // an interval of 2.4 refresh intervals shows the same frame for 2 of them: 1 dropped
+        if (summary_.refresh_interval > 0)
+            summary_.dropped += std::max(0, (int) lround(f.interval / summary_.refresh_interval) - 1);
+        for (int i = 0; i < __FrameSection_length; i++)
+            section_sum[i] += f.sections[i];
+    }
+    // the p-quantile (0..1) of the intervals [ms], the upper bound of its bin
+    qreal percentile(const qreal p) const {
+        if (!summary_.frames)
+            return 0;
+        const quint64 rank = (quint64) ceil(p * summary_.frames);
+        quint64 n = 0;
+        for (int i = 0; i < BINS; i++) {
+            n += histogram[i];
+            if (n >= rank && n > 0)
+                return std::min((i + 1) * BIN_MS, summary_.max);
+        }
+        return summary_.max;
+    }
+    FrameTimingSummary summary() const {
+        FrameTimingSummary s = summary_;
+        s.p50 = percentile(0.5);
+        s.p95 = percentile(0.95);
+        s.p99 = percentile(0.99);
+        for (int i = 0; i < __FrameSection_length; i++)
+            s.section_mean[i] = s.frames ? section_sum[i] / s.frames : 0;
+        return s;
+    }
+    int frames() const { return summary_.frames; }
+    int dropped() const { return summary_.dropped; }
+    qreal refresh_interval() const { return summary_.refresh_interval; }
+
+protected:
+    std::vector<quint32> histogram;
+    FrameTimingSummary summary_;
+    std::array<qreal, __FrameSection_length> section_sum {};
+};
+
+#endif // FRAME_TIMING_H
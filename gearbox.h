@@ -1,6 +1,10 @@
 #ifndef GEARBOX_H
 #define GEARBOX_H
 
+#include <QObject>
+#include <QVector>
+#include <QDataStream>
+#include <string.h>
 #include "engine.h"
 
 class Gearbox;
@@ -172,7 +176,7 @@ public:
     bool gear_change() { // gear change in progress
         return t < t_gear_change;
     }
-    int get_gear() { return gear; }
+    int get_gear() const { return gear; }
 
     //void disengage() { clutch.disengage(); }
     //void engine_idle() { gear = 0; clutch = 0; }
@@ -0,0 +1,120 @@
+#ifndef GRID2D_H
+#define GRID2D_H
+
+#include <QVector>
+#include <QDataStream>
+#include <algorithm>
+#include <array>
+
+template<int NX, int NY> struct FixedGrid2D;
+
+// Grid2D samples a function f(x, y) on a uniform grid and interpolates bilinearly.
+// x and y are clamped to the grid range, the lookup has no branches (the clamping compiles to min/max)
+struct Grid2D {
+    // nx, ny: number of grid points (>= 2 each)
+    void resize(int const nx, int const ny, qreal const x_min, qreal const x_max, qreal const y_min, qreal const y_max) {
+        Q_ASSERT(nx >= 2 && ny >= 2);
+        Q_ASSERT(x_max > x_min && y_max > y_min);
+        this->nx = nx;
+        this->ny = ny;
+        this->x_min = x_min;
+        this->y_min = y_min;
+        x_scale = (nx - 1) / (x_max - x_min);
+        y_scale = (ny - 1) / (y_max - y_min);
+        values.resize(nx * ny);
+    }
+
+    // samples f at every grid point
+    template<class F>
+    void bake(F f) {
+        for (int iy = 0; iy < ny; iy++)
+            for (int ix = 0; ix < nx; ix++)
+                at(ix, iy) = f(x(ix), y(iy));
+    }
+
+    inline qreal get(qreal const x, qreal const y) const {
+        qreal const gx = std::min(std::max((x - x_min) * x_scale, 0.), qreal(nx - 1));
+        qreal const gy = std::min(std::max((y - y_min) * y_scale, 0.), qreal(ny - 1));
+        int const ix = std::min(int(gx), nx - 2);
+        int const iy = std::min(int(gy), ny - 2);
+        qreal const fx = gx - ix;
+        qreal const fy = gy - iy;
+        qreal const* const p = values.constData() + iy * nx + ix;
+        qreal const v0 = p[0] + fx * (p[1] - p[0]);
+        qreal const v1 = p[nx] + fx * (p[nx + 1] - p[nx]);
+        return v0 + fy * (v1 - v0);
+    }
+
+    qreal& at(int const ix, int const iy) { return values[iy * nx + ix]; }
+    qreal x(int const ix) const { return x_min + ix / x_scale; }
+    qreal y(int const iy) const { return y_min + iy / y_scale; }
+    int size_x() const { return nx; }
+    int size_y() const { return ny; }
+    // the layout, for lookups that don't go through get() (the SIMD kernels of VehicleBatch)
+    const qreal* data() const { return values.constData(); }
+    qreal min_x() const { return x_min; }
+    qreal min_y() const { return y_min; }
+    qreal scale_x() const { return x_scale; }
+    qreal scale_y() const { return y_scale; }
+
+    friend QDataStream &operator<<(QDataStream &out, const Grid2D &g) {
+        out << g.nx << g.ny << g.x_min << g.y_min << g.x_scale << g.y_scale << g.values;
+        return out;
+    }
+    // a grid that doesn't fit its values sets the status of the stream to ReadCorruptData
+    friend QDataStream &operator>>(QDataStream &in, Grid2D &g) {
+        in >> g.nx >> g.ny >> g.x_min >> g.y_min >> g.x_scale >> g.y_scale >> g.values;
+        if (g.nx < 2 || g.ny < 2 || g.values.size() != g.nx * g.ny)
+            in.setStatus(QDataStream::ReadCorruptData);
+        return in;
+    }
+
+protected:
+    template<int NX, int NY> friend struct FixedGrid2D;
+
+    QVector<qreal> values; // row major (one row per y)
+    int nx = 0;
+    int ny = 0;
+    qreal x_min = 0;
+    qreal y_min = 0;
+    qreal x_scale = 1;
+    qreal y_scale = 1;
+};
+
+// FixedGrid2D is a copy of a Grid2D whose size is known at compile time (std::array storage, constant strides)
+template<int NX, int NY>
+struct FixedGrid2D {
+    static_assert(NX >= 2 && NY >= 2, "at least 2x2 grid points");
+
+    static bool fits(const Grid2D& g) { return g.nx == NX && g.ny == NY; }
+    void assign(const Grid2D& g) {
+        Q_ASSERT(fits(g));
+        std::copy(g.values.constBegin(), g.values.constEnd(), values.begin());
+        x_min = g.x_min;
+        y_min = g.y_min;
+        x_scale = g.x_scale;
+        y_scale = g.y_scale;
+    }
+
+    // same as Grid2D::get (bit for bit)
+    inline qreal get(qreal const x, qreal const y) const {
+        qreal const gx = std::min(std::max((x - x_min) * x_scale, 0.), qreal(NX - 1));
+        qreal const gy = std::min(std::max((y - y_min) * y_scale, 0.), qreal(NY - 1));
+        int const ix = std::min(int(gx), NX - 2);
+        int const iy = std::min(int(gy), NY - 2);
+        qreal const fx = gx - ix;
+        qreal const fy = gy - iy;
+        qreal const* const p = values.data() + iy * NX + ix;
+        qreal const v0 = p[0] + fx * (p[1] - p[0]);
+        qreal const v1 = p[NX] + fx * (p[NX + 1] - p[NX]);
+        return v0 + fy * (v1 - v0);
+    }
+
+    std::array<qreal, NX * NY> values;
+    qreal x_min = 0;
+    qreal y_min = 0;
+    qreal x_scale = 1;
+    qreal y_scale = 1;
+};
+
+#endif // GRID2D_H
@@ -5,11 +5,55 @@
 #include <QTextStream>
 #include <QTime>
 #include <QPainter>
+#include <QPaintEngine>
+#include <QPixmap>
 #include <math.h>
 #include <array>
+#include <algorithm>
+
+// HudLayer is a static part of the hud (a dial, a background with its legend) rendered once into a QPixmap for the
+// scale of the painter (QHudWidget draws the hud scaled) and the device pixel ratio: drawing it is a blit.
+// another scale or ratio renders it again. no cache for painters that don't paint on pixels (e.g. svg)
+struct HudLayer {
+    // rect: the area of the layer around pos (relative), paint(QPainter&) draws the layer around (0,0)
+    template<typename Paint>
+    void draw(QPainter& painter, const QPointF pos, const QRectF& rect, Paint paint) {
+        const QPaintEngine* engine = painter.paintEngine();
+        const QTransform& t = painter.transform();
+        if (!painter.device() || (engine && (engine->type() == QPaintEngine::SVG || engine->type() == QPaintEngine::Pdf))
+                || t.type() > QTransform::TxScale) {
+            painter.save();
+            painter.translate(pos);
+            paint(painter);
+            painter.restore();
+            return;
+        }
+        const qreal scale = painter.device()->devicePixelRatioF() * std::max(fabs(t.m11()), fabs(t.m22()));
+        if (pixmap.isNull() || scale != this->scale) {
+            QImage image((rect.size() * scale).toSize() + QSize(1, 1), QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter p(&image);
+            p.setRenderHints(painter.renderHints());
+            p.scale(scale, scale);
+            p.translate(-rect.topLeft());
+            paint(p);
+            p.end();
+            pixmap = QPixmap::fromImage(image);
+            pixmap.setDevicePixelRatio(scale); // the size of rect in the coordinates of painter
+            this->scale = scale;
+        }
+        painter.drawPixmap(pos + rect.topLeft(), pixmap);
+    }
+    void clear() { pixmap = QPixmap(); }
+
+    QPixmap pixmap;
+    qreal scale = 0; // device pixels per unit of the painter the pixmap was rendered for
+};
 
 struct Speedometer {
 	void draw(QPainter& painter, const QPointF pos, const qreal kmh);
+    // the ticks, numbers and caption around (0,0)
+    void draw_dial(QPainter& painter);
 
     qreal max_speed() { return min_speed + speed_steps * speed_delta; }
 
@@ -19,6 +63,7 @@ struct Speedometer {
     int speed_delta = 20;
     int speed_steps = 10; // how many steps between min and max speed
     QString caption = "km/h";
+    HudLayer dial;
 };
 
 struct RevCounter : public Speedometer
@@ -46,6 +91,8 @@ struct ConsumptionDisplay {
         }
     }
 	void draw(QPainter& painter, QPointF pos, qreal consumption, bool draw_number = true);
+    // the background and the legend around (0,0)
+    void draw_background(QPainter& painter);
 
     // fonts for number, 'L/', 100kmh
 	QFont fonts[3]; //{ { "Eurostile", 18, QFont::Bold }, { "Eurostile", 12, QFont::Bold }, { "Eurostile", 8, QFont::Bold } };
@@ -55,6 +102,15 @@ struct ConsumptionDisplay {
     qreal font_heights[3];
 	std::array<QString, 2> legend = { { "L/", "100km" } };
     const char* const number_format;
+    HudLayer background;
+
+    // layout (relative to pos)
+    const qreal l2_x_offset = -3; // x-offset of 2nd part of legend
+    const qreal l2_y_offset = 2; // y-offset of 2nd part of legend (100km)
+    const qreal y_gap = 0; // gap between number and legend
+    const qreal rect_y_offset = 3;
+    const QSizeF rect_size{45, 33};
+    qreal text_height() const { return font_heights[0] + y_gap + font_heights[1] + std::max(l2_y_offset, 0.); }
 };
 
 
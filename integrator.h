@@ -0,0 +1,56 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <QtGlobal>
+#include <QDataStream>
+
+// Integrator decides how SimulationCore advances the physics (Car::tick):
+// either once per frame with the frame dt (legacy, logs < 1.9), or in fixed steps of 1/rate [s]
+// collected by an accumulator, so that the result doesn't depend on the frame rate.
+// the rendered position is interpolated between the last two fixed steps.
+struct Integrator
+{
+    enum Scheme {
+        // the original model: forces from the state at the beginning of the step,
+        // position and (with engaged clutch) engine speed from the already updated speed
+        SemiImplicitEuler = 0,
+        RK4 = 1, // classic Runge-Kutta for speed and engine speed
+    };
+
+    // how logs < 1.9 were recorded (and have to be replayed)
+    static Integrator legacy() {
+        Integrator i;
+        i.fixed_step = false;
+        i.scheme = SemiImplicitEuler;
+        return i;
+    }
+
+    qreal step() const { return 1. / rate; }
+
+    static const char* scheme_name(const Scheme scheme) {
+        switch (scheme) {
+            case SemiImplicitEuler: return "SemiImplicitEuler";
+            case RK4: return "RK4";
+        }
+        Q_ASSERT(false);
+        return "";
+    }
+
+    bool fixed_step = true;
+    qreal rate = 1000; // [Hz] physics steps per second (fixed_step only)
+    Scheme scheme = SemiImplicitEuler;
+    qreal max_frame_dt = 0.25; // [s] longer frames are cut, in time and physics (fixed_step only, keeps a stalled frame from freezing the simulation)
+};
+
+inline QDataStream &operator<<(QDataStream &out, const Integrator &i)
+{
+    out << i.fixed_step << i.rate << (int) i.scheme << i.max_frame_dt;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, Integrator &i) {
+    in >> i.fixed_step >> i.rate >> (int&) i.scheme >> i.max_frame_dt;
+    return in;
+}
+
+#endif // INTEGRATOR_H
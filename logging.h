@@ -3,13 +3,15 @@
 
 #include <QList>
 #include <QVector>
+#include <QJsonArray>
 #include "car.h"
-#include "qcarviz.h"
+#include "simulation_core.h"
 #include "track.h"
 #include "misc.h"
+#include "frame_timing.h"
 
-#define LOG_VERSION "1.8"
-#define LOG_VERSION_JSON "1.3"
+#define LOG_VERSION "2.2"
+#define LOG_VERSION_JSON "1.6"
 
 struct LogItem
 {
@@ -89,11 +91,11 @@ struct Fedi_volume_item {
 
 struct Log
 {
-    Log(Car* car, QCarViz* car_viz, Track* track) : car(car), car_viz(car_viz), track(track) {}
+    Log(Car* car, SimulationCore* core, Track* track) : car(car), core(core), track(track) {}
 
     void add_item(qreal throttle, qreal braking, int gear, qreal dt) {
-        //qDebug() << "eye tracking: " << car_viz->get_eye_tracker_point();
-        items.append({ throttle, braking, gear, car_viz->get_eye_tracker_point(), car_viz->get_user_steering(), dt });
+        //qDebug() << "eye tracking: " << core->get_eye_tracker_point();
+        items.append({ throttle, braking, gear, core->get_eye_tracker_point(), core->get_user_steering(), dt });
     }
     void add_event(const LogEvent::Type type) {
         events.push_back({type, items.size()}); // we exepect the events to come in *before* the add_item!
@@ -132,12 +134,28 @@ struct Log
         j["global_run_counter"] = global_run_counter;
         j["run"] = run;
         j["elapsed_time"] = elapsed_time;
+        j["integrator_scheme"] = Integrator::scheme_name(integrator.scheme);
+        j["integrator_rate"] = integrator.fixed_step ? integrator.rate : 0;
         j["liters_used"] = liters_used;
         j["vp_id"] = vp_id;
+        j["seed"] = (qint64) seed;
         if (has_window_size) {
             j["window_size_width"] = window_size.width();
             j["window_size_height"] = window_size.height();
         }
+        if (frame_timing.frames > 0) {
+            QJsonObject jt;
+            jt["frames"] = frame_timing.frames;
+            jt["dropped"] = frame_timing.dropped;
+            jt["refresh_interval"] = frame_timing.refresh_interval;
+            jt["p50"] = frame_timing.p50;
+            jt["p95"] = frame_timing.p95;
+            jt["p99"] = frame_timing.p99;
+            jt["max"] = frame_timing.max;
+            for (int i = 0; i < __FrameSection_length; i++)
+                jt[QString("mean_") + frame_section_name((FrameSection) i)] = frame_timing.section_mean[i];
+            j["frame_timing"] = jt;
+        }
         QJsonArray jitems;
         for (auto i : items_json) {
             QJsonObject ji;
@@ -155,7 +173,7 @@ struct Log
     }
 
     Car* car;
-    QCarViz* car_viz;
+    SimulationCore* core;
     Track* track;
     QList<LogItem> items;
     QVector<LogEvent> events;
@@ -165,8 +183,11 @@ struct Log
     int sound_modus = 0;
     Condition condition = VIS; // this should be the same as sound_modus!
     qreal initial_angular_velocity = 0;
+    Integrator integrator = Integrator::legacy(); // how the physics was stepped (logs < 1.9: legacy)
     QSize window_size;
     bool has_window_size = false;
+    FrameTimingSummary frame_timing; // how smooth the run was drawn [ms] (logs < 2.0, replays: no frames)
+    quint32 seed = 0; // of the random numbers of the core (traffic light phases), logs < 2.1: 0
 
     int vp_id = 1001;
     int run = 1;
@@ -200,7 +221,8 @@ inline QDataStream &operator>>(QDataStream &in, LogEvent &e) {
 inline QDataStream &operator<<(QDataStream &out, const Log &log) {
     out << QString(LOG_VERSION) << *log.car << *log.track << log.items << log.events << log.elapsed_time << log.liters_used
         << log.sound_modus << log.initial_angular_velocity << (int) log.condition << log.vp_id << log.run << log.global_run_counter
-        << log.window_size;
+        << log.window_size << log.integrator << log.frame_timing << log.seed;
+    log.car->engine.consumption_map.write_measured(out);
     return out;
 }
 inline QDataStream &operator>>(QDataStream &in, Log &log) {
@@ -212,12 +234,27 @@ inline QDataStream &operator>>(QDataStream &in, Log &log) {
         log.has_window_size = true;
     } else
         log.has_window_size = false;
+    if (log.version.toDouble() >= 1.9)
+        in >> log.integrator;
+    else
+        log.integrator = Integrator::legacy();
+    if (log.version.toDouble() >= 2.0)
+        in >> log.frame_timing;
+    else
+        log.frame_timing = FrameTimingSummary();
+    if (log.version.toDouble() >= 2.1)
+        in >> log.seed;
+    else
+        log.seed = 0;
+    // (the car was read with the ellipse map)
+    if (log.version.toDouble() >= 2.2)
+        log.car->engine.consumption_map.read_measured(in);
     log.condition = (Condition) condition;
     if (condition != log.sound_modus) {
         qDebug() << "WARNING: log.condition (" << log.condition << ") != log.sound_modus (" << log.sound_modus << ")";
     }
     log.valid = (log.version == QString(LOG_VERSION)
-                 || (log.version.toDouble() == 1.7 && QString(LOG_VERSION).toDouble() == 1.8));
+                 || (log.version.toDouble() >= 1.7 && log.version.toDouble() < QString(LOG_VERSION).toDouble()));
     if (log.events.size() > 0)
         log.next_log_event = &log.events[0];
     log.log_run_finished = false;
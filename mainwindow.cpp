@@ -5,7 +5,6 @@
 #include "engine.h"
 #include "Profiler.hh"
 
-Track::Images Track::images;
 profiler::ProfilerExclusive gProfilerE;
 
 void plot_torque_map(QCustomPlot* plot, Engine& engine)
@@ -29,26 +28,26 @@ void plot_torque_map(QCustomPlot* plot, Engine& engine)
     plot->replot();
 }
 
-void plot_rpm2torque(StaticMap& plot, Car& car) {
+// rel_rpm, throttle: the current values (the torque map of the engine is not changed by the simulation)
+void plot_rpm2torque(StaticMap& plot, const Engine& engine, const qreal throttle, const qreal rel_rpm) {
     QCPDataMap& data = *plot.plot.graph()->data();
     for (int i = 0; i < plot.x_values.size(); i++) {
         qreal const x = plot.x_values[i];
-        data[x].value = car.engine.torque_map.get_torque(car.throttle, x);
+        data[x].value = engine.torque_map.get_torque(throttle, x);
     }
     plot.plot.graph(0)->clearData();
-    plot.plot.graph(0)->addData(car.engine.rel_rpm(), car.engine.torque_map.get_torque(car.throttle, car.engine.rel_rpm()));
+    plot.plot.graph(0)->addData(rel_rpm, engine.torque_map.get_torque(throttle, rel_rpm));
     plot.plot.replot();
 }
 
-void plot_throttle2torque(StaticMap& plot, Car& car) {
+void plot_throttle2torque(StaticMap& plot, const Engine& engine, const qreal throttle, const qreal rel_rpm) {
     QCPDataMap& data = *plot.plot.graph()->data();
-    qreal engine_rpm = car.engine.rpm();
     for (int i = 0; i < plot.x_values.size(); i++) {
         qreal const x = plot.x_values[i];
-        data[x].value = car.engine.torque_map.get_torque(x, engine_rpm / car.engine.max_rpm);
+        data[x].value = engine.torque_map.get_torque(x, rel_rpm);
     }
     plot.plot.graph(0)->clearData();
-    plot.plot.graph(0)->addData(car.throttle, car.engine.torque_map.get_torque(car.throttle, car.engine.rel_rpm()));
+    plot.plot.graph(0)->addData(throttle, engine.torque_map.get_torque(throttle, rel_rpm));
     plot.plot.replot();
 }
 
@@ -64,7 +63,7 @@ void setup_plot(QCustomPlot* plot, QString xLabel, QString yLabel) {
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , car(&osc)
+    , core(&osc)
     , timer(this)
 {
     ui->setupUi(this);
@@ -80,17 +79,18 @@ MainWindow::MainWindow(QWidget *parent)
                            ui->track_tl_distance, ui->lbl_min_time, ui->lbl_max_time, ui->lbl_distance,
                            ui->steer_intensity, ui->steer_time, ui->steer_fade_in, ui->steer_fade_out,
                            ui->lbl_steer_intensity, ui->lbl_steer_time, ui->lbl_steer_fade_in, ui->lbl_steer_fade_out);
-    ui->car_viz->init(&car, ui->start, ui->eyetracker, ui->vp_id, ui->current_condition, ui->next_condition, ui->intro_run,
+    ui->car_viz->init(&core, ui->start, ui->eyetracker, ui->vp_id, ui->current_condition, ui->next_condition, ui->intro_run,
                       ui->run, ui->throttle, ui->breaking, ui->gear, this, &osc);
     QObject::connect(ui->car_viz, SIGNAL(slow_tick(qreal,qreal, ConsumptionMonitor&)),
                      this, SLOT(update_plots(qreal,qreal,ConsumptionMonitor&)));
-    QObject::connect(&car.gearbox, &Gearbox::gear_changed, [=](int gear){
+    // queued if the simulation thread changes the gear
+    QObject::connect(&core.car.gearbox, &Gearbox::gear_changed, this, [=](int gear){
         ui->gear->setValue(gear+1);
         osc.send_float("/gear", gear+1);
     });
 
 #if 0
-    plot_torque_map(ui->plot_speed, car.engine);
+    plot_torque_map(ui->plot_speed, core.car.engine);
 #else
     //setup plots
     setup_plot(ui->plot_speed, "time", "speed [kmh]");
@@ -139,30 +139,39 @@ void add_plot_value(QCustomPlot* plot, qreal t, qreal y) {
 
 }
 
-void MainWindow::update_plots(qreal, qreal elapsed, ConsumptionMonitor& consumption_monitor) {
+void MainWindow::update_plots(qreal, qreal elapsed, ConsumptionMonitor&) {
     const qreal t = elapsed;
-    add_plot_value(ui->plot_speed, t, car.gearbox.speed2kmh(car.speed));
-    add_plot_value(ui->plot_rpm, t, car.engine.rpm());
-    add_plot_value(ui->plot_acceleration, t, car.current_acceleration);
-    add_plot_value(ui->plot_resistance, t, car.current_accumulated_resistance);
-    add_plot_value(ui->plot_power, t, car.engine.power_output());
-    add_plot_value(ui->plot_consumption, t, car.engine.get_consumption_L_s());
-    add_plot_value(ui->plot_liters, t, std::min(40., car.engine.get_l100km(car.speed)));
-    plot_rpm2torque(*rpm2torque, car);
-    plot_throttle2torque(*throttle2torque, car);
+    Car& car = core.car;
+    // the values of the running simulation, the plots are drawn after releasing it again
+    QMutexLocker lock(&ui->car_viz->core_mutex());
+    const qreal kmh = car.gearbox.speed2kmh(car.speed);
+    const qreal rpm = car.engine.rpm();
+    const qreal rel_rpm = car.engine.rel_rpm();
+    const qreal acceleration = car.current_acceleration;
+    const qreal resistance = car.current_accumulated_resistance;
+    const qreal power = car.engine.power_output();
+    const qreal consumption = car.engine.get_consumption_L_s();
+    const qreal l100km = car.engine.get_l100km(car.speed);
+    const qreal throttle = car.throttle;
 
     // update from user input
     car.gearbox.set_gear(ui->gear->value() - 1);
     //car.gearbox.auto_clutch_control(car.engine, dt);
     //ui->clutch->setValue(car.gearbox.clutch * 100);
     //car.gearbox.clutch = ui->clutch->value() / 100.;
-
-    // update sound parameters
-    osc.send_float("/rpm", 0.1 + car.engine.rel_rpm() * 0.8);
-    //osc.send_float("/throttle", car.throttle);
-    osc.send_float("/ml_sec", consumption_monitor.liters_per_second_cont * 1000);
-    osc.send_float("/L_100km", consumption_monitor.liters_per_100km_cont);
-
+    lock.unlock();
+
+    add_plot_value(ui->plot_speed, t, kmh);
+    add_plot_value(ui->plot_rpm, t, rpm);
+    add_plot_value(ui->plot_acceleration, t, acceleration);
+    add_plot_value(ui->plot_resistance, t, resistance);
+    add_plot_value(ui->plot_power, t, power);
+    add_plot_value(ui->plot_consumption, t, consumption);
+    add_plot_value(ui->plot_liters, t, std::min(40., l100km));
+    plot_rpm2torque(*rpm2torque, car.engine, throttle, rel_rpm);
+    plot_throttle2torque(*throttle2torque, car.engine, throttle, rel_rpm);
+
+    // the sound parameters are sent by the simulation thread (SimulationThread::send_parameters)
 }
 
 void MainWindow::on_tabWidget_currentChanged(int index)
@@ -309,15 +318,28 @@ void MainWindow::on_intro_run_stateChanged(int checked)
 {
     qDebug() << "check state:" << (ui->intro_run->checkState() == Qt::Checked);
     if (!checked) {
-        ui->car_viz->track.load();
-        ui->car_viz->update_track_path(ui->car_viz->height());
+        ui->car_viz->stop();
+        ui->car_viz->load_track();
         ui->car_viz->reset();
         ui->car_viz->set_condition_order(ui->vp_id->value() % 1000);
     } else {
         ui->car_viz->stop();
-        ui->car_viz->track.load("tracks/intro_track.bin");
-        ui->car_viz->update_track_path(ui->car_viz->height());
+        ui->car_viz->load_track("tracks/intro_track.bin");
         ui->car_viz->reset();
         ui->car_viz->set_sound_modus(0);
     }
 }
+
+void MainWindow::on_actionLoad_Consumption_Map_triggered()
+{
+    ui->car_viz->stop();
+    const QString filename = QFileDialog::getOpenFileName(this, "Load Consumption Map", "", "BSFC Maps (*.csv)");
+    if (filename.isEmpty())
+        return;
+    QMutexLocker lock(&ui->car_viz->core_mutex());
+    // for the next runs (and stored in their logs)
+    if (!core.car.engine.load_bsfc_csv(filename))
+        QMessageBox::warning(this, "EcoSonic", "Can't load the consumption map " + filename);
+    else
+        qDebug() << "consumption map:" << filename << "base consumption:" << core.car.engine.base_consumption << "g/kWh";
+}
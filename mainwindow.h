@@ -4,7 +4,7 @@
 #include <QMainWindow>
 #include <QTimer>
 
-#include "car.h"
+#include "simulation_core.h"
 
 #include <lib/qcustomplot/qcustomplot.h>
 #include "OSCSender.h"
@@ -76,13 +76,15 @@ private slots:
 
     void on_intro_run_stateChanged(int checked);
 
+    void on_actionLoad_Consumption_Map_triggered();
+
 protected:
     void convert_log(const QString &filename, const bool overwrite);
     void convert_log_directory(const QDir& dir, const bool overwrite);
 
 private:
     Ui::MainWindow *ui;
-    Car car;
+    SimulationCore core;
     QTimer timer;
     OSCSender osc;
     std::auto_ptr<StaticMap> rpm2torque, throttle2torque;
@@ -0,0 +1,231 @@
+#include "min_speed_profile.h"
+#include "track_file.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+    #define MIN_SPEED_PROFILE_SIMD
+#endif
+
+QString MinSpeedProfile::cache_dir = "tracks/cache";
+
+namespace {
+
+const quint32 CACHE_MAGIC = 0x4d535031; // "MSP1"
+const quint32 BUILD_VERSION = 1; // increment when build() changes (invalidates the cache files)
+
+#ifdef MIN_SPEED_PROFILE_SIMD
+static_assert(sizeof(qreal) == sizeof(double), "the SIMD kernels expect qreal to be double");
+
+#ifdef __AVX2__
+typedef __m256d vec;
+const int lanes = 4;
+inline vec load(const double* p) { return _mm256_loadu_pd(p); }
+inline void store(double* p, const vec v) { _mm256_storeu_pd(p, v); }
+inline vec set1(const double x) { return _mm256_set1_pd(x); }
+inline vec indices() { return _mm256_setr_pd(0, 1, 2, 3); }
+inline vec add(const vec a, const vec b) { return _mm256_add_pd(a, b); }
+inline vec mul(const vec a, const vec b) { return _mm256_mul_pd(a, b); }
+inline vec eq(const vec a, const vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+inline vec lt(const vec a, const vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline vec or_(const vec a, const vec b) { return _mm256_or_pd(a, b); }
+inline vec select(const vec mask, const vec a, const vec b) { return _mm256_blendv_pd(b, a, mask); } // mask ? a : b
+#else
+typedef __m128d vec;
+const int lanes = 2;
+inline vec load(const double* p) { return _mm_loadu_pd(p); }
+inline void store(double* p, const vec v) { _mm_storeu_pd(p, v); }
+inline vec set1(const double x) { return _mm_set1_pd(x); }
+inline vec indices() { return _mm_setr_pd(0, 1); }
+inline vec add(const vec a, const vec b) { return _mm_add_pd(a, b); }
+inline vec mul(const vec a, const vec b) { return _mm_mul_pd(a, b); }
+inline vec eq(const vec a, const vec b) { return _mm_cmpeq_pd(a, b); }
+inline vec lt(const vec a, const vec b) { return _mm_cmplt_pd(a, b); }
+inline vec or_(const vec a, const vec b) { return _mm_or_pd(a, b); }
+inline vec select(const vec mask, const vec a, const vec b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+#endif
+#else
+const int lanes = 1;
+#endif
+
+// values[i] = base + i * slope where that is lower (or values[i] not set yet)
+struct RampKernel {
+    qreal* values;
+    qreal base, slope;
+
+    inline void scalar(const int i) const {
+        const qreal speed = base + i * slope;
+        qreal& v = values[i];
+        if (!v || speed < v)
+            v = speed;
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef MIN_SPEED_PROFILE_SIMD
+        const vec v_base = set1(base), v_slope = set1(slope), zero = set1(0), step = set1(lanes);
+        vec index = indices();
+        for ( ; i + lanes <= n; i += lanes) {
+            const vec speed = add(v_base, mul(index, v_slope));
+            const vec v = load(values + i);
+            store(values + i, select(or_(eq(v, zero), lt(speed, v)), speed, v));
+            index = add(index, step);
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+// speed on [from, to]
+inline void fill(QVector<qreal>& values, const int from, const int to, const qreal speed)
+{
+    if (to >= from)
+        RampKernel{ values.data() + from, speed, 0 }.run(to - from + 1);
+}
+// start + inc at from, increasing by inc up to to
+inline void ramp_up(QVector<qreal>& values, const int from, const int to, const qreal start, const qreal inc)
+{
+    if (to >= from)
+        RampKernel{ values.data() + from, start + inc, inc }.run(to - from + 1);
+}
+// start + inc at to, increasing by inc down to from
+inline void ramp_down(QVector<qreal>& values, const int from, const int to, const qreal start, const qreal inc)
+{
+    const int n = to - from + 1;
+    if (n > 0)
+        RampKernel{ values.data() + from, start + n * inc, -inc }.run(n);
+}
+
+} // namespace
+
+QByteArray MinSpeedProfile::hash(const Track& track, const qreal length, const qreal track_mult)
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << BUILD_VERSION << length << track_mult;
+    for (const Track::Sign& s : track.signs) {
+        if (s.is_speed_sign() || s.type == Track::Sign::Stop || s.type == Track::Sign::TrafficLight)
+            out << (int) s.type << s.at_length;
+    }
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+void MinSpeedProfile::update(const Track& track, const qreal length)
+{
+    const QByteArray track_key = hash(track, length, track_mult);
+    if (track_key == key)
+        return;
+    key = track_key;
+    file.reset();
+    if (track.file && track.file->min_speed_key() == key && track.file->count(TrackFile::MinSpeedSection)) {
+        file = track.file;
+        data = file->min_speed();
+        count = file->count(TrackFile::MinSpeedSection);
+        values.clear();
+        return;
+    }
+    const QString filename = cache_dir.isEmpty() ? QString()
+                                                 : QDir(cache_dir).filePath("min_speed_" + key.toHex() + ".bin");
+    if (filename.isEmpty() || !load(filename)) {
+        build(track, length);
+        if (!filename.isEmpty() && !save(filename))
+            qDebug() << "MinSpeedProfile: can't write" << filename;
+    }
+    data = values.constData();
+    count = values.size();
+}
+
+void MinSpeedProfile::build(const Track& track, const qreal length)
+{
+    const qreal track_length = length * track_mult;
+    const int last = (int) track_length;
+    values.fill(0, last + 5);
+
+    const Track::Sign first(Track::Sign::Speed130, 10);
+    QVector<const Track::Sign*> speed_signs, stop_signs; // (sorted by prepare_track)
+    speed_signs.push_back(&first);
+    for (const Track::Sign& s : track.signs) {
+        if (s.is_speed_sign())
+            speed_signs.push_back(&s);
+        else if (s.type == Track::Sign::Stop || s.type == Track::Sign::TrafficLight)
+            stop_signs.push_back(&s);
+    }
+
+    // the speed limits, ramps from lower previous limits and to lower next limits
+    qreal max_limit = 0;
+    for (int i = 0; i < speed_signs.size(); i++) {
+        const Track::Sign* const cur = speed_signs[i];
+        const Track::Sign* const prev = !i ? nullptr : speed_signs[i-1];
+        const Track::Sign* const next = i+1 >= speed_signs.size() ? nullptr : speed_signs[i+1];
+        const int start = (int) ceil(cur->at_length * track_mult);
+        const int end = std::min((int) floor(next ? next->at_length * track_mult : track_length), values.size() - 1);
+        const qreal limit = honk_limit(cur->speed_limit());
+        const qreal prev_limit = prev ? honk_limit(prev->speed_limit()) : 200;
+        const qreal next_limit = next ? honk_limit(next->speed_limit()) : limit;
+        max_limit = std::max(max_limit, limit);
+
+        fill(values, start, end, limit);
+        // the ramps end where they pass the limit
+        if (prev_limit < limit) {
+            const qreal inc = TOOSLOW_OBSERVER_ACCELERATION / track_mult;
+            const int n = std::min(end - start + 1, (int) ((limit - prev_limit) / inc) + 2);
+            ramp_up(values, start, start + n - 1, prev_limit, inc);
+        }
+        if (next_limit < limit) {
+            const qreal inc = TOOSLOW_OBSERVER_SLOWING_DOWN / track_mult;
+            const int n = std::min(end - start, (int) ((limit - next_limit) / inc) + 2);
+            ramp_down(values, end - n, end - 1, next_limit, inc);
+        }
+    }
+    fill(values, 0, std::min((int) (50 * track_mult), values.size() - 1), -1);
+
+    // from here on every value up to last is set, ramps above max_limit change nothing
+    insert_stop_sign(40, last, max_limit);
+    for (const Track::Sign* const s : stop_signs)
+        insert_stop_sign((int) s->at_length, last, max_limit);
+}
+
+void MinSpeedProfile::insert_stop_sign(const int pos, const int track_length, const qreal max_limit)
+{
+    const int left = boost::algorithm::clamp((pos - 100) * track_mult, 0, track_length);
+    const int right = boost::algorithm::clamp((pos + 25) * track_mult, 0, track_length);
+    fill(values, left + 1, right - 1, -1);
+    qreal inc = TOOSLOW_OBSERVER_SLOWING_DOWN / track_mult;
+    int n = std::min(left + 1, (int) (max_limit / inc) + 2);
+    ramp_down(values, left - n + 1, left, 0, inc);
+    inc = TOOSLOW_OBSERVER_ACCELERATION / track_mult;
+    n = std::min(track_length - right + 1, (int) (max_limit / inc) + 2);
+    ramp_up(values, right, right + n - 1, 0, inc);
+}
+
+bool MinSpeedProfile::load(const QString& filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&file);
+    quint32 magic;
+    QByteArray file_key;
+    QVector<qreal> file_values;
+    in >> magic >> file_key >> file_values;
+    if (in.status() != QDataStream::Ok || magic != CACHE_MAGIC || file_key != key || file_values.isEmpty())
+        return false;
+    values.swap(file_values);
+    return true;
+}
+
+bool MinSpeedProfile::save(const QString& filename) const
+{
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+    QSaveFile file(filename); // other processes may read the same file
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&file);
+    out << CACHE_MAGIC << key << values;
+    return file.commit();
+}
@@ -0,0 +1,62 @@
+#ifndef MIN_SPEED_PROFILE_H
+#define MIN_SPEED_PROFILE_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include <boost/algorithm/clamp.hpp>
+#include <memory>
+#include "track.h"
+
+#define TOO_SLOW_TOLERANCE 0.1 // percent of current speed
+#define TOO_SLOW_TOLERANCE_OFFSET 10 // kmh offset
+#define TOOSLOW_OBSERVER_ACCELERATION 0.1 // kmh per "track_path unit"
+#define TOOSLOW_OBSERVER_SLOWING_DOWN 0.05
+
+// MinSpeedProfile is the speed [km/h] below which the TooSlowObserver honks, along the track path: the speed limits
+// (minus a tolerance) with ramps between them, -1 (never) at the start and around stop signs and traffic lights.
+// it only depends on the length of the track path and the signs, so it is built once per track (with vectorized
+// ramp kernels) and kept in a binary cache file per track (key: hash of what it depends on). a track loaded from
+// a v2 TrackFile has it baked in, it is used in place from the mapped file
+class MinSpeedProfile
+{
+public:
+    static QString cache_dir; // tracks/cache, empty: no cache files
+
+    // makes it the profile of track (length: of the track path). nothing to do if it already is
+    void update(const Track& track, const qreal length);
+
+    // interpolated at pos (on the track path)
+    inline qreal at(qreal pos) const {
+        pos *= track_mult;
+        const int p1 = boost::algorithm::clamp((int) floor(pos), 0, count - 1);
+        const int p2 = boost::algorithm::clamp((int) ceil(pos), 0, count - 1);
+        const qreal v = pos - floor(pos);
+        return v * data[p2] + (1-v) * data[p1];
+    }
+    const qreal* get_values() const { return data; }
+    int size() const { return count; }
+    const QByteArray& get_key() const { return key; }
+
+    static inline qreal honk_limit(qreal l) {
+        return l * (1-TOO_SLOW_TOLERANCE) - TOO_SLOW_TOLERANCE_OFFSET;
+    }
+
+    const qreal track_mult = 0.5; // (pos * track_mult) is the index in values
+                                  // the bigger track_mult is, the more precise (and slow) the calculation is
+protected:
+    static QByteArray hash(const Track& track, const qreal length, const qreal track_mult);
+    void build(const Track& track, const qreal length);
+    bool load(const QString& filename);
+    bool save(const QString& filename) const;
+    // -1 from 100 units before to 25 units after pos, ramps to the rest of the track
+    void insert_stop_sign(const int pos, const int track_length, const qreal max_limit);
+
+    QVector<qreal> values; // 0: not set yet
+    const qreal* data = nullptr; // values or mapped from the TrackFile of the track
+    int count = 0;
+    std::shared_ptr<const TrackFile> file; // data is mapped from
+    QByteArray key; // of the track data belongs to
+};
+
+#endif // MIN_SPEED_PROFILE_H
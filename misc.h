@@ -33,7 +33,7 @@ bool loadObj(const QString filename, T& obj) {
 template<class T>
 bool saveJson(const QString filename, const T& obj, bool compressed = true) {
     Q_ASSERT(!compressed || filename.endsWith(".zip"));
-    const QString log_filename = filename.left(filename.length()-4);
+    const QString log_filename = compressed ? filename.left(filename.length()-4) : filename; // without .zip
     QFile file(log_filename);
     QDir().mkpath(QFileInfo(file).absolutePath());
     if (!file.open(QIODevice::WriteOnly)) {
@@ -53,6 +53,17 @@ bool saveJson(const QString filename, const T& obj, bool compressed = true) {
     }
     return true;
 }
+template<class T>
+bool loadJson(const QString filename, T& obj) { // uncompressed
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject())
+        return false;
+    obj.read(doc.object());
+    return true;
+}
 
 
 struct FPSTimer {
@@ -1,14 +1,14 @@
 #include "stdafx.h"
 #include "qcarviz.h"
-#include "speed_observer.h"
+#include <QScreen>
+#include <QWindow>
+#include <QGuiApplication>
 #include "logging.h"
 #include "Profiler.hh"
 
 using profiler::ProfilerExclusive;
 extern ProfilerExclusive gProfilerE;
 
-#define DRAW_ARROW_SIGN 3 // 0: simple arrow 1: arrow sign 2: "street"-arrow 3: curved "street"-arrow
-
 void EyeTrackerClient::read()
 {
     if (first_read) {
@@ -41,28 +41,26 @@ QCarViz::QCarViz(QWidget *parent)
     p.setColor(backgroundRole(), Qt::white);
     setPalette(p);
     flash_timer.start();
+    frame_clock.start();
 
     qDebug() << QDir::currentPath();
 
-    add_tree_type("tree", 0.2/3, 50*3);
-    add_tree_type("birch", 0.08, 140);
-    add_tree_type("spooky_tree", 0.06, 120);
-
-    car_img.load("media/cars/car.png");
-    turn_sign.reset(new QSvgRenderer(QString("media/turn_sign.svg")));
-    turn_sign_rect = QRectF(QPointF(0, 0), 0.03 * turn_sign->defaultSize());
-    track.load();
-    update_track_path(height());
-    fill_trees();
-    tick_timer.setInterval(30); // minimum simulation interval
+    tick_timer.setInterval(10); // input latency
     QObject::connect(&tick_timer, SIGNAL(timeout()), this, SLOT(tick()));
     tick_timer.start();
+    QObject::connect(&simulation, &SimulationThread::run_finished, this, &QCarViz::finish_run);
+    QObject::connect(&simulation, &SimulationThread::replay_finished, this, &QCarViz::finish_replay);
 }
 
-void QCarViz::init(Car* car, QPushButton* start_button, QCheckBox* eye_tracker_connected_checkbox, QSpinBox* vp_id, QComboBox* current_condition, QComboBox* next_condition, QCheckBox *intro_run,
+void QCarViz::init(SimulationCore* core, QPushButton* start_button, QCheckBox* eye_tracker_connected_checkbox, QSpinBox* vp_id, QComboBox* current_condition, QComboBox* next_condition, QCheckBox *intro_run,
                    QSpinBox *run, QSlider* throttle, QSlider* breaking, QSpinBox* gear, QMainWindow* main_window, OSCSender* osc, bool start)
 {
-    this->car = car;
+    this->core = core;
+    this->car = &core->car;
+    core->set_listener(this);
+    simulation.set_core(core);
+    load_track();
+    simulation.start(QThread::TimeCriticalPriority);
     this->start_button = start_button;
     eye_tracker_connected_checkbox_ = eye_tracker_connected_checkbox;
     vp_id_ = vp_id;
@@ -74,18 +72,10 @@ void QCarViz::init(Car* car, QPushButton* start_button, QCheckBox* eye_tracker_c
     breaking_slider = breaking;
     gear_spinbox = gear;
 
-	turnSignObserver = new SignObserver<TurnSignObserver>(*this);
-	signObserver.push_back(turnSignObserver);
-    signObserver.push_back(new SignObserver<StopSignObserver>(*this));
-    signObserver.push_back(new SignObserver<TrafficLightObserver>(*this));
-    signObserver.push_back(new SignObserver<SpeedObserver>(*this));
-    //speedObserver.reset(new SpeedObserver(*this, *osc));
-    tooslow_observer_.reset(new TooSlowObserver(*this, *osc));
-
     QObject::connect(start_button, SIGNAL(clicked()),
                      this, SLOT(start_stop()));
     keyboard_input.init(main_window);
-    consumption_monitor.osc = osc;
+    core->set_osc(osc);
     this->osc = osc;
 
     program_start_time = QDateTime::currentDateTime();
@@ -99,21 +89,14 @@ void QCarViz::init(Car* car, QPushButton* start_button, QCheckBox* eye_tracker_c
 
 void QCarViz::copy_from_track_editor(QTrackEditor* track_editor)
 {
-    track = track_editor->track;
+    QMutexLocker lock(&simulation.core_mutex());
+    core->track = track_editor->track;
     prepare_track();
 }
 
-void QCarViz::log_traffic_violation(const TrafficViolation violation)
-{
-    if (!replay) {
-        show_traffic_violation(violation);
-        car->log->add_event((LogEvent::Type) violation); // careful! (casting..)
-    }
-}
-
+// called in the simulation thread
 void QCarViz::show_traffic_violation(const TrafficViolation violation) {
     osc->send_float("/flash", 0);
-    flash_timer.start();
     QString hint;
     switch (violation) {
 #ifdef GERMAN
@@ -126,49 +109,23 @@ void QCarViz::show_traffic_violation(const TrafficViolation violation) {
         case TrafficLight: hint = "You didn't stop for the red traffic light!"; break;
 #endif
     }
-    text_hint.showText(hint);
+    QMetaObject::invokeMethod(this, "show_hint", Qt::QueuedConnection, Q_ARG(QString, hint), Q_ARG(bool, true));
 }
 
 
-void QCarViz::trigger_arrow()
-{
-    std::uniform_int_distribution<int> dir(0,1);
-    std::uniform_real_distribution<qreal> intensity(0.3, 1);
-    std::uniform_real_distribution<qreal> duration(0.8, 1.5);
-    std::uniform_real_distribution<qreal> fade_in(0.05, 0.5);
-    std::uniform_real_distribution<qreal> fade_out(0.05, 0.5);
-    static Track::Sign sign;
-    sign = Track::Sign(!dir(rng) ? Track::Sign::TurnLeft : Track::Sign::TurnRight, 0);
-    Q_ASSERT(turnSignObserver != nullptr);
-    turnSignObserver->trigger(&sign, time_elapsed());
-}
-
 void QCarViz::log_run()
 {
-       car->log->items_json.resize(car->log->items.size());
-       log_run_ = true;
-       start();
-       while (tick()) {
-            ;
-       }
-       log_run_ = false;
-       car->log->log_run_finished = true;
+    QMutexLocker lock(&simulation.core_mutex());
+    core->log_run();
+    simulation.publish();
+    update();
 }
 
 void QCarViz::reset() {
-    current_pos = initial_pos;
-    steering = 0;
-    car->reset(replay);
-    consumption_monitor.reset();
-    if (!replay)
-        track_started = false;
-    for (Track::Sign& s : track.signs) {
-        if (s.type == Track::Sign::TrafficLight)
-            s.traffic_light_state = Track::Sign::Red;
-    }
-    for (auto o : signObserver)
-        o->reset();
-    tooslow_observer_->reset();
+    QMutexLocker lock(&simulation.core_mutex());
+    core->reset();
+    simulation.publish();
+    reset_frame_timing();
     update();
 }
 
@@ -177,10 +134,15 @@ void QCarViz::start()
     if (end_of_run_messagebox_ != nullptr)
         end_of_run_messagebox_->close();
 
-    qDebug() << "track path length" << track_path.length();
+    qDebug() << "track path length" << scene.get_track_tiles().length();
 
-    if (current_pos >= track_path.length()) {
-        if (!replay) {
+    bool finished;
+    {
+        QMutexLocker lock(&simulation.core_mutex());
+        finished = core->current_pos >= core->track_tiles.length();
+    }
+    if (finished) {
+        if (!core->replay) {
             const int run = run_->value();
             if (run >= CAR_VIZ_MAX_RUNS) {
                 const int next_condition = next_condition_->currentIndex();
@@ -206,8 +168,10 @@ void QCarViz::start()
         }
         reset();
     }
-    time_delta.start();
+    if (!frame_stats.frames())
+        reset_frame_timing(); // (again) for the screen the window is on now
     started = true;
+    simulation.set_running(true);
     osc->call("/startEngine");
     toggle_fedi(true);
     start_button->setText("Pause");
@@ -222,53 +186,63 @@ void QCarViz::start()
 }
 
 bool QCarViz::load_log(const QString filename, const bool start) {
-    std::shared_ptr<Log>& log = car->log;
-    log.reset(new Log(car, this, &track));
-    const bool ret = misc::loadObj(filename, *log);
-    if (ret) {
-        if (!log->valid) {
-            qDebug() << "wrong version!";
-            //printf("wrong version!\n");
-            return false;
-        }
-        qDebug() << "log: elapsed_time:" << log->elapsed_time;
-        qDebug() << "log: deciliters_used:" << log->liters_used * 10;
-//        printf("log: items: %i\n", log->items.size());
-        prepare_track();
-        track.saveJSON();
-        track.save();
-        replay = true;
-        replay_index = 0;
-        track_started = true;
-        track_started_time = time_delta.get_elapsed();
-        time_delta_replay = time_delta;
-        car->engine.angular_velocity = log->initial_angular_velocity;
-        printf("log: initial rpm: %.3f\n", car->engine.rpm());
-        current_pos = track_path.length();
-        set_sound_modus(log->sound_modus);
-        if (start)
-            this->start();
-    }
-    return ret;
+    QMutexLocker lock(&simulation.core_mutex());
+    if (!core->load_log(filename, height()))
+        return false;
+    update_render_track();
+    scene.fill_trees();
+    core->track.saveJSON();
+    core->track.save();
+    simulation.publish();
+    set_sound_modus(core->log()->sound_modus);
+    lock.unlock();
+    if (start)
+        this->start();
+    return true;
 }
 
 void QCarViz::save_json(const QString filename)
 {
-   car->log->save_json(filename);
+   QMutexLocker lock(&simulation.core_mutex());
+   core->log()->save_json(filename);
 }
 
 
+void QCarViz::load_track(const QString& filename)
+{
+    QMutexLocker lock(&simulation.core_mutex());
+    core->track.load(filename);
+    prepare_track();
+}
+
 void QCarViz::prepare_track() {
-    track.prepare_track();
-    update_track_path(height());
-    //speedObserver->tick();
-    for (auto o : signObserver)
-        o->reset();
-    tooslow_observer_->reset();
-    fill_trees();
+    QMutexLocker lock(&simulation.core_mutex());
+    core->prepare_track(height());
+    update_render_track();
+    scene.fill_trees();
+    simulation.publish();
 }
 
-bool QCarViz::tick() {
+void QCarViz::finish_run()
+{
+    stop();
+    QMutexLocker lock(&simulation.core_mutex());
+    latest_frame();
+    car->log->sound_modus = sound_modus;
+    car->log->vp_id = vp_id_->value();
+    car->log->run = run_->value();
+    car->log->condition = (Condition) this->current_condition_->currentIndex();
+    car->log->global_run_counter = global_run_counter;
+    car->log->window_size = size();
+    car->log->frame_timing = frame_stats.summary();
+    const FrameTimingSummary& ft = car->log->frame_timing;
+    qDebug() << "frames:" << ft.frames << "p50/p95/p99:" << ft.p50 << ft.p95 << ft.p99 << "ms, dropped:" << ft.dropped;
+    global_run_counter += 1;
+    car->save_log(intro_run_->checkState() == Qt::Checked, program_start_time);
+    show_end_of_run_messagebox();
+}
+
+void QCarViz::tick() {
 ProfilerExclusive::AutoStop pa(gProfilerE, "tick");
     //Q_ASSERT(started);
     if (!started) {
@@ -277,63 +251,33 @@ ProfilerExclusive::AutoStop pa(gProfilerE, "tick");
                 start_stop();
             }
         }
-        return false;
+        return;
     }
-    qreal dt;
     static bool changed = false; // if throttle / gas have changed (for the sliders in the gui)
-    user_steering = 0; // user steering (or from replay)
-    if (replay == true) {
-ProfilerExclusive::AutoStop pa(gProfilerE, "section 1");
-        if (replay_index >= car->log->items.size()) {
-            qDebug() << "elapsed_time:" << time_elapsed();
-            qDebug() << "deciliters_used:" << consumption_monitor.liters_used * 10;
-            stop();
-            replay = false;
-            return false;
-        }
-        LogItem& log_item = car->log->items[replay_index];
-        dt = log_item.dt;
-        car->braking = log_item.braking;
-        car->gearbox.set_gear(log_item.gear);
-        car->throttle = log_item.throttle;
-        eye_tracker_point = log_item.eye_tracker_point;
-        //qDebug() << eye_tracker_point;
-        user_steering = log_item.user_steering;
+    SimulationInput input = simulation.get_input();
+    input.steering = 0; // user steering per second
+    const bool replay = core->replay; // only changed in the gui thread
+    if (replay) {
         changed = true;
-        if (log_run_) {
-            LogItemJson& log_item_json = car->log->items_json[replay_index];
-            (LogItem&) log_item_json = log_item;
-            log_item_json.speed = get_kmh();
-            log_item_json.position = current_pos;
-            log_item_json.rpm = car->engine.rpm();
-            log_item_json.acceleration = car->current_acceleration;
-            log_item_json.consumption = car->engine.get_consumption_L_s();
-            log_item_json.rel_consumption = consumption_monitor.l_100km_instantaneous(car->engine.get_consumption_L_s(), car->speed);
-            log_item_json.rel_consumption_slow = hud.l_100km;
-            const qreal current_percent = track_path.percentAtLength(current_pos);
-            log_item_json.pos = track_path.pointAtPercent(current_percent);
-        }
-        replay_index++;
-        time_delta.add_dt(dt);
 
         const int prev_speed = replay_speed_mult;
         replay_speed_mult = boost::algorithm::clamp(replay_speed_mult + keyboard_input.gear_change(), 1, 20);
-        if (prev_speed != replay_speed_mult)
+        if (prev_speed != replay_speed_mult) {
             qDebug() << "replay speed mult:" << replay_speed_mult;
+            simulation.set_replay_speed(replay_speed_mult);
+        }
     } else {
-        if (!time_delta.get_time_delta(dt))
-            return false;
-
 //        if (keyboard_input.pitch_toggle())
 //            text_hint.showText("You were driving too fast!");
         // keyboard input
         if (keyboard_input.update()) {
-            car->throttle = keyboard_input.throttle();
-            car->braking = keyboard_input.breaking();
+            input.throttle = keyboard_input.throttle();
+            input.braking = keyboard_input.breaking();
             changed = true;
         }
         const int gear_change = keyboard_input.gear_change();
         if (gear_change) {
+            QMutexLocker lock(&simulation.core_mutex());
             if (gear_change > 0)
                 car->gearbox.gear_up();
             else if (gear_change < 0)
@@ -342,12 +286,13 @@ ProfilerExclusive::AutoStop pa(gProfilerE, "section 1");
         }
         if (keyboard_input.show_arrow()) {
             //qDebug() << "trigger arrow";
-            trigger_arrow();
+            QMutexLocker lock(&simulation.core_mutex());
+            core->trigger_arrow();
         }
         if (keyboard_input.is_key_down(Qt::Key_O)) // steering to the left
-            user_steering += dt; // "reduces" steering hint
+            input.steering += 1; // "reduces" steering hint
         if (keyboard_input.is_key_down(Qt::Key_P))
-            user_steering -= dt;
+            input.steering -= 1;
 
 //    // manual clutch control
 //    const bool toggle_clutch = keyboard_input.toggle_clutch();
@@ -359,7 +304,6 @@ ProfilerExclusive::AutoStop pa(gProfilerE, "section 1");
 //            clutch.clutch_in(car->engine, &car->gearbox, car->speed);
 //    }
     }
-    qreal t = time_elapsed();
 
 //#ifndef CAR_VIZ_FINAL_STUDY
     // sound modus (supercollider)
@@ -394,16 +338,19 @@ ProfilerExclusive::AutoStop pa(gProfilerE, "section 1");
 #endif
     if (keyboard_input.toggle_show_eye_tracking_point())
         show_eye_tracker_point = !show_eye_tracker_point;
+    if (keyboard_input.toggle_frame_timing())
+        show_frame_timing = !show_frame_timing;
 
     if (!replay) {
         // Wingman input
         if (wingman_input.valid()) {
             if (wingman_input.update()) {
-                car->throttle = wingman_input.gas();
-                car->braking = wingman_input.brake();
+                input.throttle = wingman_input.gas();
+                input.braking = wingman_input.brake();
                 changed = true;
             }
             if (wingman_input.update_buttons()) {
+                QMutexLocker lock(&simulation.core_mutex());
                 if (wingman_input.left_click())
                     car->gearbox.gear_down();
                 if (wingman_input.right_click())
@@ -417,93 +364,21 @@ ProfilerExclusive::AutoStop pa(gProfilerE, "section 1");
             }
             wingman_input.update_wheel();
             if (!wingman_input.wheel_neutral()) {
-                user_steering -= wingman_input.wheel() * dt * 1.5;
+                input.steering -= wingman_input.wheel() * 1.5;
             }
         }
-        if (!track_started && car->throttle > 0) {
-            track_started = true;
-            track_started_time = time_delta.get_elapsed();
-            car->log.reset(new Log(car, this, &track));
-            car->log->initial_angular_velocity = car->engine.angular_velocity;
-            qDebug() << "starting new log";
-        }
-    }
-    steer(user_steering);
-    scripted_steering = 0;
-    {
-ProfilerExclusive::AutoStop pa(gProfilerE, "observer");
-    for (auto o : signObserver)
-        o->tick(replay, t, dt);
-    tooslow_observer_->tick();
-    }
-
-    if (replay) {
-        if (log_run_) {
-            LogItemJson& log_item_json = car->log->items_json[replay_index-1]; // replay_index was incremented before!
-            log_item_json.scripted_steering = scripted_steering;
-            log_item_json.steering = steering;
-        }
-        for ( ; ; ) {
-            LogEvent* event = car->log->next_event(replay_index);
-            if (!event)
-                break;
-            if (event->type == LogEvent::TooSlow) {
-                show_too_slow();
-            } else
-                show_traffic_violation((TrafficViolation) event->type); // carful! (casting)
-            qDebug() << "Log:" << event->type;
-        }
-    }
-//    turnSignObserver->tick(t, dt);
-//    stopSignObserver->tick(t, dt);
-
-    // automatic clutch control
-    if (track_started)
-        car->gearbox.auto_clutch_control(car);
-
-    const qreal alpha_scale = 0.8;
-    const qreal alpha = !track_path.length() ? 0 : (alpha_scale * atan(-track_path.slopeAtPercent(track_path.percentAtLength(current_pos)))); // slope [rad]
-    Q_ASSERT(!isnan(alpha));
-gProfilerE.start("car:tick");
-    car->tick(dt, alpha, replay);
-gProfilerE.stop();
-    if (track_started) {
-        consumption_monitor.tick(car->engine.get_consumption_L_s(), dt, car->speed);
-    } else {
-        Q_ASSERT(!replay);
-        car->speed = 0;
-    }
-    current_pos += car->speed * dt * 3;
-    if (!replay && track_path.length() > initial_pos && current_pos >= track_path.length()) {
-        stop();
-		Q_ASSERT(car->log != nullptr);
-        car->log->elapsed_time = t;
-        car->log->liters_used = consumption_monitor.liters_used;
-        car->log->sound_modus = sound_modus;
-        car->log->vp_id = vp_id_->value();
-        car->log->run = run_->value();
-        car->log->condition = (Condition) this->current_condition_->currentIndex();
-        car->log->global_run_counter = global_run_counter;
-        car->log->window_size = size();
-        global_run_counter += 1;
-        car->save_log(intro_run_->checkState() == Qt::Checked, program_start_time);
-        show_end_of_run_messagebox();
-    }
-    double l_100km;
-    if (consumption_monitor.get_l_100km(l_100km, car->speed)) {
-        hud.l_100km = l_100km;
-        //printf("%.3f\n", l_100km);
+        simulation.set_input(input);
     }
 
     static qreal last_elapsed = 0;
-    qreal elapsed = time_delta.get_elapsed();
+    const qreal elapsed = latest_frame().time;
     if (elapsed - last_elapsed > 0.05) {
 ProfilerExclusive::AutoStop pa(gProfilerE, "slow tick");
         //qDebug() << "slow tick" << elapsed << last_elapsed;
         if (changed) {
 ProfilerExclusive::AutoStop pa(gProfilerE, "slow tick:slider");
-            throttle_slider->setValue(car->throttle * 100);
-            breaking_slider->setValue(car->braking * 100);
+            throttle_slider->setValue(frame.throttle * 100);
+            breaking_slider->setValue(frame.braking * 100);
             changed = false;
         } else {
             // !! this is not so nice .. (the sliders totally get ignored)
@@ -514,19 +389,11 @@ ProfilerExclusive::AutoStop pa(gProfilerE, "slow tick:slider");
             toggle_connect_to_eyetracker();
         }
         //speedObserver->tick();
-        if (!replay) {
-            if (t - t_last_eye_tracking_update > 1) {
-                //qDebug() << "!!eye tracking point reset!";
-                ::new(&eye_tracker_point) QPointF();
-            }
-        }
 //gProfilerE.start("slow tick:slow_tick");
-        if (!log_run_)
-            emit slow_tick(elapsed - last_elapsed, elapsed, consumption_monitor);
+        emit slow_tick(elapsed - last_elapsed, elapsed, core->consumption_monitor);
 //gProfilerE.stop();
         last_elapsed = elapsed;
     }
-    return true;
 }
 
 void QCarViz::draw(QPainter& painter)
@@ -537,277 +404,19 @@ void QCarViz::draw(QPainter& painter)
         qDebug() << "painter not active!";
         return;
     }
-    QTransform t;
-    const qreal current_percent = track_path.percentAtLength(current_pos);
-    const qreal car_x_pos = 50;
-
-    const QPointF cur_p = track_path.pointAtPercent(current_percent);
-    //printf("%.3f\n", current_alpha * 180 / M_PI);
-
-#ifndef CAR_VIZ_FINAL_STUDY
-    //draw the current speed limit / current_pos / time elapsed
-    QString number;
-    //number.sprintf("%04.1f", time_elapsed());
-    number.sprintf("%04.1f", car->current_single_resistance);
-    painter.setFont(QFont{"Eurostile", 18, QFont::Bold});
-    QPointF p = {300,300};
-    if (track_started)
-        painter.drawText(p, number);
-    // /////
-#endif
-
-    // draw remaining time
-    TimeDisplay::draw(painter, {10,30}, track.max_time, time_elapsed(), track_started, false);
-
     const bool hud_external = hud_window.get() != nullptr;
-
-    // draw the HUD speedometer & revcounter
-    if (hud_external) {
-        QHudWidget& hw = hud_window->hud_widget();
-        hw.update_hud(&hud, car->engine.rpm(), Gearbox::speed2kmh(car->speed), consumption_monitor.liters_used);
-    } else {
-        t.translate(0, 0.75 * height() - 0.5 * hud.height);
-        painter.setTransform(t);
-        hud.draw(painter, width(), car->engine.rpm(), Gearbox::speed2kmh(car->speed), consumption_monitor.liters_used); //, track.max_time, time_delta.get_elapsed() - track_started_time, track_started);
-    }
-    {
-        // draw gear indicator
-        QFont font("Eurostile", 35);
-        font.setBold(true);
-        painter.setFont(font);
-        painter.setPen(Qt::black);
-        QFontMetrics fm = painter.fontMetrics();
-        //fm.xHeight() // !! ??
-        t.reset();
-        t.translate(0.5 * width() + 300, 0.8 * height());
-        painter.setTransform(t);
-        QString str; // = "Test Atest";
-        QTextStream(&str) << car->gearbox.get_gear() + 1;
-        misc::draw_centered_text(painter, fm, str, QPointF(0,0));
-        painter.setBrush(Qt::NoBrush);
-        //painter.drawEllipse(QPointF(0,0), 5, 5);
-        //painter.drawEllipse(QPointF(0,0), 10, 10);
-        painter.drawRect(QRectF(-20, -20, 40, 40));
-        font.setPointSize(12);
-        font.setBold(false);
-        painter.setFont(font);
-        fm = painter.fontMetrics();
-        misc::draw_centered_text(painter, fm, "Gear", QPointF(0, -30));
-    }
-    // draw the road
-    painter.setPen(QPen(Qt::black, 1));
-    //painter.drawLine(0, height()/2, width(), height()/2);
-    painter.setBrush(Qt::NoBrush);
-    QTransform t0;
-    t0.translate(0, (hud_external ? -0.25 : -0.5) * height());
-    t = t0;
-    t.translate(car_x_pos - cur_p.x(),0);
-    painter.setTransform(t);
-    painter.drawPath(track_path);
-
-    // draw the trees (more in the background)
-    if (get_kmh() < 10)
-        draw_trees(painter, t0, car_x_pos, cur_p);
-
-    // draw the signs
-    for (int i = 0; i < track.signs.size(); i++) {
-        track.signs[i].draw(painter, track_path);
-    }
-
-    // draw the car
-    const qreal car_width = 60.;
-    const qreal car_height = (qreal) car_img.size().height() / car_img.size().width() * car_width;
-
-    t = t0;
-    t.translate(car_x_pos, cur_p.y());
-    //t.rotateRadians(atan(slope));
-    t.rotate(-track_path.angleAtPercent(current_percent));
-    t.translate(-car_width/2, -car_height);
-    painter.setTransform(t);
-    painter.drawImage(QRectF(0,0, car_width, car_height), car_img);
-
-    // draw the trees in the foreground
-    if (get_kmh() >= 10)
-        draw_trees(painter, t0, car_x_pos, cur_p);
-
-    // draw an arrow
-    //printf("%s ", show_arrow == Arrow::None ? "None" : (show_arrow == Arrow::Left ? "Left" : "Right"));
-#if (DRAW_ARROW_SIGN < 2)
-    const double center_tolerance = 0.05;
-    if (steering > center_tolerance || steering < -center_tolerance)
-#endif
-    {
-        //qDebug() << steering;
-        //printf("draw ");
-        //t = t0;
-        t.reset();
-
-#if (DRAW_ARROW_SIGN==0)
-        t.translate(0.5 * width(), 40);
-        painter.setOpacity(fabs(steering) - center_tolerance);
-#elif (DRAW_ARROW_SIGN==1)
-        t.translate(0.5 * (width() - turn_sign_rect.width()), 20);
-        if (steering < 0) {
-            t.scale(-1,1);
-            t.translate(-turn_sign_rect.width(),0);
-        }
-        painter.setOpacity(fabs(steering) - center_tolerance);
-#elif (DRAW_ARROW_SIGN==2)
-        t.translate(0.5 * width(), 20);
-#else
-        t.translate(0.5 * width(), 0);
-#endif
-        painter.setTransform(t);
-#if (DRAW_ARROW_SIGN==0)
-        const qreal mult = steering < 0 ? -1 : 1;
-        const qreal head_x = fabs(steering) * mult * 30;
-        const QPointF head(head_x, 0);
-//        painter.drawPoint(QPointF(0,0));
-//        painter.drawPoint(head);
-        painter.setPen(QPen(Qt::black, 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-        painter.drawLine(QPointF(0,0), head);
-        painter.drawLine(QPointF(head_x - 5*mult, -5), head);
-        painter.drawLine(QPointF(head_x - 5*mult, +5), head);
-#elif (DRAW_ARROW_SIGN==1)
-        turn_sign->render(&painter, turn_sign_rect);
-#elif (DRAW_ARROW_SIGN==2)
-        const qreal scale = 80;
-        const qreal alpha = steering;
-        //const qreal a = 0.5*M_PI + alpha;
-        //QPointF top(cos(a), 1 - 0.4 - 0.4 * sin(a)); top *= scale;
-        QPointF top(alpha, 0.5); top *= scale;
-        QPointF left(-0.4, 1); left *= scale;
-        QPointF right(0.4, 1); right *= scale;
-        QPointF mid(0, 1 * scale);
-        painter.drawLine(top, left);
-        painter.drawLine(top, right);
-        QPainterPath p; p.moveTo(top); p.lineTo(left); p.lineTo(right); p.lineTo(top);
-        painter.fillPath(p, Qt::gray);
-        QPen pen(Qt::white);
-        pen.setStyle(Qt::DashLine);
-        pen.setDashOffset(-current_pos * 0.2);
-        painter.setPen(pen);
-        painter.drawLine(top, mid);
-#else
-        struct path {
-            QPointF p[4];
-            void set(const QPointF p0, const QPointF p1, const QPointF p2, const QPointF p3) {
-                p[0] = p0; p[1] = p1; p[2] = p2; p[3] = p3;
-            }
-            void get_path(QPainterPath& path) {
-                path.moveTo(p[0]);
-                path.cubicTo(p[1], p[2], p[3]);
-            }
-            void get_path_rev(QPainterPath& path) {
-                path.moveTo(p[3]);
-                path.cubicTo(p[2], p[1], p[0]);
-            }
-
-            void draw(QPainter& painter) {
-                QPainterPath path;
-                get_path(path);
-                painter.drawPath(path);
-            }
-            void interp(const path& p2, qreal const t, path& out) {
-                for (int i = 0; i < 4; i++)
-                    out.p[i] = misc::interp(p[i], p2.p[i], t);
-            }
-        };
-        struct road {
-            road() { left *= scale; right *= scale; mid *= scale; }
-            void draw(QPainter& painter, const qreal current_pos) {
-                t[0].draw(painter);
-                t[1].draw(painter);
-
-                // fill with a gray brush
-                QPainterPath path;
-                t[0].get_path(path); path.lineTo(t[1].p[3]);
-                t[1].get_path_rev(path);
-                path.lineTo(t[0].p[0]);
-                painter.fillPath(path, Qt::gray);
-
-                QPen pen(Qt::white);
-                pen.setStyle(Qt::DashLine);
-                pen.setWidth(2);
-                pen.setDashPattern({5, 4});
-                pen.setDashOffset(current_pos * 0.2);
-                painter.setPen(pen);
-                t[2].draw(painter);
-            }
-            void interp(const road& r2, qreal const f, road& r) { // f: weight of r2
-                for (int i = 0; i < 3; i++)
-                    t[i].interp(r2.t[i], f, r.t[i]);
-            }
-
-            path t[3]; // left, right, mid
-            QPointF left = QPointF(-0.4, 1);
-            QPointF right = QPointF(0.4, 1);
-            QPointF mid = QPointF(0, 1);
-            const qreal scale = 160;
-        };
-        struct straight_road : public road {
-            straight_road() {
-                using misc::interp;
-                QPointF top(0, 0.7*scale);
-                t[0].set(left, interp(left, top, 0.25), interp(left, top, 0.75), top);
-                t[1].set(right, interp(right, top, 0.25), interp(right, top, 0.75), top);
-                t[2].set(mid, interp(mid, top, 0.25), interp(mid, top, 0.75), top);
-            }
-        };
-        struct bent_road : public road {
-            const qreal dist = 0.7; // x-distance from center
-            const qreal top_end = 0.56+0.1; // y-values of "end" of the road
-            const qreal bottom_end = 0.65+0.1;
-            const qreal spline1_outer = 0.125; // spline-point-distance of beginning of street of inner/outer/mid line
-            const qreal spline1_inner = 0.1;
-            const qreal spline1_mid = 0.5 * (spline1_inner + spline1_outer);
-            const qreal spline2_outer = 0.2; // spline-point-distance of end of street (of inner/outer/mid line)
-            const qreal spline2_inner = 0.15;
-            const qreal spline2_mid = 0.5 * (spline2_inner + spline2_outer);
-        };
-
-        struct right_road : public bent_road {
-            right_road() {
-                const QPointF left_end = QPointF(dist, top_end) * scale;
-                const QPointF right_end = QPointF(dist, bottom_end) * scale;
-                const QPointF mid_end = QPointF(dist, (top_end+bottom_end)*0.5) * scale;
-                t[0].set(left, left + QPointF(0, -spline1_outer*scale), left_end + QPointF(-spline2_outer * scale, 0), left_end);
-                t[1].set(right, right + QPointF(0, -spline1_inner*scale), right_end + QPointF(-spline2_inner * scale, 0), right_end);
-                t[2].set(mid, mid + QPointF(0, -spline1_mid*scale), mid_end + QPointF(-spline2_mid * scale, 0), mid_end);
-            }
-        };
-        struct left_road : public bent_road {
-            left_road() {
-                const QPointF left_end = QPointF(-dist, bottom_end) * scale;
-                const QPointF right_end = QPointF(-dist, top_end) * scale;
-                const QPointF mid_end = QPointF(-dist, (top_end+bottom_end)*0.5) * scale;
-                t[0].set(left, left + QPointF(0, -spline1_inner*scale), left_end + QPointF(spline2_inner * scale, 0), left_end);
-                t[1].set(right, right + QPointF(0, -spline1_outer*scale), right_end + QPointF(spline2_outer * scale, 0), right_end);
-                t[2].set(mid, mid + QPointF(0, -spline1_mid*scale), mid_end + QPointF(spline2_mid * scale, 0), mid_end);
-            }
-        };
-
-        static straight_road straight;
-        static right_road right;
-        static left_road left;
-        road out;
-        if (steering >= 0)
-            straight.interp(right, steering, out);
-        else
-            straight.interp(left, -steering, out);
-        out.draw(painter, current_pos);
-#endif
-        painter.setOpacity(1.0);
-    }
+    scene.draw(painter, frame, size(), hud_external, &frame_timing);
+    if (hud_external)
+        hud_window->hud_widget().update_hud(&scene.hud, frame);
 
     // draw text-hints
-    t.reset();
-    painter.setTransform(t);
+    painter.setTransform(QTransform());
     text_hint.draw(painter, QPointF(0.5*width(), 50));
 
     if (show_eye_tracker_point) {
-            eye_tracker_point = QCursor::pos();
+            QPointF eye_tracker_point = QCursor::pos();
             globalToLocalCoordinates(eye_tracker_point);
+            set_eye_tracker_point(eye_tracker_point);
         painter.setTransform(QTransform());
         painter.setBrush(Qt::NoBrush);
         painter.setPen(Qt::black);
@@ -820,4 +429,87 @@ void QCarViz::draw(QPainter& painter)
 
         painter.drawLine(0, 544, 1710, 544);
     }
+    if (show_frame_timing)
+        draw_frame_timing(painter);
+}
+
+void QCarViz::begin_frame_timing()
+{
+    const qint64 now = frame_clock.nsecsElapsed();
+    if (frame_start >= 0) {
+        frame_timing.interval = (now - frame_start) * 1e-6f;
+        frame_timing.sections[FramePresent] = (now - frame_draw_end) * 1e-6f;
+        frame_times.push(frame_timing);
+        if (frame.track_started && !frame.replay)
+            frame_stats.add(frame_timing);
+    }
+    // only the frames of a running simulation follow each other (update() after every paint)
+    frame_start = started ? now : -1;
+    frame_timing = FrameTiming();
+    frame_timing.sections[FrameTick] = (frame.step_nsecs - last_step_nsecs) * 1e-6f;
+    last_step_nsecs = frame.step_nsecs;
+}
+
+void QCarViz::reset_frame_timing()
+{
+    const QWindow* window = this->window()->windowHandle();
+    const QScreen* screen = window ? window->screen() : QGuiApplication::primaryScreen();
+    const qreal refresh_rate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    frame_stats.reset(1000. / refresh_rate);
+}
+
+void QCarViz::draw_frame_timing(QPainter& painter)
+{
+    // colorblind safe, by FrameSection
+    static const QColor colors[__FrameSection_length] = {
+        Qt::black, QColor(230, 159, 0), QColor(86, 180, 233), QColor(0, 158, 115),
+        QColor(240, 228, 66), QColor(0, 114, 178), QColor(213, 94, 0), QColor(204, 121, 167) };
+    const int max_frames = 240; // a pixel per frame
+    const qreal px_per_ms = 4;
+    FrameTiming frames[max_frames];
+    const int n = frame_times.latest(frames, max_frames);
+    const QRectF rect(width() - max_frames - 10, 10, max_frames, 50 * px_per_ms); // up to 50 ms
+
+    painter.setTransform(QTransform());
+    painter.setOpacity(1.0);
+    painter.fillRect(rect, QColor(255, 255, 255, 220));
+    // the sections of the gui thread stacked (they add up to the interval), the tick as a line
+    for (int i = 0; i < n; i++) {
+        const qreal x = rect.right() - n + i;
+        qreal y = rect.bottom();
+        for (int s = FrameTick + 1; s < __FrameSection_length && y > rect.top(); s++) {
+            const qreal h = std::min(y - rect.top(), (qreal) frames[i].sections[s] * px_per_ms);
+            painter.fillRect(QRectF(x, y - h, 1, h), colors[s]);
+            y -= h;
+        }
+        const qreal tick_y = std::max(rect.top(), rect.bottom() - frames[i].sections[FrameTick] * px_per_ms);
+        painter.fillRect(QRectF(x, tick_y, 1, 1), colors[FrameTick]);
+    }
+    // a frame above the line missed the refresh of the screen
+    const qreal refresh_y = rect.bottom() - frame_stats.refresh_interval() * px_per_ms;
+    painter.setPen(QPen(Qt::red, 1));
+    painter.drawLine(QPointF(rect.left(), refresh_y), QPointF(rect.right(), refresh_y));
+    painter.setPen(Qt::black);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawRect(rect);
+
+    painter.setFont(QFont{"Eurostile", 9});
+    const QFontMetrics fm = painter.fontMetrics();
+    qreal y = rect.bottom() + fm.height();
+    qreal x = rect.left();
+    for (int s = 0; s < __FrameSection_length; s++) {
+        const QString name = frame_section_name((FrameSection) s);
+        if (x + fm.width(name) + 12 > rect.right()) {
+            x = rect.left();
+            y += fm.height();
+        }
+        painter.fillRect(QRectF(x, y - 8, 8, 8), colors[s]);
+        painter.drawText(QPointF(x + 10, y), name);
+        x += fm.width(name) + 16;
+    }
+    const FrameTimingSummary run = frame_stats.summary();
+    QString stats;
+    stats.sprintf("run: %d frames, p50 %.1f p95 %.1f p99 %.1f ms, %d dropped",
+                  run.frames, run.p50, run.p95, run.p99, run.dropped);
+    painter.drawText(QPointF(rect.left(), y + fm.height()), stats);
 }
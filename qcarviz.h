@@ -28,6 +28,10 @@
 #include "misc.h"
 #include "track.h"
 #include "car.h"
+#include "simulation_core.h"
+#include "simulation_thread.h"
+#include "scene_renderer.h"
+#include "frame_timing.h"
 #include "hudwindow.h"
 #include "fedi_volume.h"
 
@@ -39,11 +43,6 @@
 
 #define DEFAULT_SPEED_LIMIT 300 // kmh
 
-static std::mt19937_64 rng(std::random_device{}());
-
-class SignObserverBase;
-class TurnSignObserver;
-struct TooSlowObserver;
 class QCarViz;
 
 struct TextHint {
@@ -81,12 +80,6 @@ struct TextHint {
     }
 };
 
-enum TrafficViolation {
-    Speeding,
-    StopSign,
-    TrafficLight,
-};
-
 struct EyeTrackerClient : public QThread
 {
     Q_OBJECT
@@ -183,30 +176,22 @@ protected:
     bool quit = false;
 };
 
-enum Condition {
-    VIS = 0,
-    SLP = 1,
-    CNT = 2,
-    NO_CONDITION = 3,
-};
-
-class QCarViz : public QWidget
+class QCarViz : public QWidget, public SimulationListener
 {
     Q_OBJECT
 
 public:
-    friend class SignObserverBase;
-
     QCarViz(QWidget *parent = 0);
 
     virtual ~QCarViz() {
+        simulation.stop_thread(); // before the listener (this) is gone
         if (eye_tracker_client != nullptr) {
             eye_tracker_client->disconnect();
             eye_tracker_client->wait(500);
         }
     }
 
-    void init(Car* car, QPushButton* start_button, QCheckBox* eye_tracker_connected_checkbox, QSpinBox *vp_id, QComboBox* current_condition, QComboBox* next_condition, QCheckBox* intro_run,
+    void init(SimulationCore* core, QPushButton* start_button, QCheckBox* eye_tracker_connected_checkbox, QSpinBox *vp_id, QComboBox* current_condition, QComboBox* next_condition, QCheckBox* intro_run,
               QSpinBox* run, QSlider* throttle, QSlider* breaking, QSpinBox* gear, QMainWindow* main_window, OSCSender* osc, bool start = false);
 
     void copy_from_track_editor(QTrackEditor* track_editor);
@@ -286,6 +271,7 @@ public slots:
     void stop(/*bool temporary_stop = false*/) {
         //tick_timer.stop();
         started = false;
+        simulation.set_running(false);
         //if (!temporary_stop) {
             osc->call("/stopEngine");
             toggle_fedi(false);
@@ -307,7 +293,22 @@ protected slots:
         started ? stop() : start();
     }
 
-    bool tick();
+    // reads the input devices and hands the input to the simulation thread
+    void tick();
+
+    // the end of a run / replay (signals of the simulation thread)
+    void finish_run();
+    void finish_replay() {
+        stop();
+        QMutexLocker lock(&simulation.core_mutex());
+        core->replay = false;
+    }
+    // feedback of the simulation (listener), in the gui thread
+    void show_hint(const QString& text, const bool flash) {
+        if (flash)
+            flash_timer.start();
+        text_hint.showText(text);
+    }
 
 public:
 
@@ -322,40 +323,26 @@ public:
     }
 
     void set_eye_tracker_point(QPointF& p) {
-        // could me made thread-safe..
-        if (!replay) {
-            eye_tracker_point = p;
-            t_last_eye_tracking_update = time_elapsed();
-        }
+        simulation.set_eye_tracker_point(p); // thread-safe (called by the EyeTrackerClient)
     }
 
-    void log_traffic_violation(const TrafficViolation violation);
-    void show_traffic_violation(const TrafficViolation violation);
-    void show_too_slow() {
+    void show_traffic_violation(const TrafficViolation violation) override;
+    void show_too_slow() override {
         osc->call("/honk");
 #ifdef GERMAN
-        text_hint.showText("Sie fahren aktuell etwas langsam..");
+        const QString hint = "Sie fahren aktuell etwas langsam..";
 #else
-        text_hint.showText("You are driving a little too slow..");
+        const QString hint = "You are driving a little too slow..";
 #endif
+        QMetaObject::invokeMethod(this, "show_hint", Qt::QueuedConnection, Q_ARG(QString, hint), Q_ARG(bool, false));
     }
 
-    QPointF& get_eye_tracker_point() { return eye_tracker_point; }
-
-    qreal get_kmh() { return Gearbox::speed2kmh(car->speed); }
-    qreal get_user_steering() { return user_steering; }
-
-    const QPainterPath& get_track_path() const { return track_path; }
-
-    void steer(const qreal val) {
-        steering = boost::algorithm::clamp(steering + val, -1, 1);
-        //qDebug() << val << steering;
-    }
+    qreal get_kmh() { return frame.kmh; }
 
-    const Car* get_car() const { return car; }
-    qreal get_current_pos() const { return current_pos; }
+    SimulationCore* get_core() { return core; }
+    // hold it to access the core (the simulation thread steps it)
+    QMutex& core_mutex() { return simulation.core_mutex(); }
 
-    Track track;
     QElapsedTimer flash_timer; // controls the display of a flash (white screen)
 
 protected:
@@ -369,9 +356,9 @@ protected:
 
         if (intro_run_->checkState() != Qt::Checked) {
 #ifdef GERMAN
-            QTextStream(&text) << "Sie haben " << qSetRealNumberPrecision(2) << consumption_monitor.liters_used * 10 << tr(" dl dafür gebraucht.\n\n");
+            QTextStream(&text) << "Sie haben " << qSetRealNumberPrecision(2) << frame.liters_used * 10 << tr(" dl dafür gebraucht.\n\n");
 #else
-            QTextStream(&text) << "You have consumed " << qSetRealNumberPrecision(2) << consumption_monitor.liters_used * 10 << " dl for this run.\n\n";
+            QTextStream(&text) << "You have consumed " << qSetRealNumberPrecision(2) << frame.liters_used * 10 << " dl for this run.\n\n";
 #endif
         }
 #ifdef GERMAN
@@ -412,26 +399,20 @@ protected slots:
 
 protected:
 
-    void fill_trees() {
-        trees.clear();
-        const qreal first_distance = 40; // distance from starting position of the car
-        const qreal track_length = track_path.boundingRect().width();
-        std::uniform_int_distribution<int> tree_type(0,tree_types.size()-1);
-        std::uniform_real_distribution<qreal> dist(5,50); // distance between the trees
-        const qreal first_tree = track_path.pointAtPercent(track_path.percentAtLength(initial_pos)).x() + first_distance;
-        const qreal scale = 5;
-
-        for (double x = first_tree; x < track_length; x += dist(rng)) {
-            trees.append(Tree(tree_type(rng), x, scale, 10*scale));
-        }
-        //printf("%.3f\n", trees[0].pos);
-    }
-
     void prepare_track();
+    // copies the track of the core for drawing (core_mutex() held)
+    void update_render_track() {
+        scene.set_track(core->track, height());
+    }
+    // the latest step of the simulation, stays the same until the next call
+    const RenderSnapshot& latest_frame() {
+        frame = simulation.snapshot();
+        return frame;
+    }
 public:
     void reset();
-    Log* log() { return car->log.get(); }
-    bool is_replaying() { return replay; }
+    Log* log() { return core->log(); }
+    bool is_replaying() { return core->is_replaying(); }
 protected:
 
     void show_fedi_volume_window()
@@ -447,21 +428,6 @@ protected:
         hw.start();
     }
 
-    void draw_trees(QPainter& painter, const QTransform& t0, const qreal car_x_pos, const QPointF& cur_p) {
-        QTransform t = t0;
-        t.translate(car_x_pos - cur_p.x(),0);
-        painter.setTransform(t);
-
-        const qreal track_bottom = track_path.boundingRect().bottom();
-        for (Tree tree : trees) {
-            const qreal tree_x = tree.track_x(cur_p.x());
-            if (tree_x > size().width() + cur_p.x() + 200)
-                continue;
-            QPointF tree_pos(tree_x, track_bottom);
-            tree_types[tree.type].draw_scaled(painter, tree_pos, Gearbox::speed2kmh(car->speed), tree.scale);
-        }
-    }
-
     void save_svg() {
         QSvgGenerator generator;
         generator.setFileName("/Users/jhammers/car_simulator.svg");
@@ -475,10 +441,6 @@ protected:
         painter.end();
     }
 
-    void trigger_arrow();
-    qreal time_elapsed() {
-        return time_delta.get_elapsed() - track_started_time;
-    }
 public:
     void toggle_connect_to_eyetracker() {
         if (eye_tracker_client != nullptr) {
@@ -497,6 +459,12 @@ public:
 
 protected:
     void draw(QPainter& painter);
+    // closes the timing of the previous frame (its interval ends now) and starts the one of this frame
+    void begin_frame_timing();
+    // the stats of the frames of a new run, for the refresh rate of the screen
+    void reset_frame_timing();
+    // graph of the latest frames (F)
+    void draw_frame_timing(QPainter& painter);
 
     void set_fedi_volume(const qreal fedi_volume) {
         fedi_volume_ = fedi_volume;
@@ -505,99 +473,72 @@ protected:
 
     virtual void paintEvent(QPaintEvent *) {
         //qDebug() << "paintEvent " << started;
-//        static misc::FPSTimer fps("paint:");
-//        fps.addFrame();
-        if (started) {
-            if (replay) {
-                for (int i = 0; i < replay_speed_mult; i++)
-                    if (!tick())
-                        break;
-            } else
-
-                tick();
-        }
+        // the simulation steps in its own thread, a frame draws its latest state
+        latest_frame();
+        begin_frame_timing();
 
         QPainter painter(this);
         draw(painter);
+        frame_draw_end = frame_clock.nsecsElapsed();
 
         if (started) {
             update();
         }
     }
 
-    void add_tree_type(const QString name, const qreal scale, const qreal y_offset) {
-        const QString path = "media/trees/" + name;
-        tree_types.append(TreeType(path + "_base.png", scale, y_offset));
-        tree_types.last().add_speedy_image(path + "1", 10);
-        tree_types.last().add_speedy_image(path + "2", 30);
-        tree_types.last().add_speedy_image(path + "3", 50);
-        tree_types.last().add_speedy_image(path + "4", 70);
-        tree_types.last().add_speedy_image(path + "5", 100);
-    }
 public:
+    // loads the track of the core from filename and prepares it (under core_mutex(), the thread may be running)
+    void load_track(const QString& filename = "tracks/track.bin");
     void update_track_path(const int height) {
-        QPainterPath path;
-        track.get_path(path, height);
-        track_path.swap(path);
+        if (!core)
+            return;
+        QMutexLocker lock(&simulation.core_mutex());
+        core->update_track_path(height);
+        update_render_track();
     }
-    bool is_log_run() const { return log_run_; }
-    void set_scripted_steering(qreal const steering) { scripted_steering = steering; }
 protected:
     virtual void resizeEvent(QResizeEvent *e) {
         update_track_path(e->size().height());
+        scene.clear_caches(); // built again for the device pixel ratio of the screen
+        Track::images.raster.clear();
     }
 
-    const qreal initial_pos = 40;
-    qreal current_pos = initial_pos; // current position of the car. max is: track_path.length()
-    QImage car_img;
-    std::auto_ptr<TooSlowObserver> tooslow_observer_;
-    std::vector<SignObserverBase*> signObserver;
-    TurnSignObserver* turnSignObserver = nullptr;
-//    std::auto_ptr<TurnSignObserver> turnSignObserver;
-//    std::auto_ptr<StopSignObserver> stopSignObserver;
-    misc::TimeDelta time_delta;
-    misc::TimeDelta time_delta_replay;
-    Car* car;
-    QPainterPath track_path;
-    QVector<TreeType> tree_types;
-    QVector<Tree> trees;
+    SimulationCore* core = nullptr;
+    Car* car = nullptr; // == &core->car
+    SimulationThread simulation; // steps the core
+    RenderSnapshot frame; // the step that is drawn
+    SceneRenderer scene; // draws frame
     bool started = false;
-    QTimer tick_timer; // for simulation-ticks if the window is not visible
+    QTimer tick_timer; // polls the input
     QPushButton* start_button = NULL;
     QSlider* throttle_slider = NULL;
     QSlider* breaking_slider = NULL;
     QSpinBox* gear_spinbox = NULL;
     WingmanInput wingman_input;
     KeyboardInput keyboard_input;
-    ConsumptionMonitor consumption_monitor;
-    HUD hud;
-    bool track_started = false;
-    qreal track_started_time = 0;
     OSCSender* osc = NULL;
     int sound_modus = 0;
     bool sound_enabled = false;
     QDateTime program_start_time;
     int global_run_counter = 1;
-    bool replay = false;
-    int replay_index = 0;
     int replay_speed_mult = 1;
-    std::auto_ptr<QSvgRenderer> turn_sign;
-    QRectF turn_sign_rect;
-    qreal steering = 0; // between -1 (left) and 1 (right)
-    qreal user_steering = 0;
-    qreal scripted_steering = 0;
-    QPointF eye_tracker_point;
-    qreal t_last_eye_tracking_update = 0;
     EyeTrackerClient* eye_tracker_client = nullptr;
     QCheckBox* eye_tracker_connected_checkbox_ = nullptr;
     bool show_eye_tracker_point = false;
+    QElapsedTimer frame_clock;
+    qint64 frame_start = -1; // of the frame being timed (-1: none, the simulation wasn't running) [ns]
+    qint64 frame_draw_end = 0; // [ns]
+    qint64 last_step_nsecs = 0; // RenderSnapshot::step_nsecs of the previous frame
+    FrameTiming frame_timing; // of the frame being drawn
+    FrameTimingRing frame_times; // the latest frames (overlay)
+    FrameTimingStats frame_stats; // all frames of the run (its log)
+    bool show_frame_timing = false;
     TextHint text_hint;
     QSpinBox* vp_id_;
     QVector<Condition> condition_order;
     QComboBox* current_condition_;
     QComboBox* next_condition_;
     QSpinBox* run_;
-    bool log_run_ = false;
     QCheckBox* intro_run_ = nullptr;
     qreal fedi_volume_ = 0.0;
     bool fedi_volume_adjustment_in_progress = false;
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "qhudwidget.h"
 #include "hud.h"
+#include "simulation_thread.h"
 
 
 QHudWidget::QHudWidget(QWidget *parent) :
@@ -13,11 +14,11 @@ QHudWidget::QHudWidget(QWidget *parent) :
 
 }
 
-void QHudWidget::update_hud(HUD* hud, const qreal rpm, const qreal kmh, const qreal liters_used) {
+void QHudWidget::update_hud(HUD* hud, const RenderSnapshot& snapshot) {
     this->hud = hud;
-    this->rpm = rpm;
-    this->kmh = kmh;
-    this->liters_used = liters_used;
+    this->rpm = snapshot.rpm;
+    this->kmh = snapshot.kmh;
+    this->liters_used = snapshot.liters_used;
     update(); // !! only rect ..
 }
 
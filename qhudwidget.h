@@ -4,6 +4,7 @@
 #include <QWidget>
 
 struct HUD;
+struct RenderSnapshot;
 
 class QHudWidget : public QWidget
 {
@@ -11,7 +12,8 @@ class QHudWidget : public QWidget
 public:
     explicit QHudWidget(QWidget *parent = 0);
 
-    void update_hud(HUD* hud, const qreal rpm, const qreal kmh, const qreal liters_used);
+    // the values of a step of the simulation (copied, the snapshot is only valid for the frame of QCarViz)
+    void update_hud(HUD* hud, const RenderSnapshot& snapshot);
 
 private:
     void draw(QPainter& painter);
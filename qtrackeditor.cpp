@@ -1,20 +1,75 @@
 #include "stdafx.h"
 #include "qtrackeditor.h"
 
-void QTrackEditor::paintEvent(QPaintEvent *)
+void EditorPath::rebuild(const Track& track, const qreal height)
+{
+    this->height = height;
+    segments.resize(track.num_points);
+    segment_start.fill(0, track.num_points + 1);
+    if (!segments.isEmpty())
+        update(track, 0, segments.size() - 1);
+}
+
+void EditorPath::build(const Track& track, const int k)
+{
+    Segment& s = segments[k];
+    const QPointF p0 = Track::tf(track.points[3*k], height);
+    s.path = QPainterPath(p0);
+    s.path.cubicTo(Track::tf(track.points[3*k+1], height), Track::tf(track.points[3*k+2], height),
+                   Track::tf(track.points[3*k+3], height));
+    s.sampler.sample(s.path);
+    s.bounds = s.path.controlPointRect().adjusted(-margin, -margin, margin, margin);
+}
+
+void EditorPath::update(const Track& track, const int first, const int last)
+{
+    for (int k = first; k <= last; k++)
+        build(track, k);
+    for (int k = first; k < segments.size(); k++)
+        segment_start[k+1] = segment_start[k] + segments[k].sampler.length();
+}
+
+QRegion QTrackEditor::sign_region(Track::Sign& sign)
+{
+    QRectF pos, pole_pos;
+    if (!sign.get_position(pos, pole_pos, editor_path))
+        return QRegion();
+    // up to four lines of values above the sign
+    QRegion region = pos.united(pole_pos).adjusted(-30, -110, 30, 1).toAlignedRect();
+    if (sign.type == Track::Sign::TrafficLight) {
+        const QPointF p = editor_path.point_at(sign.at_length - sign.traffic_light_info.trigger_distance);
+        region += QRectF(p.x() - 2, p.y() - 11, 4, 18).toAlignedRect();
+    }
+    return region;
+}
+
+QRegion QTrackEditor::signs_region(const qreal from)
+{
+    QRegion region;
+    for (Track::Sign& s : track.signs) {
+        if (s.at_length >= from)
+            region += sign_region(s);
+    }
+    return region;
+}
+
+void QTrackEditor::paintEvent(QPaintEvent* e)
 {
     QPainter painter(this);
     const qreal h = height();
-    //QVector<QPointF>& points = track.points;
+    const QRect dirty = e->rect();
+    editor_path.sync(track, h);
 
-    // draw the line
-    QPainterPath path;
-    track.get_path(path, h);
-    painter.drawPath(path);
+    // draw the line (the segments in the dirty region)
+    for (int k = 0; k < editor_path.size(); k++) {
+        if (editor_path.bounds(k).intersects(dirty))
+            painter.drawPath(editor_path.path(k));
+    }
 
     // draw the signs
     for (int i = 0; i < track.signs.size(); i++) {
-        track.signs[i].draw(painter, path, true);
+        if (sign_region(track.signs[i]).intersects(dirty))
+            track.signs[i].draw(painter, editor_path, true);
     }
 
     // Draw the control points
@@ -22,7 +77,9 @@ void QTrackEditor::paintEvent(QPaintEvent *)
         const bool main_points_only = show_control_points->value() < 2;
         const qreal point_size = this->point_size;
         painter.setPen(QColor(50, 100, 120, 200));
-        for (int i=0; i<=track.num_points*3; ++i) {
+        for (int i=0; i<=track.num_points*3; i += main_points_only ? 3 : 1) {
+            if (!point_rect(i).intersects(dirty))
+                continue;
             QPointF pos = Track::tf(track.points[i],h);
             //if (i % 3)
                 painter.setBrush(QColor(200, 200, 210, (i%3) ? 30 : 120));
@@ -32,8 +89,6 @@ void QTrackEditor::paintEvent(QPaintEvent *)
             painter.drawEllipse(QRectF(pos.x() - point_size,
                                        pos.y() - point_size,
                                        point_size*2, point_size*2));
-            if (main_points_only)
-                i += 2;
         }
 //            painter.drawEllipse(QRectF(pp.x() - point_size,
 //                                       pp.y() - point_size,
@@ -44,10 +99,14 @@ void QTrackEditor::paintEvent(QPaintEvent *)
     if (show_control_points->value() >= 2) {
         painter.setPen(QPen(Qt::lightGray, 0, Qt::SolidLine));
         painter.setBrush(Qt::NoBrush);
-        QPainterPath points_path;
-        track.get_path_points(points_path, h);
-        painter.drawPath(points_path);
-//            painter.drawPolyline(&track.points[0],track.num_points*3+1);
+        for (int k = 0; k < editor_path.size(); k++) {
+            if (!editor_path.bounds(k).intersects(dirty))
+                continue;
+            QPointF line[4];
+            for (int j = 0; j < 4; j++)
+                line[j] = Track::tf(track.points[3*k+j], h);
+            painter.drawPolyline(line, 4);
+        }
     }
 }
 
@@ -59,11 +118,10 @@ void QTrackEditor::mousePressEvent(QMouseEvent *e)
 
     // first check the signs
     sign_moving = -1;
-    QPainterPath path;
-    track.get_path(path, h);
+    editor_path.sync(track, h);
     QRectF pos, pole_pos;
     for (int i = 0; i < track.signs.size(); i++) {
-        if (track.signs[i].get_position(pos, pole_pos, path) && pos.contains(mp)) {
+        if (track.signs[i].get_position(pos, pole_pos, editor_path) && pos.contains(mp)) {
             sign_moving = i;
             selected_traffic_light = (track.signs[i].type == Track::Sign::TrafficLight) ? &track.signs[i] : nullptr;
             selected_steer_sign = track.signs[i].is_turn_sign() ? &track.signs[i] : nullptr;
@@ -137,22 +195,23 @@ void QTrackEditor::mousePressEvent(QMouseEvent *e)
         mouseMoveEvent(e);
 }
 void QTrackEditor::mouseMoveEvent(QMouseEvent *e) {
+    editor_path.sync(track, height());
     if (sign_moving >= 0) {
         const qreal x = e->x();
-        QPainterPath path;
-        track.get_path(path, height());
-        const qreal length = path.length();
+        const qreal length = editor_path.length();
         qreal l = x - track.points[0].x();
         while (l < length) {
-            if (path.pointAtPercent(path.percentAtLength(l)).x() >= x)
+            if (editor_path.point_at(l).x() >= x)
                 break;
             l++;
         }
-        track.signs[sign_moving].at_length = std::min(l,length);
+        Track::Sign& sign = track.signs[sign_moving];
+        QRegion dirty = sign_region(sign);
+        sign.at_length = std::min(l,length);
 //            qreal p = path.percentAtLength(l);
 //            pp = path.pointAtPercent(p);
 //            //printf("(%.3f,%.3f)\n", pp.x(), pp.y());
-        update();
+        update(dirty + sign_region(sign));
     }
     else if (point_moving >= 0) {
         const qreal h = height();
@@ -162,6 +221,16 @@ void QTrackEditor::mouseMoveEvent(QMouseEvent *e) {
         if (p.x() > size().width()) p.setX(size().width());
         if (p.y() < 0) p.setY(0);
         if (p.y() > h) p.setY(h);
+        // the moved points are point_moving - 2 to point_moving + 2 at most, their segments (and the signs behind) change
+        const int first = std::max(0, (point_moving - 3) / 3);
+        const int last = std::min(editor_path.size() - 1, (point_moving + 2) / 3);
+        const qreal from = first <= last ? editor_path.start(first) : editor_path.length();
+        QRegion dirty = signs_region(from);
+        for (int k = first; k <= last; k++)
+            dirty += editor_path.bounds(k).toAlignedRect();
+        for (int i = std::max(0, point_moving - 2); i <= std::min(points.size() - 1, point_moving + 2); i++)
+            dirty += point_rect(i);
+
         QPointF& pn = points[point_moving];
         const QPointF delta = p - pn;
         pn = p;
@@ -179,6 +248,13 @@ void QTrackEditor::mouseMoveEvent(QMouseEvent *e) {
             const qreal l = QLineF(Track::tf(np,h), Track::tf(center,h)).length(); // length to other point
             np = Track::tf_1(Track::tf(center,h) + QPointF(cos(angle), sin(angle)) * l, h);
         }
-        update();
+
+        if (first <= last)
+            editor_path.update(track, first, last);
+        for (int k = first; k <= last; k++)
+            dirty += editor_path.bounds(k).toAlignedRect();
+        for (int i = std::max(0, point_moving - 2); i <= std::min(points.size() - 1, point_moving + 2); i++)
+            dirty += point_rect(i);
+        update(dirty + signs_region(from));
     }
 }
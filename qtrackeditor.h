@@ -11,10 +11,58 @@
 #include <math.h>
 #include <QMessageBox>
 #include <QLabel>
+#include <QRegion>
 #include "track.h"
 
 // TODO: angleAtPercent ?
 
+// EditorPath is the track path in the editor, a QPainterPath and a TrackSampler per bezier segment: moving a
+// point only rebuilds the segments next to it (update()), the rest of the path stays as it is.
+// has the lookups Track::Sign needs (empty, length, point_at)
+class EditorPath
+{
+public:
+    // rebuilds all segments if the height or the number of segments changed
+    void sync(const Track& track, const qreal height) {
+        if (height != this->height || segments.size() != track.num_points)
+            rebuild(track, height);
+    }
+    void rebuild(const Track& track, const qreal height);
+    // rebuilds the segments first to last (their points moved), the lengths of the following ones are moved
+    void update(const Track& track, const int first, const int last);
+
+    int size() const { return segments.size(); }
+    const QPainterPath& path(const int k) const { return segments[k].path; }
+    // of path k with its control points, points and lines drawn around them
+    const QRectF& bounds(const int k) const { return segments[k].bounds; }
+    qreal start(const int k) const { return segment_start[k]; }
+
+    bool empty() const { return segments.isEmpty(); }
+    qreal length() const { return segment_start.isEmpty() ? 0 : segment_start.last(); }
+    QPointF point_at(const qreal l) const {
+        const int k = segment_at(l);
+        return segments[k].sampler.point_at(l - segment_start[k]);
+    }
+    int segment_at(const qreal l) const {
+        const int k = (int) (std::upper_bound(segment_start.begin(), segment_start.end(), l) - segment_start.begin()) - 1;
+        return std::max(0, std::min(k, segments.size() - 1));
+    }
+
+    qreal margin = 8; // of bounds [px]
+
+protected:
+    struct Segment {
+        QPainterPath path;
+        TrackSampler sampler;
+        QRectF bounds;
+    };
+    void build(const Track& track, const int k);
+
+    QVector<Segment> segments;
+    QVector<qreal> segment_start; // path length at the start of every segment (+ the total length)
+    qreal height = -1; // the segments are laid out for
+};
+
 class QTrackEditor : public QWidget
 {
     Q_OBJECT
@@ -127,7 +175,16 @@ protected:
         point_moving = -1;
     }
 
+    // what is drawn of the signs starting at path length from (image, pole, values, trigger distance mark)
+    QRegion signs_region(const qreal from = 0);
+    QRegion sign_region(Track::Sign& sign);
+    QRect point_rect(const int i) const {
+        const QPointF p = Track::tf(track.points[i], height());
+        return QRectF(p.x() - point_size - 1, p.y() - point_size - 1, 2 * point_size + 2, 2 * point_size + 2).toAlignedRect();
+    }
+
     Track track;
+    EditorPath editor_path;
     int point_moving = -1;
     int sign_moving = -1;
     qreal point_size = 6;
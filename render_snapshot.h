@@ -0,0 +1,56 @@
+#ifndef RENDER_SNAPSHOT_H
+#define RENDER_SNAPSHOT_H
+
+#include <QPointF>
+#include <vector>
+#include "simulation_core.h"
+
+// the state of one simulation step, all the rendering (SceneRenderer, QHudWidget) needs. written by the
+// simulation thread (or a headless replay), read-only for the renderers
+struct RenderSnapshot {
+    quint64 step = 0; // number of the step (counts all steps of the thread)
+    qreal time = 0; // simulated time [s]
+    qreal time_elapsed = 0; // since the start of the track [s]
+    qreal pos = 0; // render position on the track path (SimulationCore::get_render_pos)
+    qreal kmh = 0;
+    qreal rpm = 0;
+    int gear = 0; // 0: first gear
+    qreal throttle = 0, braking = 0;
+    qreal steering = 0; // the steering hint, between -1 (left) and 1 (right)
+    qreal liters_used = 0;
+    qreal l_100km = 0; // averaged (for the hud)
+    qreal current_single_resistance = 0;
+    QPointF eye_tracker_point;
+    bool track_started = false;
+    bool replay = false;
+    qint64 step_nsecs = 0; // time spent in all the steps so far (set by SimulationThread) [ns]
+    std::vector<Track::Sign::TrafficLightState> traffic_lights; // of the traffic lights (SimulationCore::traffic_light_indices)
+
+    // the state of core now
+    void capture(const SimulationCore& core, const quint64 step) {
+        const Car& car = core.car;
+        this->step = step;
+        time = core.time;
+        time_elapsed = core.time_elapsed();
+        pos = core.get_render_pos();
+        kmh = core.get_kmh();
+        rpm = car.engine.rpm();
+        gear = car.gearbox.get_gear();
+        throttle = car.throttle;
+        braking = car.braking;
+        steering = core.steering;
+        liters_used = core.consumption_monitor.liters_used;
+        l_100km = core.l_100km;
+        current_single_resistance = car.current_single_resistance;
+        eye_tracker_point = core.eye_tracker_point;
+        track_started = core.track_started;
+        replay = core.replay;
+        Q_ASSERT(core.has_all_traffic_lights()); // a live run as well as a replay shows every light
+        const std::vector<int>& lights = core.traffic_light_indices;
+        traffic_lights.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); i++)
+            traffic_lights[i] = core.track.signs[lights[i]].traffic_light_state;
+    }
+};
+
+#endif // RENDER_SNAPSHOT_H
@@ -1,6 +1,9 @@
 #ifndef RESISTANCES_H
 #define RESISTANCES_H
 
+#include <QtGlobal>
+#include <math.h>
+
 #define GRAVITY 9.81 //[m/(s^2)]
 
 namespace resistances {
@@ -0,0 +1,360 @@
+#include "scene_renderer.h"
+
+#define DRAW_ARROW_SIGN 3 // 0: simple arrow 1: arrow sign 2: "street"-arrow 3: curved "street"-arrow
+
+SceneRenderer::SceneRenderer(const quint64 seed)
+    : tree_rng(seed)
+{
+    add_tree_type("tree", 0.2/3, 50*3);
+    add_tree_type("birch", 0.08, 140);
+    add_tree_type("spooky_tree", 0.06, 120);
+
+    car_img.load("media/cars/car.png");
+    turn_sign.reset(new QSvgRenderer(QString("media/turn_sign.svg")));
+    turn_sign_rect = QRectF(QPointF(0, 0), 0.03 * turn_sign->defaultSize());
+}
+
+void SceneRenderer::add_tree_type(const QString name, const qreal scale, const qreal y_offset)
+{
+    const QString path = "media/trees/" + name;
+    tree_types.append(TreeType(path + "_base.png", scale, y_offset));
+    tree_types.last().add_speedy_image(path + "1", 10);
+    tree_types.last().add_speedy_image(path + "2", 30);
+    tree_types.last().add_speedy_image(path + "3", 50);
+    tree_types.last().add_speedy_image(path + "4", 70);
+    tree_types.last().add_speedy_image(path + "5", 100);
+}
+
+void SceneRenderer::set_track(const Track& track, const qreal height)
+{
+    this->track = track;
+    track_tiles.set_track(this->track, height);
+    // the lights in the order of the signs, as SimulationCore::traffic_light_indices
+    traffic_light_of_sign.assign(track.signs.size(), -1);
+    int lights = 0;
+    for (int i = 0; i < track.signs.size(); i++)
+        if (track.signs[i].type == Track::Sign::TrafficLight)
+            traffic_light_of_sign[i] = lights++;
+}
+
+void SceneRenderer::fill_trees()
+{
+    trees.clear();
+    const qreal first_distance = 40; // distance from starting position of the car
+    const qreal track_length = track_tiles.bounding_rect().width();
+    std::uniform_int_distribution<int> tree_type(0,tree_types.size()-1);
+    std::uniform_real_distribution<qreal> dist(5,50); // distance between the trees
+    const qreal first_tree = track_tiles.point_at(SimulationCore::initial_pos).x() + first_distance;
+    const qreal scale = 5;
+
+    for (double x = first_tree; x < track_length; x += dist(tree_rng)) {
+        trees.add(Tree(tree_type(tree_rng), x, scale, 10*scale));
+    }
+    trees.sort();
+}
+
+void SceneRenderer::clear_caches()
+{
+    for (const TreeType& t : tree_types)
+        t.clear_sprites(); // built again for the device pixel ratio of the screen
+    track_tiles.clear_raster();
+}
+
+void SceneRenderer::draw_trees(QPainter& painter, const QTransform& t0, const qreal car_x_pos, const QPointF& cur_p,
+                               const qreal kmh, const qreal width)
+{
+    QTransform t = t0;
+    t.translate(car_x_pos - cur_p.x(),0);
+    painter.setTransform(t);
+
+    const qreal track_bottom = track_tiles.bounding_rect().bottom();
+    // the trees on the screen (+ 200 for their width)
+    const qreal from = cur_p.x() - car_x_pos - 200;
+    const qreal to = cur_p.x() - car_x_pos + width + 200;
+    trees.for_each_visible(cur_p.x(), from, to, [&](const Tree& tree, const qreal tree_x) {
+        tree_types[tree.type].draw_scaled(painter, QPointF(tree_x, track_bottom), kmh, tree.scale);
+    });
+}
+
+void SceneRenderer::draw(QPainter& painter, const RenderSnapshot& s, const QSize& size, const bool hud_external,
+                         FrameTiming* timing)
+{
+    FrameSectionClock clock(timing);
+    const qreal current_pos = s.pos;
+    const qreal steering = s.steering;
+    const qreal width = size.width(), height = size.height();
+    QTransform t;
+    const qreal car_x_pos = 50;
+
+    track_tiles.update(current_pos);
+    const QPointF cur_p = track_tiles.point_at(current_pos);
+    //printf("%.3f\n", current_alpha * 180 / M_PI);
+    clock.lap(FrameRoad);
+
+#ifndef CAR_VIZ_FINAL_STUDY
+    //draw the current speed limit / current_pos / time elapsed
+    QString number;
+    //number.sprintf("%04.1f", time_elapsed());
+    number.sprintf("%04.1f", s.current_single_resistance);
+    painter.setFont(QFont{"Eurostile", 18, QFont::Bold});
+    QPointF p = {300,300};
+    if (s.track_started)
+        painter.drawText(p, number);
+    // /////
+#endif
+
+    // draw remaining time
+    TimeDisplay::draw(painter, {10,30}, track.max_time, s.time_elapsed, s.track_started, false);
+
+    // draw the HUD speedometer & revcounter
+    hud.l_100km = s.l_100km;
+    if (!hud_external) {
+        t.translate(0, 0.75 * height - 0.5 * hud.height);
+        painter.setTransform(t);
+        hud.draw(painter, width, s.rpm, s.kmh, s.liters_used); //, track.max_time, time_delta.get_elapsed() - track_started_time, track_started);
+    }
+    {
+        // draw gear indicator
+        QFont font("Eurostile", 35);
+        font.setBold(true);
+        painter.setFont(font);
+        painter.setPen(Qt::black);
+        QFontMetrics fm = painter.fontMetrics();
+        //fm.xHeight() // !! ??
+        t.reset();
+        t.translate(0.5 * width + 300, 0.8 * height);
+        painter.setTransform(t);
+        QString str; // = "Test Atest";
+        QTextStream(&str) << s.gear + 1;
+        misc::draw_centered_text(painter, fm, str, QPointF(0,0));
+        painter.setBrush(Qt::NoBrush);
+        //painter.drawEllipse(QPointF(0,0), 5, 5);
+        //painter.drawEllipse(QPointF(0,0), 10, 10);
+        painter.drawRect(QRectF(-20, -20, 40, 40));
+        font.setPointSize(12);
+        font.setBold(false);
+        painter.setFont(font);
+        fm = painter.fontMetrics();
+        misc::draw_centered_text(painter, fm, "Gear", QPointF(0, -30));
+    }
+    clock.lap(FrameHud);
+    // draw the road
+    painter.setPen(QPen(Qt::black, 1));
+    //painter.drawLine(0, height/2, width, height/2);
+    painter.setBrush(Qt::NoBrush);
+    QTransform t0;
+    t0.translate(0, (hud_external ? -0.25 : -0.5) * height);
+    t = t0;
+    t.translate(car_x_pos - cur_p.x(),0);
+    painter.setTransform(t);
+    // only the visible part of the path (and the signs on it)
+    const qreal visible_from = current_pos - car_x_pos - 100;
+    const qreal visible_to = current_pos + 1.2 * width + 100;
+    track_tiles.draw(painter, visible_from, visible_to);
+    clock.lap(FrameRoad);
+
+    // draw the trees (more in the background)
+    if (s.kmh < 10)
+        draw_trees(painter, t0, car_x_pos, cur_p, s.kmh, width);
+    clock.lap(FrameTrees);
+
+    // draw the signs (the traffic lights in the state of the step)
+    QVector<Track::Sign>& signs = track.signs; // (sorted)
+    auto first_sign = std::lower_bound(signs.begin(), signs.end(), Track::Sign(Track::Sign::Stop, visible_from));
+    for (auto sign = first_sign; sign != signs.end() && sign->at_length <= visible_to; ++sign) {
+        const int light = traffic_light_of_sign[sign - signs.begin()];
+        if (light >= 0 && light < (int) s.traffic_lights.size())
+            sign->traffic_light_state = s.traffic_lights[light];
+        sign->draw(painter, track_tiles);
+    }
+    clock.lap(FrameSigns);
+
+    // draw the car
+    const qreal car_width = 60.;
+    const qreal car_height = (qreal) car_img.size().height() / car_img.size().width() * car_width;
+
+    t = t0;
+    t.translate(car_x_pos, cur_p.y());
+    //t.rotateRadians(atan(slope));
+    t.rotate(-track_tiles.angle_at(current_pos));
+    t.translate(-car_width/2, -car_height);
+    painter.setTransform(t);
+    painter.drawImage(QRectF(0,0, car_width, car_height), car_img);
+    clock.lap(FrameCar);
+
+    // draw the trees in the foreground
+    if (s.kmh >= 10)
+        draw_trees(painter, t0, car_x_pos, cur_p, s.kmh, width);
+    clock.lap(FrameTrees);
+
+    // draw an arrow
+    //printf("%s ", show_arrow == Arrow::None ? "None" : (show_arrow == Arrow::Left ? "Left" : "Right"));
+#if (DRAW_ARROW_SIGN < 2)
+    const double center_tolerance = 0.05;
+    if (steering > center_tolerance || steering < -center_tolerance)
+#endif
+    {
+        //qDebug() << steering;
+        //printf("draw ");
+        //t = t0;
+        t.reset();
+
+#if (DRAW_ARROW_SIGN==0)
+        t.translate(0.5 * width, 40);
+        painter.setOpacity(fabs(steering) - center_tolerance);
+#elif (DRAW_ARROW_SIGN==1)
+        t.translate(0.5 * (width - turn_sign_rect.width()), 20);
+        if (steering < 0) {
+            t.scale(-1,1);
+            t.translate(-turn_sign_rect.width(),0);
+        }
+        painter.setOpacity(fabs(steering) - center_tolerance);
+#elif (DRAW_ARROW_SIGN==2)
+        t.translate(0.5 * width, 20);
+#else
+        t.translate(0.5 * width, 0);
+#endif
+        painter.setTransform(t);
+#if (DRAW_ARROW_SIGN==0)
+        const qreal mult = steering < 0 ? -1 : 1;
+        const qreal head_x = fabs(steering) * mult * 30;
+        const QPointF head(head_x, 0);
+//        painter.drawPoint(QPointF(0,0));
+//        painter.drawPoint(head);
+        painter.setPen(QPen(Qt::black, 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+        painter.drawLine(QPointF(0,0), head);
+        painter.drawLine(QPointF(head_x - 5*mult, -5), head);
+        painter.drawLine(QPointF(head_x - 5*mult, +5), head);
+#elif (DRAW_ARROW_SIGN==1)
+        Track::images.raster.draw(painter, *turn_sign, turn_sign_rect);
+#elif (DRAW_ARROW_SIGN==2)
+        const qreal scale = 80;
+        const qreal alpha = steering;
+        //const qreal a = 0.5*M_PI + alpha;
+        //QPointF top(cos(a), 1 - 0.4 - 0.4 * sin(a)); top *= scale;
+        QPointF top(alpha, 0.5); top *= scale;
+        QPointF left(-0.4, 1); left *= scale;
+        QPointF right(0.4, 1); right *= scale;
+        QPointF mid(0, 1 * scale);
+        painter.drawLine(top, left);
+        painter.drawLine(top, right);
+        QPainterPath p; p.moveTo(top); p.lineTo(left); p.lineTo(right); p.lineTo(top);
+        painter.fillPath(p, Qt::gray);
+        QPen pen(Qt::white);
+        pen.setStyle(Qt::DashLine);
+        pen.setDashOffset(-current_pos * 0.2);
+        painter.setPen(pen);
+        painter.drawLine(top, mid);
+#else
+        struct path {
+            QPointF p[4];
+            void set(const QPointF p0, const QPointF p1, const QPointF p2, const QPointF p3) {
+                p[0] = p0; p[1] = p1; p[2] = p2; p[3] = p3;
+            }
+            void get_path(QPainterPath& path) {
+                path.moveTo(p[0]);
+                path.cubicTo(p[1], p[2], p[3]);
+            }
+            void get_path_rev(QPainterPath& path) {
+                path.moveTo(p[3]);
+                path.cubicTo(p[2], p[1], p[0]);
+            }
+
+            void draw(QPainter& painter) {
+                QPainterPath path;
+                get_path(path);
+                painter.drawPath(path);
+            }
+            void interp(const path& p2, qreal const t, path& out) {
+                for (int i = 0; i < 4; i++)
+                    out.p[i] = misc::interp(p[i], p2.p[i], t);
+            }
+        };
+        struct road {
+            road() { left *= scale; right *= scale; mid *= scale; }
+            void draw(QPainter& painter, const qreal current_pos) {
+                t[0].draw(painter);
+                t[1].draw(painter);
+
+                // fill with a gray brush
+                QPainterPath path;
+                t[0].get_path(path); path.lineTo(t[1].p[3]);
+                t[1].get_path_rev(path);
+                path.lineTo(t[0].p[0]);
+                painter.fillPath(path, Qt::gray);
+
+                QPen pen(Qt::white);
+                pen.setStyle(Qt::DashLine);
+                pen.setWidth(2);
+                pen.setDashPattern({5, 4});
+                pen.setDashOffset(current_pos * 0.2);
+                painter.setPen(pen);
+                t[2].draw(painter);
+            }
+            void interp(const road& r2, qreal const f, road& r) { // f: weight of r2
+                for (int i = 0; i < 3; i++)
+                    t[i].interp(r2.t[i], f, r.t[i]);
+            }
+
+            path t[3]; // left, right, mid
+            QPointF left = QPointF(-0.4, 1);
+            QPointF right = QPointF(0.4, 1);
+            QPointF mid = QPointF(0, 1);
+            const qreal scale = 160;
+        };
+        struct straight_road : public road {
+            straight_road() {
+                using misc::interp;
+                QPointF top(0, 0.7*scale);
+                t[0].set(left, interp(left, top, 0.25), interp(left, top, 0.75), top);
+                t[1].set(right, interp(right, top, 0.25), interp(right, top, 0.75), top);
+                t[2].set(mid, interp(mid, top, 0.25), interp(mid, top, 0.75), top);
+            }
+        };
+        struct bent_road : public road {
+            const qreal dist = 0.7; // x-distance from center
+            const qreal top_end = 0.56+0.1; // y-values of "end" of the road
+            const qreal bottom_end = 0.65+0.1;
+            const qreal spline1_outer = 0.125; // spline-point-distance of beginning of street of inner/outer/mid line
+            const qreal spline1_inner = 0.1;
+            const qreal spline1_mid = 0.5 * (spline1_inner + spline1_outer);
+            const qreal spline2_outer = 0.2; // spline-point-distance of end of street (of inner/outer/mid line)
+            const qreal spline2_inner = 0.15;
+            const qreal spline2_mid = 0.5 * (spline2_inner + spline2_outer);
+        };
+
+        struct right_road : public bent_road {
+            right_road() {
+                const QPointF left_end = QPointF(dist, top_end) * scale;
+                const QPointF right_end = QPointF(dist, bottom_end) * scale;
+                const QPointF mid_end = QPointF(dist, (top_end+bottom_end)*0.5) * scale;
+                t[0].set(left, left + QPointF(0, -spline1_outer*scale), left_end + QPointF(-spline2_outer * scale, 0), left_end);
+                t[1].set(right, right + QPointF(0, -spline1_inner*scale), right_end + QPointF(-spline2_inner * scale, 0), right_end);
+                t[2].set(mid, mid + QPointF(0, -spline1_mid*scale), mid_end + QPointF(-spline2_mid * scale, 0), mid_end);
+            }
+        };
+        struct left_road : public bent_road {
+            left_road() {
+                const QPointF left_end = QPointF(-dist, bottom_end) * scale;
+                const QPointF right_end = QPointF(-dist, top_end) * scale;
+                const QPointF mid_end = QPointF(-dist, (top_end+bottom_end)*0.5) * scale;
+                t[0].set(left, left + QPointF(0, -spline1_inner*scale), left_end + QPointF(spline2_inner * scale, 0), left_end);
+                t[1].set(right, right + QPointF(0, -spline1_outer*scale), right_end + QPointF(spline2_outer * scale, 0), right_end);
+                t[2].set(mid, mid + QPointF(0, -spline1_mid*scale), mid_end + QPointF(spline2_mid * scale, 0), mid_end);
+            }
+        };
+
+        static straight_road straight;
+        static right_road right;
+        static left_road left;
+        road out;
+        if (steering >= 0)
+            straight.interp(right, steering, out);
+        else
+            straight.interp(left, -steering, out);
+        out.draw(painter, current_pos);
+#endif
+        painter.setOpacity(1.0);
+    }
+    clock.lap(FrameArrow);
+}
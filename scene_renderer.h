@@ -0,0 +1,56 @@
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+#include <QPainter>
+#include <QImage>
+#include <QSvgRenderer>
+#include <memory>
+#include <random>
+#include "hud.h"
+#include "track.h"
+#include "tiled_track.h"
+#include "render_snapshot.h"
+#include "frame_timing.h"
+
+// SceneRenderer draws a RenderSnapshot: the road, the signs, the trees, the car, the steering arrow and the hud.
+// it holds its own copy of the track and the caches of the drawing (tiles, sprites, hud layers), one renderer
+// per thread. QCarViz draws its frames with it, tools/export_video renders replays offscreen with several.
+// the sign images (Track::images) are shared by all renderers
+class SceneRenderer
+{
+public:
+    // seed: of the trees (renderers with the same seed and track draw the same trees)
+    SceneRenderer(const quint64 seed = std::random_device{}());
+
+    // a copy of track, laid out for height (as SimulationCore::update_track_path)
+    void set_track(const Track& track, const qreal height);
+    // new trees along the track
+    void fill_trees();
+    // drops the cached images (e.g. for another device pixel ratio)
+    void clear_caches();
+
+    // the scene of s in size, hud_external: without the hud (drawn by QHudWidget) and the road further up.
+    // timing: the times of the sections are added to it
+    void draw(QPainter& painter, const RenderSnapshot& s, const QSize& size, const bool hud_external = false,
+              FrameTiming* timing = nullptr);
+
+    const TiledTrack& get_track_tiles() const { return track_tiles; }
+    HUD hud;
+
+protected:
+    void add_tree_type(const QString name, const qreal scale, const qreal y_offset);
+    void draw_trees(QPainter& painter, const QTransform& t0, const qreal car_x_pos, const QPointF& cur_p,
+                    const qreal kmh, const qreal width);
+
+    Track track; // copy of the track of the core (its signs are changed by the simulation)
+    std::vector<int> traffic_light_of_sign; // index in RenderSnapshot::traffic_lights of every sign (-1: no light)
+    TiledTrack track_tiles; // path of track, for drawing
+    QImage car_img;
+    QVector<TreeType> tree_types;
+    TreeIndex trees;
+    std::mt19937_64 tree_rng;
+    std::unique_ptr<QSvgRenderer> turn_sign;
+    QRectF turn_sign_rect;
+};
+
+#endif // SCENE_RENDERER_H
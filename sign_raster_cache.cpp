@@ -0,0 +1,63 @@
+#include "sign_raster_cache.h"
+#include <QPaintEngine>
+
+const QPixmap* SignRasterCache::find(QPainter& painter, const void* source, const QRectF& rect, QSize& size, qreal& ratio)
+{
+    const QPaintEngine* engine = painter.paintEngine();
+    if (!painter.device() || (engine && (engine->type() == QPaintEngine::SVG || engine->type() == QPaintEngine::Pdf)))
+        return nullptr;
+    ratio = painter.device()->devicePixelRatioF();
+    size = QSize(qMax(1, qRound(rect.width() * ratio)), qMax(1, qRound(rect.height() * ratio)));
+    static const QPixmap none;
+    auto it = pixmaps.find(Key(source, size.width(), size.height(), qRound(ratio * 100)));
+    return it != pixmaps.end() ? &it->second : &none;
+}
+
+const QPixmap& SignRasterCache::insert(const void* source, const QSize& size, const qreal ratio, const QImage& image)
+{
+    QPixmap& pixmap = pixmaps[Key(source, size.width(), size.height(), qRound(ratio * 100))];
+    pixmap = QPixmap::fromImage(image);
+    pixmap.setDevicePixelRatio(ratio);
+    return pixmap;
+}
+
+void SignRasterCache::draw(QPainter& painter, QSvgRenderer& svg, const QRectF& rect)
+{
+    QSize size;
+    qreal ratio = 1;
+    QMutexLocker lock(&mutex);
+    const QPixmap* pixmap = find(painter, &svg, rect, size, ratio);
+    if (!pixmap) {
+        svg.render(&painter, rect);
+        return;
+    }
+    if (pixmap->isNull()) {
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter p(&image);
+        svg.render(&p, QRectF(QPointF(0, 0), size));
+        p.end();
+        pixmap = &insert(&svg, size, ratio, image);
+    }
+    const QPixmap blit = *pixmap; // shared copy, the blit doesn't need the lock
+    lock.unlock();
+    painter.drawPixmap(rect.topLeft(), blit);
+}
+
+void SignRasterCache::draw(QPainter& painter, const QImage& img, const QRectF& rect)
+{
+    QSize size;
+    qreal ratio = 1;
+    QMutexLocker lock(&mutex);
+    const QPixmap* pixmap = find(painter, &img, rect, size, ratio);
+    if (!pixmap) {
+        lock.unlock();
+        painter.drawImage(rect, img);
+        return;
+    }
+    if (pixmap->isNull())
+        pixmap = &insert(&img, size, ratio, img.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    const QPixmap blit = *pixmap;
+    lock.unlock();
+    painter.drawPixmap(rect.topLeft(), blit);
+}
@@ -0,0 +1,36 @@
+#ifndef SIGN_RASTER_CACHE_H
+#define SIGN_RASTER_CACHE_H
+
+#include <QPainter>
+#include <QPixmap>
+#include <QImage>
+#include <QSvgRenderer>
+#include <QMutex>
+#include <map>
+#include <tuple>
+
+// SignRasterCache renders the sign images (SVGs: signs, traffic light states, pole, turn sign) once per size and
+// device pixel ratio into QPixmaps: drawing a sign is a blit, no SVG parsing and tessellation in the frame loop.
+// the pixmaps of another size or ratio are rendered when they are first drawn, clear() drops them all (resize).
+// Track::images (with its cache) is shared by all SceneRenderers, draw() may be called by several threads
+class SignRasterCache
+{
+public:
+    // at rect.topLeft() in the size of rect (as QSvgRenderer::render / QPainter::drawImage into rect)
+    void draw(QPainter& painter, QSvgRenderer& svg, const QRectF& rect);
+    void draw(QPainter& painter, const QImage& img, const QRectF& rect);
+
+    void clear() { QMutexLocker lock(&mutex); pixmaps.clear(); }
+    int size() const { QMutexLocker lock(&mutex); return (int) pixmaps.size(); }
+
+protected:
+    typedef std::tuple<const void*, int, int, int> Key; // source, device pixel size, device pixel ratio * 100
+    // the pixmap of source for rect on the device of painter, null if painter doesn't paint on pixels (e.g. svg)
+    const QPixmap* find(QPainter& painter, const void* source, const QRectF& rect, QSize& size, qreal& ratio);
+    const QPixmap& insert(const void* source, const QSize& size, const qreal ratio, const QImage& image);
+
+    std::map<Key, QPixmap> pixmaps;
+    mutable QMutex mutex; // held for find and insert (and for the shared svg renderers)
+};
+
+#endif // SIGN_RASTER_CACHE_H
@@ -0,0 +1,325 @@
+#include "simulation_core.h"
+#include "speed_observer.h"
+#include "logging.h"
+#include "driver_model.h"
+#include "vehicle_spec.h"
+
+Track::Images Track::images;
+constexpr qreal SimulationCore::PATH_UNITS_PER_METER;
+constexpr qreal SimulationCore::initial_pos;
+
+SimulationCore::SimulationCore(OSCSender* osc)
+    : car(osc), sign_triggers(new SignTriggerQueue)
+{
+    consumption_monitor.osc = osc;
+
+    turnSignObserver = new SignObserver<TurnSignObserver>(*this);
+    signObserver.push_back(turnSignObserver);
+    signObserver.push_back(new SignObserver<StopSignObserver>(*this));
+    signObserver.push_back(new SignObserver<TrafficLightObserver>(*this));
+    signObserver.push_back(new SignObserver<SpeedObserver>(*this));
+    for (auto o : signObserver)
+        sign_triggers->add(o);
+    tooslow_observer_.reset(new TooSlowObserver(*this));
+}
+
+SimulationCore::~SimulationCore()
+{
+    for (auto o : signObserver)
+        delete o;
+}
+
+void SimulationCore::prepare_track(const qreal height)
+{
+    track.prepare_track();
+    update_track_path(height); // the signs are sorted now: builds traffic_light_indices
+    timers.clear();
+    sign_triggers->reset();
+    tooslow_observer_->reset();
+}
+
+void SimulationCore::update_traffic_light_indices()
+{
+    traffic_light_indices.clear();
+    for (int i = 0; i < track.signs.size(); i++)
+        if (track.signs[i].type == Track::Sign::TrafficLight)
+            traffic_light_indices.push_back(i);
+}
+
+bool SimulationCore::has_all_traffic_lights() const
+{
+    size_t n = 0;
+    for (int i = 0; i < track.signs.size(); i++) {
+        if (track.signs[i].type != Track::Sign::TrafficLight)
+            continue;
+        if (n >= traffic_light_indices.size() || traffic_light_indices[n] != i)
+            return false;
+        n++;
+    }
+    return n == traffic_light_indices.size();
+}
+
+void SimulationCore::reset()
+{
+    update_traffic_light_indices();
+    vehicle_kernel = specialize_vehicle ? VehicleRegistry::create(car) : nullptr;
+    current_pos = initial_pos;
+    previous_pos = current_pos;
+    track_tiles.update(current_pos);
+    accumulator = 0;
+    steering = 0;
+    car.reset(replay);
+    consumption_monitor.reset();
+    if (!replay)
+        track_started = false;
+    else if (car.log)
+        rng.seed(car.log->seed); // the same phases as the recorded run
+    for (Track::Sign& s : track.signs) {
+        if (s.type == Track::Sign::TrafficLight)
+            s.traffic_light_state = Track::Sign::Red;
+    }
+    timers.clear();
+    sign_triggers->reset();
+    tooslow_observer_->reset();
+}
+
+void SimulationCore::start_track()
+{
+    track_started = true;
+    track_started_time = time;
+    // the fixed steps of the log start with the run, as in the replay (reset: no time left over)
+    accumulator = 0;
+    previous_pos = current_pos;
+    rng.seed(seed);
+    car.log.reset(new Log(&car, this, &track));
+    car.log->seed = seed;
+    seed = std::random_device{}(); // the next run differs, unless set_seed() is called again
+    car.log->initial_angular_velocity = car.engine.angular_velocity;
+    car.log->integrator = integrator;
+    qDebug() << "starting new log";
+}
+
+bool SimulationCore::read_replay_item(qreal& dt)
+{
+    Q_ASSERT(replay && car.log);
+    Log& log = *car.log;
+    if (replay_index >= log.items.size()) {
+        qDebug() << "elapsed_time:" << time_elapsed();
+        qDebug() << "deciliters_used:" << consumption_monitor.liters_used * 10;
+        return false;
+    }
+    const LogItem& log_item = log.items[replay_index];
+    dt = log_item.dt;
+    car.braking = log_item.braking;
+    car.gearbox.set_gear(log_item.gear);
+    car.throttle = log_item.throttle;
+    eye_tracker_point = log_item.eye_tracker_point;
+    user_steering = log_item.user_steering;
+    if (fill_json_) {
+        LogItemJson& log_item_json = log.items_json[replay_index];
+        (LogItem&) log_item_json = log_item;
+        log_item_json.speed = get_kmh();
+        log_item_json.position = current_pos;
+        log_item_json.rpm = car.engine.rpm();
+        log_item_json.acceleration = car.current_acceleration;
+        log_item_json.consumption = car.engine.get_consumption_L_s();
+        log_item_json.rel_consumption = consumption_monitor.l_100km_instantaneous(car.engine.get_consumption_L_s(), car.speed);
+        log_item_json.rel_consumption_slow = l_100km;
+        log_item_json.pos = track_tiles.point_at(current_pos);
+    }
+    replay_index++;
+    return true;
+}
+
+void SimulationCore::tick(const qreal frame_dt)
+{
+    const Integrator& current = current_integrator();
+    // a stalled frame is cut for everything (time, observers, log item and physics), so they stay together
+    const qreal dt = current.fixed_step ? std::min(frame_dt, current.max_frame_dt) : frame_dt;
+    time += dt;
+    timers.advance(time);
+    const qreal t = time_elapsed();
+
+    steer(user_steering);
+    scripted_steering = 0;
+    sign_triggers->tick(current_pos, replay, t, dt);
+    tooslow_observer_->tick(t);
+
+    if (replay) {
+        if (fill_json_) {
+            LogItemJson& log_item_json = car.log->items_json[replay_index-1]; // replay_index was incremented before!
+            log_item_json.scripted_steering = scripted_steering;
+            log_item_json.steering = steering;
+        }
+        for ( ; ; ) {
+            LogEvent* event = car.log->next_event(replay_index);
+            if (!event)
+                break;
+            if (listener) {
+                if (event->type == LogEvent::TooSlow)
+                    listener->show_too_slow();
+                else
+                    listener->show_traffic_violation((TrafficViolation) event->type); // carful! (casting)
+            }
+            qDebug() << "Log:" << event->type;
+        }
+    }
+
+    // logging (after the observers: their events belong to this item)
+    if (car.log && !replay)
+        car.log->add_item(car.throttle, car.braking, car.gearbox.get_gear(), dt);
+
+    if (!current.fixed_step) {
+        step(dt, current.scheme);
+        previous_pos = current_pos;
+        accumulator = 0;
+    } else {
+        const qreal h = current.step();
+        accumulator += dt;
+        while (accumulator >= h) {
+            previous_pos = current_pos;
+            step(h, current.scheme);
+            accumulator -= h;
+        }
+    }
+    track_tiles.update(current_pos); // drops the tiles the car left behind
+    if (run_finished()) {
+        Q_ASSERT(car.log != nullptr);
+        car.log->elapsed_time = t;
+        car.log->liters_used = consumption_monitor.liters_used;
+    }
+    double l_100km;
+    if (consumption_monitor.get_l_100km(l_100km, car.speed))
+        this->l_100km = l_100km;
+}
+
+void SimulationCore::step(const qreal dt, const Integrator::Scheme scheme)
+{
+    // automatic clutch control
+    if (track_started)
+        car.gearbox.auto_clutch_control(&car);
+
+    const qreal alpha = alpha_at(track_tiles, current_pos);
+    Q_ASSERT(!isnan(alpha));
+    const bool specialized = vehicle_kernel && scheme == Integrator::SemiImplicitEuler;
+    if (specialized)
+        vehicle_kernel->tick(car, dt, alpha);
+    else
+        car.tick(dt, alpha, scheme);
+    if (track_started) {
+        const qreal liters_s = specialized ? vehicle_kernel->consumption_L_s(car.engine) : car.engine.get_consumption_L_s();
+        consumption_monitor.tick(liters_s, dt, car.speed);
+    } else {
+        Q_ASSERT(!replay);
+        car.speed = 0;
+    }
+    current_pos += car.speed * dt * PATH_UNITS_PER_METER;
+}
+
+const Integrator& SimulationCore::current_integrator() const
+{
+    return replay && car.log ? car.log->integrator : integrator;
+}
+
+bool SimulationCore::load_log(const QString filename, const qreal height)
+{
+    car.log.reset(new Log(&car, this, &track));
+    if (!misc::loadObj(filename, *car.log))
+        return false;
+    return start_replay(height);
+}
+
+bool SimulationCore::load_log_data(const QByteArray& data, const qreal height)
+{
+    car.log.reset(new Log(&car, this, &track));
+    QDataStream in(data);
+    in >> *car.log;
+    return start_replay(height);
+}
+
+bool SimulationCore::start_replay(const qreal height)
+{
+    std::shared_ptr<Log>& log = car.log;
+    if (!log->valid) {
+        qDebug() << "wrong version!";
+        return false;
+    }
+    qDebug() << "log: elapsed_time:" << log->elapsed_time;
+    qDebug() << "log: deciliters_used:" << log->liters_used * 10;
+    prepare_track(height);
+    restart_replay();
+    qDebug() << "log: initial rpm:" << car.engine.rpm();
+    qDebug() << "log: integrator:" << Integrator::scheme_name(log->integrator.scheme)
+             << (log->integrator.fixed_step ? log->integrator.rate : 0) << "Hz";
+    return true;
+}
+
+void SimulationCore::restart_replay()
+{
+    Q_ASSERT(car.log && car.log->valid);
+    replay = true;
+    replay_index = 0;
+    seed = car.log->seed;
+    rng.seed(seed);
+    track_started = true;
+    track_started_time = time;
+    car.engine.angular_velocity = car.log->initial_angular_velocity;
+    current_pos = track_tiles.length(); // the next start() resets the car
+    previous_pos = current_pos;
+    accumulator = 0;
+}
+
+void SimulationCore::log_run(const bool fill_json)
+{
+    Q_ASSERT(replay && car.log);
+    if (fill_json)
+        car.log->items_json.resize(car.log->items.size());
+    log_run_ = true;
+    fill_json_ = fill_json;
+    if (current_pos >= track_tiles.length())
+        reset();
+    qreal dt;
+    while (read_replay_item(dt))
+        tick(dt);
+    replay = false;
+    log_run_ = false;
+    fill_json_ = false;
+    car.log->log_run_finished = fill_json;
+}
+
+bool SimulationCore::drive_run(Driver& driver, const qreal frame_dt, const qreal timeout)
+{
+    replay = false;
+    reset();
+    driver.reset(*this);
+    const qreal t0 = time;
+    while (!run_finished()) {
+        if (time - t0 > timeout) {
+            qDebug() << "drive_run: timeout at" << current_pos << "of" << track_tiles.length();
+            return false;
+        }
+        user_steering = 0;
+        driver.drive(*this, frame_dt);
+        if (!track_started && car.throttle > 0)
+            start_track();
+        tick(frame_dt);
+    }
+    return true;
+}
+
+void SimulationCore::trigger_arrow()
+{
+    std::uniform_int_distribution<int> dir(0,1);
+    arrow_sign = Track::Sign(!dir(arrow_rng) ? Track::Sign::TurnLeft : Track::Sign::TurnRight, 0);
+    Q_ASSERT(turnSignObserver != nullptr);
+    turnSignObserver->trigger(&arrow_sign, time_elapsed());
+}
+
+void SimulationCore::log_traffic_violation(const TrafficViolation violation)
+{
+    if (!replay) {
+        if (listener)
+            listener->show_traffic_violation(violation);
+        car.log->add_event((LogEvent::Type) violation); // careful! (casting..)
+    }
+}
@@ -0,0 +1,188 @@
+#ifndef SIMULATION_CORE_H
+#define SIMULATION_CORE_H
+
+#include <QPainterPath>
+#include <QPointF>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "car.h"
+#include "track.h"
+#include "tiled_track.h"
+#include "timer_wheel.h"
+
+enum TrafficViolation {
+    Speeding,
+    StopSign,
+    TrafficLight,
+};
+
+enum Condition {
+    VIS = 0,
+    SLP = 1,
+    CNT = 2,
+    NO_CONDITION = 3,
+};
+
+class SignObserverBase;
+class SignTriggerQueue;
+class TurnSignObserver;
+struct TooSlowObserver;
+struct Log;
+class Driver;
+class VehicleKernel;
+
+// feedback the simulation wants to give to the driver (flash, honk, text hints, ..)
+// QCarViz implements this, headless runs simply don't set a listener
+struct SimulationListener {
+    virtual ~SimulationListener() {}
+    virtual void show_traffic_violation(const TrafficViolation /*violation*/) {}
+    virtual void show_too_slow() {}
+};
+
+// SimulationCore runs the whole simulation step (observers, auto-clutch, Car::tick, consumption, position, log)
+// without any widgets. QCarViz only feeds the input into it and renders its state.
+class SimulationCore
+{
+public:
+    friend class SignObserverBase;
+    friend struct TooSlowObserver;
+
+    SimulationCore(OSCSender* osc = nullptr);
+    ~SimulationCore();
+
+    void set_osc(OSCSender* osc) {
+        car.osc = osc;
+        consumption_monitor.osc = osc;
+    }
+    void set_listener(SimulationListener* listener) { this->listener = listener; }
+
+    void update_track_path(const qreal height) {
+        update_traffic_light_indices();
+        track_tiles.set_track(track, height);
+        track_tiles.update(current_pos);
+    }
+    void prepare_track(const qreal height);
+    void reset();
+
+    // starts logging a new run (the user pressed the throttle for the first time)
+    void start_track();
+    // seed of the random numbers (the traffic light phases) of the next run, stored in its log.
+    // without a call every run gets a seed of its own
+    void set_seed(const quint32 seed) { this->seed = seed; }
+    // reads the input of the next log item into the car, returns false when the replay is finished
+    bool read_replay_item(qreal& dt);
+    // one simulation step (frame), the input (car.throttle, car.braking, gear, user_steering) has to be set before.
+    // the physics runs in fixed steps of the current integrator (or once with frame_dt for legacy replays),
+    // with fixed steps a frame longer than Integrator::max_frame_dt is cut to it (the simulated time as well)
+    void tick(const qreal frame_dt);
+    // the integrator of the running simulation: the one of the log when replaying, integrator otherwise
+    const Integrator& current_integrator() const;
+    // position to render: interpolated between the last two physics steps
+    qreal get_render_pos() const {
+        const Integrator& i = current_integrator();
+        const qreal alpha = i.fixed_step ? std::min(accumulator * i.rate, 1.) : 1;
+        return previous_pos + (current_pos - previous_pos) * alpha;
+    }
+    // true once the car reached the end of the track in a live (not replayed) run
+    bool run_finished() const {
+        return !replay && track_tiles.length() > initial_pos && current_pos >= track_tiles.length();
+    }
+
+    // loads the log (and its track and car configuration) for a replay
+    bool load_log(const QString filename, const qreal height);
+    // same as load_log, from the content of a log file
+    bool load_log_data(const QByteArray& data, const qreal height);
+    // starts the replay of the loaded log again, without parsing it or preparing its track again
+    // (e.g. after changing the configuration of the car)
+    void restart_replay();
+    // replays the loaded log as fast as possible and fills its json-items (if fill_json)
+    void log_run(const bool fill_json = true);
+    // a live run on the prepared track without a human: the driver gives the input, frames of frame_dt [s].
+    // returns false if the end was not reached within timeout [s] of simulated time
+    bool drive_run(Driver& driver, const qreal frame_dt = 1./60, const qreal timeout = 30*60);
+
+    void trigger_arrow();
+    void log_traffic_violation(const TrafficViolation violation);
+
+    Log* log() { return car.log.get(); }
+    bool is_replaying() const { return replay; }
+    bool is_log_run() const { return log_run_; }
+    qreal get_kmh() const { return Gearbox::speed2kmh(car.speed); }
+    qreal get_user_steering() const { return user_steering; }
+    QPointF& get_eye_tracker_point() { return eye_tracker_point; }
+    const Car* get_car() const { return &car; }
+    qreal get_current_pos() const { return current_pos; }
+    const TiledTrack& get_track_tiles() const { return track_tiles; }
+    qreal time_elapsed() const { return time - track_started_time; }
+
+    // up/downhill [rad] at pos (on path: TrackSampler or TiledTrack)
+    template<typename Path>
+    static qreal alpha_at(const Path& path, const qreal pos) {
+        const qreal alpha_scale = 0.8;
+        return path.empty() ? 0 : (alpha_scale * atan(-path.slope_at(pos))); // slope [rad]
+    }
+
+    void steer(const qreal val) {
+        steering = std::min(std::max(steering + val, -1.), 1.);
+    }
+    void set_scripted_steering(qreal const steering) { scripted_steering = steering; }
+
+    Car car;
+    Track track;
+    TiledTrack track_tiles; // the track path, tiles around current_pos (for drawing and the lookups by position)
+    // of the traffic lights in track.signs, built again whenever the signs may have changed
+    // (prepare_track, update_track_path, reset)
+    std::vector<int> traffic_light_indices;
+    // true if traffic_light_indices lists every traffic light of track.signs (for the checks)
+    bool has_all_traffic_lights() const;
+    ConsumptionMonitor consumption_monitor;
+
+    static constexpr qreal PATH_UNITS_PER_METER = 3; // track_path units the car moves per meter
+    static constexpr qreal initial_pos = 40;
+    qreal current_pos = initial_pos; // current position of the car. max is: track_tiles.length()
+    qreal steering = 0; // between -1 (left) and 1 (right)
+    qreal user_steering = 0;
+    qreal scripted_steering = 0;
+    QPointF eye_tracker_point;
+    qreal l_100km = 0; // averaged consumption (for the hud)
+    Integrator integrator; // for live runs (stored in the log)
+    bool specialize_vehicle = true; // use a compile time specialized tick (VehicleRegistry) if one fits the car
+
+    qreal time = 0; // simulated time [s]
+    TimerWheel timers; // events in simulated time (the phases of the traffic lights), advanced by tick()
+    bool track_started = false;
+    qreal track_started_time = 0;
+
+    bool replay = false;
+    int replay_index = 0;
+
+    quint32 seed = std::random_device{}(); // of the next (or the replayed) run
+    std::mt19937_64 rng{seed}; // seeded again when a run starts, never shared with other cores
+
+protected:
+    void update_traffic_light_indices();
+    // starts the replay of the freshly loaded car.log
+    bool start_replay(const qreal height);
+    // advances the physics by dt (auto-clutch, Car::tick, consumption, position)
+    void step(const qreal dt, const Integrator::Scheme scheme);
+
+    qreal accumulator = 0; // [s] simulated time not yet covered by fixed steps
+    qreal previous_pos = initial_pos; // current_pos before the last physics step
+    // picked when a run starts (reset), changes to the car configuration during a run are not seen
+    std::unique_ptr<VehicleKernel> vehicle_kernel;
+
+    std::unique_ptr<TooSlowObserver> tooslow_observer_;
+    std::vector<SignObserverBase*> signObserver;
+    std::unique_ptr<SignTriggerQueue> sign_triggers; // ticks signObserver
+    TurnSignObserver* turnSignObserver = nullptr;
+    SimulationListener* listener = nullptr;
+    bool log_run_ = false;
+    bool fill_json_ = false;
+    // the arrows of trigger_arrow (live runs only): their own generator, so that they don't shift the light phases
+    std::mt19937_64 arrow_rng{std::random_device{}()};
+    Track::Sign arrow_sign; // the last triggered arrow (turnSignObserver keeps a pointer to it)
+};
+
+#endif // SIMULATION_CORE_H
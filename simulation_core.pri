@@ -0,0 +1,74 @@
+# Widget-free simulation core (Car, Track, observers, logging).
+# Included by car_simulator.pro and by the standalone library target simulation_core.pro
+
+INCLUDEPATH += $$PWD \
+    $$PWD/lib/oscpack_1_1_0 \
+    $$PWD/lib/quazip/quazip \
+    /usr/local/Cellar/boost/1.67.0_1/include
+
+LIBS += -L$$PWD/lib/quazip/release -lquazip -lz
+
+# SIMD kernels of VehicleBatch: SSE2 by default, AVX2 with CONFIG+=avx2
+avx2: QMAKE_CXXFLAGS += -mavx2 -mfma
+
+SOURCES += $$PWD/car.cpp \
+    $$PWD/engine.cpp \
+    $$PWD/consumption_map.cpp \
+    $$PWD/simulation_core.cpp \
+    $$PWD/driver_model.cpp \
+    $$PWD/vehicle_batch.cpp \
+    $$PWD/vehicle_spec.cpp \
+    $$PWD/track_sampler.cpp \
+    $$PWD/tiled_track.cpp \
+    $$PWD/track_file.cpp \
+    $$PWD/sign_raster_cache.cpp \
+    $$PWD/min_speed_profile.cpp \
+    $$PWD/track_generator.cpp \
+    $$PWD/lib/oscpack_1_1_0/osc/OscOutboundPacketStream.cpp \
+    $$PWD/lib/oscpack_1_1_0/osc/OscPrintReceivedElements.cpp \
+    $$PWD/lib/oscpack_1_1_0/osc/OscReceivedElements.cpp \
+    $$PWD/lib/oscpack_1_1_0/osc/OscTypes.cpp \
+    $$PWD/lib/oscpack_1_1_0/ip/IpEndpointName.cpp \
+    $$PWD/lib/oscpack_1_1_0/ip/posix/NetworkingUtils.cpp \
+    $$PWD/lib/oscpack_1_1_0/ip/posix/UdpSocket.cpp
+
+HEADERS += $$PWD/simulation_core.h \
+    $$PWD/render_snapshot.h \
+    $$PWD/frame_timing.h \
+    $$PWD/driver_model.h \
+    $$PWD/vehicle_batch.h \
+    $$PWD/vehicle_spec.h \
+    $$PWD/car.h \
+    $$PWD/engine.h \
+    $$PWD/gearbox.h \
+    $$PWD/torque_map.h \
+    $$PWD/consumption_map.h \
+    $$PWD/grid2d.h \
+    $$PWD/resistances.h \
+    $$PWD/integrator.h \
+    $$PWD/work_stealing_pool.h \
+    $$PWD/track.h \
+    $$PWD/track_sampler.h \
+    $$PWD/tiled_track.h \
+    $$PWD/track_file.h \
+    $$PWD/sign_raster_cache.h \
+    $$PWD/track_generator.h \
+    $$PWD/timer_wheel.h \
+    $$PWD/speed_observer.h \
+    $$PWD/min_speed_profile.h \
+    $$PWD/logging.h \
+    $$PWD/misc.h \
+    $$PWD/OSCSender.h \
+    $$PWD/lib/oscpack_1_1_0/osc/MessageMappingOscPacketListener.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscException.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscHostEndianness.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscOutboundPacketStream.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscPacketListener.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscPrintReceivedElements.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscReceivedElements.h \
+    $$PWD/lib/oscpack_1_1_0/osc/OscTypes.h \
+    $$PWD/lib/oscpack_1_1_0/ip/IpEndpointName.h \
+    $$PWD/lib/oscpack_1_1_0/ip/NetworkingUtils.h \
+    $$PWD/lib/oscpack_1_1_0/ip/PacketListener.h \
+    $$PWD/lib/oscpack_1_1_0/ip/TimerListener.h \
+    $$PWD/lib/oscpack_1_1_0/ip/UdpSocket.h
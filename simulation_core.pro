@@ -0,0 +1,14 @@
+#-------------------------------------------------
+#
+# Headless simulation core (no QtWidgets, no QApplication needed)
+#
+#-------------------------------------------------
+
+QT       += core gui svg
+QT       -= widgets
+
+TARGET = simulation_core
+TEMPLATE = lib
+CONFIG += staticlib c++11
+
+include(simulation_core.pri)
@@ -0,0 +1,129 @@
+#include "simulation_thread.h"
+
+void SimulationThread::stop_thread()
+{
+    quit_ = true;
+    wait();
+}
+
+void SimulationThread::set_input(const SimulationInput& input)
+{
+    QMutexLocker lock(&input_mutex);
+    this->input = input;
+}
+
+SimulationInput SimulationThread::get_input()
+{
+    QMutexLocker lock(&input_mutex);
+    return input;
+}
+
+void SimulationThread::set_eye_tracker_point(const QPointF& p)
+{
+    QMutexLocker lock(&input_mutex);
+    eye_tracker_point = p;
+    eye_tracker_timer.start();
+}
+
+void SimulationThread::set_running(const bool running)
+{
+    QMutexLocker lock(&mutex); // no step is in progress when this returns
+    if (running && core)
+        replay_time = core->time;
+    this->running = running;
+}
+
+void SimulationThread::run()
+{
+    Q_ASSERT(core);
+    const qint64 interval = (qint64) (1e9 / rate); // [ns]
+    QElapsedTimer clock;
+    clock.start();
+    qint64 next = clock.nsecsElapsed();
+    while (!quit_) {
+        {
+            QMutexLocker lock(&mutex);
+            if (running) {
+                const qint64 step_start = clock.nsecsElapsed();
+                step(interval * 1e-9);
+                step_nsecs += clock.nsecsElapsed() - step_start;
+            }
+            publish();
+        }
+        if (!running) {
+            msleep(10); // nothing to simulate, only the snapshot is kept up to date
+            next = clock.nsecsElapsed();
+            continue;
+        }
+        // the next step is due one interval after the last one was due (not after it was done)
+        next += interval;
+        const qint64 now = clock.nsecsElapsed();
+        if (now - next > 10 * interval)
+            next = now; // far behind (suspended, debugger): don't catch up
+        else if (next > now)
+            usleep((next - now) / 1000);
+    }
+}
+
+void SimulationThread::step(const qreal dt)
+{
+    SimulationCore& core = *this->core;
+    Car& car = core.car;
+    steps++;
+    if (core.replay) {
+        // the log items have the dt of the frames they were recorded with
+        replay_time += dt * replay_speed;
+        for (int i = 0; core.time < replay_time && i < 1000; i++) {
+            qreal item_dt;
+            core.user_steering = 0;
+            if (!core.read_replay_item(item_dt)) {
+                running = false;
+                emit replay_finished();
+                return;
+            }
+            core.tick(item_dt);
+        }
+        send_parameters();
+        return;
+    }
+
+    {
+        QMutexLocker lock(&input_mutex);
+        car.throttle = input.throttle;
+        car.braking = input.braking;
+        core.user_steering = input.steering * dt;
+        const bool eye_tracking = eye_tracker_timer.isValid() && eye_tracker_timer.elapsed() <= 1000;
+        core.eye_tracker_point = eye_tracking ? eye_tracker_point : QPointF();
+    }
+    if (!core.track_started && car.throttle > 0)
+        core.start_track();
+    core.tick(dt);
+    send_parameters();
+    if (core.run_finished()) {
+        running = false;
+        emit run_finished();
+    }
+}
+
+void SimulationThread::send_parameters()
+{
+    const Car& car = core->car;
+    if (!car.osc || core->time - last_osc_time < OSC_INTERVAL)
+        return;
+    last_osc_time = core->time;
+    car.osc->send_float("/rpm", 0.1 + car.engine.rel_rpm() * 0.8);
+    car.osc->send_float("/ml_sec", core->consumption_monitor.liters_per_second_cont * 1000);
+    car.osc->send_float("/L_100km", core->consumption_monitor.liters_per_100km_cont);
+    const qreal alpha = SimulationCore::alpha_at(core->track_tiles, core->current_pos);
+    car.osc->send_float("/uphill_resistance", resistances::uphill(car.mass, alpha));
+}
+
+void SimulationThread::publish()
+{
+    if (!core)
+        return;
+    RenderSnapshot& s = snapshots.write_buffer();
+    s.capture(*core, steps);
+    s.step_nsecs = step_nsecs;
+    snapshots.publish();
+}
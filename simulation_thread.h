@@ -0,0 +1,90 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <QThread>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QPointF>
+#include <atomic>
+#include "simulation_core.h"
+#include "render_snapshot.h"
+#include "triple_buffer.h"
+
+// the input of the driver for the next steps, set by the gui thread
+struct SimulationInput {
+    qreal throttle = 0;
+    qreal braking = 0;
+    qreal steering = 0; // user steering per second (keyboard, wheel)
+};
+
+// SimulationThread runs the simulation steps (SimulationCore::tick) at a fixed rate, independent of painting:
+// a slow frame doesn't stretch a step and doesn't delay the OSC output of the car. after every step the state
+// is published as a RenderSnapshot, the gui draws the latest one (snapshot()).
+// the core is only touched by the thread while it is running, with core_mutex() held for a step. whoever
+// changes the core from the outside (load, reset, gear changes, ..) holds core_mutex() as well.
+class SimulationThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    static constexpr qreal OSC_INTERVAL = 0.05; // [s]
+
+    SimulationThread(const qreal rate = 240) : rate(rate) {}
+    ~SimulationThread() { stop_thread(); }
+
+    void set_core(SimulationCore* core) { this->core = core; }
+    // ends the thread (blocks until it is finished)
+    void stop_thread();
+
+    // live input (the pedals and the steering), used by every step until the next call
+    void set_input(const SimulationInput& input);
+    SimulationInput get_input();
+    // the point of the eye tracker (any thread). dropped if there is no update for a second
+    void set_eye_tracker_point(const QPointF& p);
+
+    // the thread runs the simulation (or the replay of the core), false: the core is left alone
+    void set_running(const bool running);
+    bool is_running() const { return running; }
+    // steps of the replay per step of time (fast forward)
+    void set_replay_speed(const int speed) { replay_speed = speed; }
+
+    // held for every step, lock it (recursive) to change the core while the thread is running
+    QMutex& core_mutex() { return mutex; }
+    // publishes the state of the core right now (core_mutex() has to be held), e.g. after a reset
+    void publish();
+    // gui thread only: the latest published step, valid until the next call
+    const RenderSnapshot& snapshot() { return snapshots.read(); }
+
+signals:
+    // the car reached the end of the track (live run), the thread stopped running
+    void run_finished();
+    // the replay ran out of log items, the thread stopped running
+    void replay_finished();
+
+protected:
+    void run() override;
+    // one interval of the fixed rate (core_mutex() is held)
+    void step(const qreal dt);
+    // the sound parameters (rpm, consumption, uphill resistance) every OSC_INTERVAL of simulated time
+    void send_parameters();
+
+    SimulationCore* core = nullptr;
+    const qreal rate; // steps per second
+    QMutex mutex { QMutex::Recursive };
+    std::atomic<bool> quit_ { false };
+    std::atomic<bool> running { false };
+    std::atomic<int> replay_speed { 1 };
+    qreal replay_time = 0; // simulated time the replay has to reach
+    qreal last_osc_time = 0;
+
+    QMutex input_mutex;
+    SimulationInput input;
+    QPointF eye_tracker_point;
+    QElapsedTimer eye_tracker_timer; // since the last eye tracker point
+
+    TripleBuffer<RenderSnapshot> snapshots;
+    quint64 steps = 0;
+    qint64 step_nsecs = 0; // time spent in step()
+};
+
+#endif // SIMULATION_THREAD_H
@@ -1,25 +1,23 @@
 #ifndef SPEED_OBSERVER_H
 #define SPEED_OBSERVER_H
 
-#include <QtConcurrent>
-#include "qcarviz.h"
+#include <boost/algorithm/clamp.hpp>
+#include "simulation_core.h"
 #include "logging.h"
+#include "min_speed_profile.h"
 
 // TODO: put these config values into the log!
 #define TOO_FAST_TOLERANCE 0.1 // PERCENT OF CURRENT SPEED
 #define TOO_FAST_TOLERANCE_OFFSET 10 // KMH OFFSET
-#define TOO_SLOW_TOLERANCE 0.1 // percent of current speed
-#define TOO_SLOW_TOLERANCE_OFFSET 10 // kmh offset
-#define COOLDOWN_TIME_SPEEDING 10000 // how long "nothing" happens after a speeding 'flash'
-#define TOOSLOW_OBSERVER_ACCELERATION 0.1 // kmh per "track_path unit"
-#define TOOSLOW_OBSERVER_SLOWING_DOWN 0.05
-#define TOOSLOW_OBSERVER_COOLDOWN 10000 //how long nothing happens after getting "honked"
+#define COOLDOWN_TIME_SPEEDING 10 // [s] how long "nothing" happens after a speeding 'flash'
+#define TOOSLOW_OBSERVER_COOLDOWN 10 // [s] how long nothing happens after getting "honked"
 
 class SignObserverBase
 {
+    friend class SignTriggerQueue;
 protected:
-    SignObserverBase(QCarViz& carViz, const bool execute_when_replaying = false)
-        : track(carViz.track), carViz(carViz), execute_when_replaying(execute_when_replaying)
+    SignObserverBase(SimulationCore& core, const bool execute_when_replaying = false)
+        : track(core.track), core(core), execute_when_replaying(execute_when_replaying)
     { }
 
     void find_next_sign()
@@ -36,17 +34,16 @@ protected:
                 next_sign = nullptr;
                 return;
             }
-            for (auto t : types) {
-                if (next_sign->type == t) {
-                    trigger_distance = get_trigger_distance(next_sign);
-                    return;
-                }
+            if (types & (1u << next_sign->type)) {
+                trigger_distance = get_trigger_distance(next_sign);
+                return;
             }
         }
     }
     virtual void trigger(Track::Sign* /*sign*/, qreal const /*t*/) { } // save infos for 'tick_current_sign'
     virtual qreal get_trigger_distance(Track::Sign* /*next_sign*/) { return 0; }
     virtual void init() = 0; // add type(s)
+    void add_type(const Track::Sign::Type type) { types |= 1u << type; }
     virtual bool tick_current_sign(const qreal /*t*/, const qreal /*dt*/) { return true; } // return true when finished
 
 public:
@@ -55,35 +52,94 @@ public:
         current_sign = nullptr;
         find_next_sign();
     }
-    virtual void tick(const bool replay, const qreal t, const qreal dt) {
-        if (replay && !execute_when_replaying)
-            return;
-        if (current_sign && tick_current_sign(t, dt))
-            current_sign = nullptr;
-        if (!next_sign)
-            return;
-        if (next_sign->at_length - carViz.current_pos < trigger_distance) {
-            //qDebug() << "trigger";
-            current_sign = next_sign;
-            trigger(current_sign, t);
-            find_next_sign();
-        }
-    }
 protected:
+    bool runs(const bool replay) const { return !replay || execute_when_replaying; }
+    // the car passed the trigger position of next_sign
+    bool crossed(const qreal pos) const { return next_sign->at_length - pos < trigger_distance; }
+    qreal trigger_pos() const { return next_sign->at_length - trigger_distance; }
+    void fire(const qreal t) {
+        //qDebug() << "trigger";
+        current_sign = next_sign;
+        trigger(current_sign, t);
+        find_next_sign();
+    }
+
     Track::Sign* next_sign = nullptr;
     Track::Sign* current_sign = nullptr;
-    std::vector<Track::Sign::Type> types;
+    quint32 types = 0; // bit per Track::Sign::Type
     qreal trigger_distance = 0;
     Track& track;
-    QCarViz& carViz;
+    SimulationCore& core;
     bool execute_when_replaying = false;
 };
 
+// SignTriggerQueue runs the sign observers ordered by position: each observer waits in one min-heap keyed by
+// the trigger position of its next sign (at_length - trigger distance). a tick only touches the observers whose
+// trigger was crossed and the ones busy with a sign (tick_current_sign), not every observer for every sign type.
+class SignTriggerQueue
+{
+public:
+    void add(SignObserverBase* observer) { observers.push_back(observer); }
+    // resets the observers (next sign from the start of the track)
+    void reset() {
+        queue.clear();
+        active.clear();
+        for (auto o : observers) {
+            o->reset();
+            schedule(o);
+        }
+    }
+    // the car is at pos: ticks the current signs, then triggers the crossed ones (one sign per observer and tick)
+    void tick(const qreal pos, const bool replay, const qreal t, const qreal dt) {
+        for (size_t i = 0; i < active.size(); ) {
+            SignObserverBase* o = active[i];
+            if (o->runs(replay) && o->tick_current_sign(t, dt)) {
+                o->current_sign = nullptr;
+                active[i] = active.back();
+                active.pop_back();
+            } else
+                i++;
+        }
+        crossed.clear();
+        while (!queue.empty() && queue.front().observer->crossed(pos)) {
+            std::pop_heap(queue.begin(), queue.end());
+            crossed.push_back(queue.back().observer);
+            queue.pop_back();
+        }
+        for (auto o : crossed) {
+            if (o->runs(replay)) {
+                if (!o->current_sign)
+                    active.push_back(o);
+                o->fire(t);
+            }
+            schedule(o); // the next sign (or the same again, if o doesn't run in replays)
+        }
+    }
+
+protected:
+    struct Entry {
+        qreal pos;
+        SignObserverBase* observer;
+        bool operator<(const Entry& e) const { return pos > e.pos; } // heap with the smallest pos at the front
+    };
+    void schedule(SignObserverBase* o) {
+        if (!o->next_sign)
+            return;
+        queue.push_back({ o->trigger_pos(), o });
+        std::push_heap(queue.begin(), queue.end());
+    }
+
+    std::vector<SignObserverBase*> observers;
+    std::vector<Entry> queue;
+    std::vector<SignObserverBase*> active; // with a current_sign
+    std::vector<SignObserverBase*> crossed;
+};
+
 template<class T>
 class SignObserver : public T
 {
 public:
-    SignObserver(QCarViz& car_viz) : T(car_viz)
+    SignObserver(SimulationCore& core) : T(core)
     {
         T::init();
         T::find_next_sign();
@@ -93,19 +149,19 @@ public:
 class StopSignObserver : public SignObserverBase
 {
 protected:
-	StopSignObserver(QCarViz& carViz) : SignObserverBase(carViz) {}
+    StopSignObserver(SimulationCore& core) : SignObserverBase(core) {}
     //using SignObserverBase::SignObserverBase;
-    void init() override { types.push_back(Track::Sign::Stop); }
+    void init() override { add_type(Track::Sign::Stop); }
     qreal get_trigger_distance(Track::Sign*) override {
         return 70;
     }
     bool tick_current_sign(const qreal, const qreal) override {
-        if (carViz.get_car()->speed < 3) { // driving slow enough
+        if (core.get_car()->speed < 3) { // driving slow enough
             qDebug() << "stop sign: slow enough!";
             return true;
         }
-        if (carViz.get_current_pos() - current_sign->at_length > 10) {
-            carViz.log_traffic_violation(TrafficViolation::StopSign);
+        if (core.get_current_pos() - current_sign->at_length > 10) {
+            core.log_traffic_violation(TrafficViolation::StopSign);
             qDebug() << "StopSign: flash!";
             return true;
         }
@@ -116,12 +172,10 @@ protected:
 class SpeedObserver : public SignObserverBase
 {
 protected:
-    SpeedObserver(QCarViz& carViz) : SignObserverBase(carViz) {
-        cooldown_timer.start();
-    }
+    SpeedObserver(SimulationCore& core) : SignObserverBase(core) { }
     void init() override {
         for (auto t = Track::Sign::Speed30; t <= Track::Sign::Speed130; ((int&)t)++)
-            types.push_back(t);
+            add_type(t);
     }
     void trigger(Track::Sign* sign, qreal const) override {
         qDebug() << "speed limit:" << sign->speed_limit();
@@ -133,43 +187,39 @@ protected:
         else
             return -30;
     }
-    bool tick_current_sign(const qreal, const qreal) override {
-        if (carViz.get_kmh() > current_speed_limit && cooldown_timer.elapsed() > COOLDOWN_TIME_SPEEDING) {
+    bool tick_current_sign(const qreal t, const qreal) override {
+        if (core.get_kmh() > current_speed_limit && t - cooldown_start > COOLDOWN_TIME_SPEEDING) {
             qDebug() << "Speed: Flash!";
-            carViz.log_traffic_violation(TrafficViolation::Speeding);
-            cooldown_timer.start();
+            core.log_traffic_violation(TrafficViolation::Speeding);
+            cooldown_start = t;
         }
         return false;
     }
+    void reset() override {
+        SignObserverBase::reset();
+        cooldown_start = -COOLDOWN_TIME_SPEEDING;
+    }
     qreal current_speed_limit = 0;
-    QElapsedTimer cooldown_timer;
+    qreal cooldown_start = -COOLDOWN_TIME_SPEEDING; // [s] simulation time of the last flash
 };
 
 class TrafficLightObserver : public SignObserverBase
 {
 protected:
-    TrafficLightObserver(QCarViz& carViz) : SignObserverBase(carViz, true) { }
-    void init() override { types.push_back(Track::Sign::TrafficLight); }
+    TrafficLightObserver(SimulationCore& core) : SignObserverBase(core, true) { }
+    void init() override { add_type(Track::Sign::TrafficLight); }
     void reset() override {
         SignObserverBase::reset();
 
     }
-    static void trigger_traffic_light(Track::Sign* traffic_light) {
-        std::pair<qreal,qreal>& time_range = traffic_light->traffic_light_info.time_range;
-        std::uniform_int_distribution<int> time(time_range.first,time_range.second);
-        QThread::msleep(time(rng));
-        traffic_light->traffic_light_state = Track::Sign::Yellow;
-        QThread::msleep(1000);
-        traffic_light->traffic_light_state = Track::Sign::Green;
-    }
     bool tick_current_sign(const qreal, const qreal) override {
         if (current_sign->traffic_light_state != Track::Sign::Red_pending) {
             qDebug() << "TrafficLight: okay";
             return true;
         }
-        if (carViz.get_current_pos() - current_sign->at_length > 0) {
+        if (core.get_current_pos() - current_sign->at_length > 0) {
             qDebug() << "TrafficLight: flash!";
-            carViz.log_traffic_violation(TrafficViolation::TrafficLight);
+            core.log_traffic_violation(TrafficViolation::TrafficLight);
             return true;
         }
         return false;
@@ -178,21 +228,27 @@ protected:
         return sign->traffic_light_info.trigger_distance;
     }
     void trigger(Track::Sign * sign, const qreal) override {
-        if (carViz.is_log_run())
-            return;
         Q_ASSERT(sign->traffic_light_state == Track::Sign::Red);
         sign->traffic_light_state = Track::Sign::Red_pending;
-        QtConcurrent::run(trigger_traffic_light, sign);
+        // red for a random time of time_range [ms], then yellow for a second (simulated time).
+        // from the rng of the core: seeded per run (Log::seed), a replay switches at the same times
+        std::pair<qreal,qreal>& time_range = sign->traffic_light_info.time_range;
+        std::uniform_int_distribution<int> time(time_range.first,time_range.second);
+        TimerWheel& timers = core.timers;
+        timers.schedule_in(time(core.rng) / 1000., [sign, &timers]() {
+            sign->traffic_light_state = Track::Sign::Yellow;
+            timers.schedule_in(1, [sign]() { sign->traffic_light_state = Track::Sign::Green; });
+        });
     }
 };
 
 class TurnSignObserver : public SignObserverBase
 {
 protected:
-    TurnSignObserver(QCarViz& car_viz) : SignObserverBase(car_viz, true) { }
+    TurnSignObserver(SimulationCore& core) : SignObserverBase(core, true) { }
     void init() override {
-        types.push_back(Track::Sign::TurnLeft);
-        types.push_back(Track::Sign::TurnRight);
+        add_type(Track::Sign::TurnLeft);
+        add_type(Track::Sign::TurnRight);
     }
     bool tick_current_sign(const qreal t, const qreal dt) override {
         const qreal tt = t - t0;
@@ -210,8 +266,8 @@ protected:
         }
         //qDebug() << "stage " << stage << " steer " << intensity / dt;
         qreal const steering = intensity * (info->left ? -1 : 1);
-        carViz.steer(steering);
-        carViz.set_scripted_steering(steering);
+        core.steer(steering);
+        core.set_scripted_steering(steering);
         return false;
     }
 public:
@@ -232,154 +288,31 @@ protected:
 };
 
 struct TooSlowObserver {
-    TooSlowObserver(QCarViz& car_viz, OSCSender& osc) : car_viz(car_viz), track(car_viz.track), osc_(osc) {
-        cooldown_timer_.start();
-    }
+    TooSlowObserver(SimulationCore& core) : core(core), track(core.track) { }
     void reset() {
-        min_speed_.clear();
-        const qreal track_length = car_viz.get_track_path().length() * track_mult;
-        min_speed_.resize((int) track_length + 5);
-        min_speed_.fill(0);
-        QVector<Track::Sign> signs = track.signs;
-        signs.insert(signs.begin(), Track::Sign(Track::Sign::Speed130, 10));
-
-        // get all speed signs
-        QVector<const Track::Sign*> speed_signs;
-        for (const Track::Sign& s : signs) {
-            if (s.is_speed_sign())
-                speed_signs.push_back(&s);
-        }
-        if (!speed_signs.size())
-            return;
-
-        // set speed based on speed signs
-        for (int i = 0; i < speed_signs.size(); i++) {
-            const Track::Sign* const cur = speed_signs[i];
-            const Track::Sign* const prev = !i ? nullptr : speed_signs[i-1];
-            const Track::Sign* const next = i+1 >= speed_signs.size() ? nullptr : speed_signs[i+1];
-            const int start = (int) ceil(speed_signs[i]->at_length * track_mult);
-            const int end = (int) floor(next ? next->at_length * track_mult : track_length);
-            const qreal limit = honk_limit(cur->speed_limit());
-            const qreal prev_limit = prev ? honk_limit(prev->speed_limit()) : 200;
-            const qreal next_limit = next ? honk_limit(next->speed_limit()) : limit;
-
-            for (int j = start; j <= end; j++)
-                set_min_speed(j, limit);
-
-            if (prev_limit < limit) {
-                qreal tlimit = prev_limit;
-                const qreal inc = TOOSLOW_OBSERVER_ACCELERATION / track_mult;
-                for (int j = start; j <= end; j++) {
-                    tlimit += inc;
-                    set_min_speed(j, tlimit);
-                    if (tlimit > limit)
-                        break;
-                }
-            }
-            if (next_limit < limit) {
-                qreal tlimit = next_limit;
-                const qreal inc = TOOSLOW_OBSERVER_SLOWING_DOWN / track_mult;
-                for (int j = end-1; j >= start; j--) {
-                    tlimit += inc;
-                    set_min_speed(j, tlimit);
-                    if (tlimit > limit)
-                        break;
-                }
-            }
-        }
-        signs.remove(0);
-        for (int j = 50 * track_mult; j >= 0; j--)
-            set_min_speed(j, -1);
-        insert_stop_sign(40, track_length);
-
-        // get all stop signs & traffic lights
-        QVector<const Track::Sign*> stop_signs;
-        for (const Track::Sign& s : signs) {
-            if (s.type == Track::Sign::Stop || s.type == Track::Sign::TrafficLight)
-                stop_signs.push_back(&s);
-        }
-        if (!stop_signs.size())
-            return;
-
-        for (const Track::Sign* const s : stop_signs) {
-            const int pos = (int) s->at_length;
-            insert_stop_sign(pos, track_length);
-        }
-
-        struct speed {
-            speed(QVector<qreal>& min_speed) : min_speed_(min_speed) {}
-            void write(QJsonObject& j) const {
-                QJsonArray jitems;
-                for (auto i : min_speed_) {
-                    jitems.append(i);
-                }
-                j["speed"] = jitems;
-            }
-            const QVector<qreal>& min_speed_;
-        };
-
-        speed s(min_speed_);
-        misc::saveJson("/Users/jhammers/test.json.zip", s, true);
-    }
-    void insert_stop_sign(const int pos, const int track_length) {
-        const int left = boost::algorithm::clamp((pos - 100) * track_mult, 0, track_length);
-        const int right = boost::algorithm::clamp((pos + 25) * track_mult, 0, track_length);
-        for (int j = left+1; j < right; j++)
-            set_min_speed(j, -1);
-        qreal inc = TOOSLOW_OBSERVER_SLOWING_DOWN / track_mult;
-        qreal tlimit = 0;
-        for (int j = left; j >= 0; j--) {
-            tlimit += inc;
-            set_min_speed(j, tlimit);
-        }
-        inc = TOOSLOW_OBSERVER_ACCELERATION / track_mult;
-        tlimit = 0;
-        for (int j = right; j <= track_length; j++) {
-            tlimit += inc;
-            set_min_speed(j, tlimit);
-        }
-    }
-
-    inline void set_min_speed(const int pos, const qreal speed) {
-        Q_ASSERT(pos >= 0 && pos < min_speed_.size());
-        qreal& val = min_speed_[pos];
-        if (!val || speed < val)
-            val = speed;
-    }
-
-    inline qreal min_speed(qreal pos) const {
-        pos *= track_mult;
-        const int p1 = boost::algorithm::clamp((int) floor(pos), 0, min_speed_.size() - 1);
-        const int p2 = boost::algorithm::clamp((int) ceil(pos), 0, min_speed_.size() - 1);
-        //Q_ASSERT(p1 >= 0 && p2 >= 0);
-        const qreal v = pos - floor(pos);
-        return v * min_speed_[p2] + (1-v) * min_speed_[p1];
-    }
-    static inline qreal honk_limit(qreal l) {
-        return l * (1-TOO_SLOW_TOLERANCE) - TOO_SLOW_TOLERANCE_OFFSET;
+        cooldown_start_ = -TOOSLOW_OBSERVER_COOLDOWN;
+        profile.update(track, core.get_track_tiles().length());
     }
 
-    void tick() {
-        const qreal pos = car_viz.get_current_pos();
-        const qreal slow_speed_threshold = min_speed(pos);
-        const qreal current_speed = car_viz.get_kmh();
-        if (current_speed < slow_speed_threshold && cooldown_timer_.elapsed() > TOOSLOW_OBSERVER_COOLDOWN) {
+    void tick(const qreal t) {
+        const qreal pos = core.get_current_pos();
+        const qreal slow_speed_threshold = profile.at(pos);
+        const qreal current_speed = core.get_kmh();
+        if (current_speed < slow_speed_threshold && t - cooldown_start_ > TOOSLOW_OBSERVER_COOLDOWN) {
             qDebug() << "Too Slow!";
-            if (!car_viz.is_replaying()) {
-                car_viz.log()->add_event(LogEvent::TooSlow);
-                car_viz.show_too_slow();
+            if (!core.is_replaying()) {
+                core.log()->add_event(LogEvent::TooSlow);
+                if (core.listener)
+                    core.listener->show_too_slow();
             }
-            cooldown_timer_.start();
+            cooldown_start_ = t;
         }
     }
 
-    const qreal track_mult = 0.5; // check min_speed()! (current_pos * track_mult) is the position in the min_speed_ array
-                                  // the bigger track_mult is, the more precise (and slow) the calculation is
-    QVector<qreal> min_speed_;
-    QCarViz& car_viz;
+    MinSpeedProfile profile;
+    SimulationCore& core;
     Track& track;
-    OSCSender& osc_;
-    QElapsedTimer cooldown_timer_;
+    qreal cooldown_start_ = -TOOSLOW_OBSERVER_COOLDOWN; // [s] simulation time of the last honk
 };
 
 //struct SpeedObserver {
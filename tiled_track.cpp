@@ -0,0 +1,180 @@
+#include "tiled_track.h"
+#include "track.h"
+#include "track_file.h"
+#include <QPaintEngine>
+#include <cstdlib>
+#include <math.h>
+
+void TiledTrack::set_track(const Track& track, const qreal height)
+{
+    clear();
+    if (track.points.size() < 3 * track.num_points + 1 || track.num_points < 1)
+        return;
+    points.resize(3 * track.num_points + 1);
+    for (int i = 0; i < points.size(); i++)
+        points[i] = Track::tf(track.points[i], height);
+
+    if (track.file && track.file->matches(track)) {
+        // laid out for height 0: the same, moved down by height
+        file = track.file;
+        const TrackFile::Info& info = file->info();
+        const qreal* start = file->segment_start();
+        segment_start = QVector<qreal>(track.num_points + 1);
+        std::copy(start, start + segment_start.size(), segment_start.begin());
+        bounds = QRectF(info.bounds[0], info.bounds[1] + height, info.bounds[2], info.bounds[3]);
+        baked.map(file->samples(), file->count(TrackFile::SamplesSection), info.path_length, height);
+        n_tiles = std::max(1, (int) ceil(length() / tile_length));
+        return;
+    }
+    segment_start.reserve(track.num_points + 1);
+    segment_start.push_back(0);
+    for (int k = 0; k < track.num_points; k++) {
+        QPainterPath segment(points[3*k]);
+        add_segment(segment, k);
+        segment_start.push_back(segment_start.last() + segment.length());
+        bounds = k ? bounds.united(segment.boundingRect()) : segment.boundingRect();
+    }
+    n_tiles = std::max(1, (int) ceil(length() / tile_length));
+}
+
+void TiledTrack::clear()
+{
+    points.clear();
+    segment_start.clear();
+    bounds = QRectF();
+    baked.clear();
+    file.reset();
+    n_tiles = 0;
+    center = 0;
+    tiles.clear();
+    last = nullptr;
+    last_index = -1;
+}
+
+int TiledTrack::segment_at(const qreal l) const
+{
+    // segment_start[k] <= l < segment_start[k+1]
+    const int k = (int) (std::upper_bound(segment_start.begin(), segment_start.end(), l) - segment_start.begin()) - 1;
+    return std::max(0, std::min(k, segment_start.size() - 2));
+}
+
+void TiledTrack::update(const qreal pos)
+{
+    if (empty())
+        return;
+    center = tile_index(pos);
+    for (auto it = tiles.begin(); it != tiles.end(); ) {
+        if (it->first < center - tiles_behind || it->first > center + tiles_ahead) {
+            if (it->second.get() == last)
+                last = nullptr, last_index = -1;
+            it = tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (int i = std::max(0, center - tiles_behind); i <= std::min(n_tiles - 1, center + tiles_ahead); i++)
+        tile(i);
+}
+
+const TiledTrack::Tile& TiledTrack::tile(const int index) const
+{
+    Q_ASSERT(!empty());
+    if (index == last_index && last)
+        return *last;
+    auto it = tiles.find(index);
+    if (it == tiles.end()) {
+        // lookups far away from the car (e.g. the sign positions) must not pile up tiles
+        if ((int) tiles.size() >= tiles_behind + tiles_ahead + 3) {
+            auto farthest = tiles.begin();
+            if (std::abs(tiles.rbegin()->first - center) > std::abs(farthest->first - center))
+                farthest = std::prev(tiles.end());
+            if (farthest->second.get() == last)
+                last = nullptr, last_index = -1;
+            tiles.erase(farthest);
+        }
+        std::unique_ptr<Tile> t(new Tile);
+        const qreal from = index * tile_length, to = (index + 1) * tile_length;
+        const int first = segment_at(from), end = segment_at(to) + 1;
+        t->offset = segment_start[first];
+        if (baked.empty()) {
+            QPainterPath path(points[3*first]);
+            for (int k = first; k < end; k++)
+                add_segment(path, k);
+            t->sampler.sample(path);
+        }
+        // the segments starting in the tile (the first one of the track in tile 0)
+        for (int k = first; k < end; k++) {
+            if (segment_start[k] < from && k)
+                continue;
+            if (segment_start[k] >= to && index < n_tiles - 1)
+                break;
+            if (t->path.isEmpty())
+                t->path.moveTo(points[3*k]);
+            add_segment(t->path, k);
+        }
+        it = tiles.emplace(index, std::move(t)).first;
+    }
+    last = it->second.get();
+    last_index = index;
+    return *last;
+}
+
+void TiledTrack::draw(QPainter& painter, const qreal from, const qreal to) const
+{
+    if (empty())
+        return;
+    // a segment is drawn by the tile it starts in
+    if (painter.pen() != raster_pen) {
+        clear_raster();
+        raster_pen = painter.pen();
+    }
+    for (int i = tile_index(segment_start[segment_at(from)]); i <= tile_index(to); i++)
+        draw_tile(painter, tile(i));
+}
+
+void TiledTrack::draw_tile(QPainter& painter, const Tile& t) const
+{
+    if (t.path.isEmpty())
+        return;
+    const QPaintEngine* engine = painter.paintEngine();
+    const QTransform& tf = painter.transform();
+    if (!painter.device() || (engine && (engine->type() == QPaintEngine::SVG || engine->type() == QPaintEngine::Pdf))
+            || tf.type() > QTransform::TxScale) {
+        painter.drawPath(t.path);
+        return;
+    }
+    const qreal scale = painter.device()->devicePixelRatioF() * std::max(fabs(tf.m11()), fabs(tf.m22()));
+    if (t.raster_scale != scale) {
+        const qreal margin = painter.pen().widthF() + 2;
+        t.raster_rect = t.path.controlPointRect().adjusted(-margin, -margin, margin, margin);
+        const QSize size = (t.raster_rect.size() * scale).toSize() + QSize(1, 1);
+        t.raster_scale = scale;
+        if (size.width() > 4096 || size.height() > 4096) {
+            t.raster = QImage(); // too large (a long segment), stroked every frame
+        } else {
+            t.raster = QImage(size, QImage::Format_ARGB32_Premultiplied);
+            t.raster.fill(Qt::transparent);
+            QPainter p(&t.raster);
+            p.setRenderHints(painter.renderHints());
+            p.scale(scale, scale);
+            p.translate(-t.raster_rect.topLeft());
+            p.setPen(painter.pen());
+            p.setBrush(Qt::NoBrush);
+            p.drawPath(t.path);
+            p.end();
+            t.raster.setDevicePixelRatio(scale); // the size of raster_rect in the coordinates of painter
+        }
+    }
+    if (t.raster.isNull())
+        painter.drawPath(t.path);
+    else
+        painter.drawImage(t.raster_rect.topLeft(), t.raster);
+}
+
+void TiledTrack::clear_raster() const
+{
+    for (auto& t : tiles) {
+        t.second->raster = QImage();
+        t.second->raster_scale = 0;
+    }
+}
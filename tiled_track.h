@@ -0,0 +1,107 @@
+#ifndef TILED_TRACK_H
+#define TILED_TRACK_H
+
+#include <QPainterPath>
+#include <QPainter>
+#include <QImage>
+#include <QVector>
+#include <map>
+#include <memory>
+#include "track_sampler.h"
+
+struct Track;
+class TrackFile;
+
+// TiledTrack is the track path split into tiles of tile_length (path length). only the control points and the
+// length of every bezier segment are kept for the whole route, the path and the arc-length table (TrackSampler)
+// of a tile are built when it is needed and dropped again when the car is far enough away (update()).
+// the memory and the cost per frame stay the same for routes of any length.
+// the lookups have the interface of TrackSampler. not thread safe (the lookups build tiles).
+// a track loaded from a v2 TrackFile brings the segment lengths and the samples of the whole path: they are used
+// in place, the tiles only hold the paths to draw.
+// draw() blits the tiles from images stroked once (per pen, scale and device pixel ratio): a frame costs the same
+// for any route and any curviness. they go with their tile (update(), set_track() on a track change or resize).
+// (QImage, not QPixmap: the tiles are also built in the simulation thread and in headless tools)
+class TiledTrack
+{
+public:
+    TiledTrack(const qreal tile_length = 1024, const int tiles_behind = 1, const int tiles_ahead = 3)
+        : tile_length(tile_length), tiles_behind(tiles_behind), tiles_ahead(tiles_ahead) {}
+
+    // lays out the path of track for the height (as Track::get_path), drops all tiles
+    void set_track(const Track& track, const qreal height);
+    void clear();
+
+    bool empty() const { return points.size() < 4; }
+    qreal length() const { return segment_start.isEmpty() ? 0 : segment_start.last(); }
+    QRectF bounding_rect() const { return bounds; }
+    const QVector<qreal>& get_segment_start() const { return segment_start; }
+
+    // keeps the tiles from tiles_behind before to tiles_ahead after the tile at pos, drops the others
+    void update(const qreal pos);
+
+    // at length l, clamped to the path (see TrackSampler)
+    QPointF point_at(qreal const l) const {
+        if (!baked.empty())
+            return baked.point_at(l);
+        const Tile& t = tile_at(l);
+        return t.sampler.point_at(l - t.offset);
+    }
+    qreal slope_at(qreal const l) const {
+        if (!baked.empty())
+            return baked.slope_at(l);
+        const Tile& t = tile_at(l);
+        return t.sampler.slope_at(l - t.offset);
+    }
+    qreal angle_at(qreal const l) const {
+        if (!baked.empty())
+            return baked.angle_at(l);
+        const Tile& t = tile_at(l);
+        return t.sampler.angle_at(l - t.offset);
+    }
+
+    // draws the path from length from to length to (whole tiles) with the pen of painter
+    void draw(QPainter& painter, const qreal from, const qreal to) const;
+    // drops the images of the tiles (e.g. on a screen with another device pixel ratio)
+    void clear_raster() const;
+
+    int tiles_materialized() const { return (int) tiles.size(); }
+
+protected:
+    struct Tile {
+        qreal offset; // path length at the start of sampler
+        TrackSampler sampler; // of the segments with a part in the tile (empty if baked)
+        QPainterPath path; // the segments starting in the tile (for drawing)
+        mutable QImage raster; // path stroked (see draw_tile())
+        mutable QRectF raster_rect; // area of raster in path coordinates
+        mutable qreal raster_scale = 0; // device pixels per path unit of raster
+    };
+    int tile_index(const qreal l) const {
+        return std::max(0, std::min(n_tiles - 1, (int) (l / tile_length)));
+    }
+    const Tile& tile_at(const qreal l) const { return tile(tile_index(l)); }
+    const Tile& tile(const int index) const;
+    // first segment with a part at length l
+    int segment_at(const qreal l) const;
+    void add_segment(QPainterPath& path, const int k) const {
+        path.cubicTo(points[3*k+1], points[3*k+2], points[3*k+3]);
+    }
+    // from the image of the tile, stroked when there is none for the pen and scale of painter yet
+    void draw_tile(QPainter& painter, const Tile& t) const;
+
+    qreal tile_length;
+    int tiles_behind, tiles_ahead;
+    QVector<QPointF> points; // of the path, 3 per segment + 1
+    QVector<qreal> segment_start; // path length at the start of every segment (+ the total length)
+    QRectF bounds;
+    TrackSampler baked; // of the whole path, mapped from file
+    std::shared_ptr<const TrackFile> file;
+    int n_tiles = 0;
+    int center = 0; // tile of the last update()
+    mutable std::map<int, std::unique_ptr<Tile>> tiles;
+    mutable const Tile* last = nullptr; // of the last lookup
+    mutable int last_index = -1;
+    mutable QPen raster_pen; // the images of the tiles are stroked with
+};
+
+#endif // TILED_TRACK_H
@@ -0,0 +1,111 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <QtGlobal>
+#include <array>
+#include <functional>
+#include <vector>
+#include <math.h>
+
+// TimerWheel runs callbacks at points of the simulated time (the traffic light phases, ..), on the thread that
+// advances it. hierarchical: LEVELS wheels of SLOTS slots, a timer sits in the level of the highest tick digit
+// in which it differs from now and moves down whenever the lower digits of now wrap around (cascade).
+// scheduling is O(1), advancing skips the stretches without timers.
+class TimerWheel
+{
+public:
+    typedef std::function<void()> Callback;
+
+    // resolution: [s] per tick
+    explicit TimerWheel(const qreal resolution = 0.001) : resolution(resolution) {}
+
+    // removes all timers, the time stays
+    void clear() {
+        for (auto& level : wheels)
+            for (auto& slot : level)
+                slot.clear();
+        counts.fill(0);
+    }
+    // callback runs in the advance() that reaches t [s] (in the next one if t is not in the future)
+    void schedule(const qreal t, Callback callback) {
+        place({ std::max((quint64) ceil(t / resolution), now), std::move(callback) });
+    }
+    void schedule_in(const qreal dt, Callback callback) { schedule(time() + dt, std::move(callback)); }
+
+    // runs the callbacks due until t [s], in the order of their time
+    void advance(const qreal t) {
+        const quint64 target = (quint64) std::max(0., floor(t / resolution));
+        fire();
+        while (now < target) {
+            // jump to the next tick where something can happen: the lowest level with timers cascades
+            int level = 0;
+            while (level < LEVELS && !counts[level])
+                level++;
+            if (level == LEVELS) {
+                now = target;
+                break;
+            }
+            const quint64 next = (now | ((quint64(1) << (BITS * level)) - 1)) + 1;
+            now = std::min(next, target);
+            cascade();
+            fire();
+        }
+    }
+
+    qreal time() const { return now * resolution; }
+    int size() const {
+        int n = 0;
+        for (int c : counts)
+            n += c;
+        return n;
+    }
+
+protected:
+    static constexpr int BITS = 8;
+    static constexpr int SLOTS = 1 << BITS;
+    static constexpr int LEVELS = 4; // 2^32 ticks ahead, later timers circle in the top level
+    struct Timer {
+        quint64 due; // [ticks]
+        Callback callback;
+    };
+
+    void place(Timer&& timer) {
+        const quint64 diff = timer.due ^ now;
+        int level = 0;
+        while (level < LEVELS - 1 && (diff >> (BITS * (level + 1))))
+            level++;
+        wheels[level][(timer.due >> (BITS * level)) & (SLOTS - 1)].push_back(std::move(timer));
+        counts[level]++;
+    }
+    // moves the timers of the levels whose lower digits just wrapped around to the lower levels
+    void cascade() {
+        int top = 0;
+        while (top + 1 < LEVELS && !(now & ((quint64(1) << (BITS * (top + 1))) - 1)))
+            top++;
+        for (int level = top; level > 0; level--) {
+            std::vector<Timer> slot;
+            slot.swap(wheels[level][(now >> (BITS * level)) & (SLOTS - 1)]);
+            counts[level] -= (int) slot.size();
+            for (Timer& timer : slot)
+                place(std::move(timer));
+        }
+    }
+    // runs the timers of now (including the ones their callbacks schedule for now)
+    void fire() {
+        std::vector<Timer>& slot = wheels[0][now & (SLOTS - 1)];
+        while (!slot.empty()) {
+            std::vector<Timer> due;
+            due.swap(slot);
+            counts[0] -= (int) due.size();
+            for (Timer& timer : due)
+                timer.callback();
+        }
+    }
+
+    qreal resolution;
+    quint64 now = 0; // [ticks]
+    std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> wheels;
+    std::array<int, LEVELS> counts = {};
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,14 @@
+# Converts tracks between the formats: .bin (QDataStream), .json (Track::saveJSON) and .trk (v2 TrackFile, mapped)
+# build: qmake convert_track.pro && make
+# usage: ./convert_track input.bin output.trk (the formats by the file extensions, .trk is recognized by its header)
+
+QT       += core gui svg
+
+TARGET = convert_track
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../simulation_core.pri)
+
+SOURCES += main.cpp
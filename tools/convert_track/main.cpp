@@ -0,0 +1,72 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <stdio.h>
+#include "track.h"
+
+static bool load_track(const QString& filename, Track& track)
+{
+    if (filename.endsWith(".json"))
+        return track.loadJSON(filename);
+    return track.load(filename); // .bin or .trk
+}
+
+static bool save_track(const QString& filename, const Track& track)
+{
+    if (filename.endsWith(".json"))
+        return track.saveJSON(filename);
+    return track.save(filename); // .trk: v2, QDataStream otherwise
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts a track between .bin, .json and the memory-mappable .trk (v2) with the "
+                                     "baked path samples and min speed profile.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "track file (.bin, .json or .trk)");
+    parser.addPositionalArgument("output", "track file (.bin, .json or .trk)");
+    QCommandLineOption check_option("check", "load the output again and compare it with the input");
+    parser.addOption(check_option);
+    parser.process(app);
+    if (parser.positionalArguments().size() != 2)
+        parser.showHelp(1);
+    const QString input = parser.positionalArguments()[0];
+    const QString output = parser.positionalArguments()[1];
+
+    Track track;
+    QElapsedTimer timer;
+    timer.start();
+    if (!load_track(input, track)) {
+        fprintf(stderr, "can't load %s\n", input.toLocal8Bit().constData());
+        return 1;
+    }
+    const qreal load_ms = timer.nsecsElapsed() * 1e-6;
+    if (!save_track(output, track)) {
+        fprintf(stderr, "can't write %s\n", output.toLocal8Bit().constData());
+        return 1;
+    }
+    printf("%d segments, %d signs, loaded in %.2f ms\n", track.num_points, track.signs.size(), load_ms);
+
+    if (parser.isSet(check_option)) {
+        Track converted;
+        timer.restart();
+        if (!load_track(output, converted)) {
+            fprintf(stderr, "can't load %s\n", output.toLocal8Bit().constData());
+            return 1;
+        }
+        printf("%s loaded in %.2f ms\n", output.toLocal8Bit().constData(), timer.nsecsElapsed() * 1e-6);
+        track.prepare_track();
+        bool same = converted.points == track.points && converted.num_points == track.num_points
+                && converted.signs.size() == track.signs.size();
+        for (int i = 0; same && i < track.signs.size(); i++)
+            same = converted.signs[i].type == track.signs[i].type && converted.signs[i].at_length == track.signs[i].at_length;
+        if (!same) {
+            fprintf(stderr, "%s differs from %s\n", output.toLocal8Bit().constData(), input.toLocal8Bit().constData());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,14 @@
+# Drives many synthetic runs of a track headless (DriverModel), for load tests and automated studies
+# build: qmake driver_runs.pro && make
+# usage: ./driver_runs [--runs N] [--threads N] [--seed S] [--save dir] [--bsfc map.csv] [track.bin]
+
+QT       += core gui svg
+
+TARGET = driver_runs
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../simulation_core.pri)
+
+SOURCES += main.cpp
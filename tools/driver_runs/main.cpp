@@ -0,0 +1,123 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDir>
+#include <stdio.h>
+#include <memory>
+#include "driver_model.h"
+#include "logging.h"
+#include "work_stealing_pool.h"
+
+static bool verbose = false;
+
+// the observers are chatty, only warnings are shown by default
+static void message_handler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if (type == QtDebugMsg && !verbose)
+        return;
+    fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+}
+
+struct RunResult {
+    bool finished = false;
+    qreal elapsed_time = 0; // [s]
+    qreal liters = 0;
+    int violations[LogEvent::TooSlow + 1] = {};
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    qInstallMessageHandler(message_handler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Drives synthetic runs of a track with DriverModel agents, concurrently and headless.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("track", "track file (default: tracks/track.bin)");
+    QCommandLineOption runs_option("runs", "number of runs", "n", "100");
+    QCommandLineOption threads_option("threads", "number of worker threads (default: all cores)", "n", "0");
+    QCommandLineOption seed_option("seed", "seed of the first run (run i uses seed + i, for the driver and the traffic lights)", "seed", "1");
+    QCommandLineOption fps_option("fps", "frames per second of the simulated input", "fps", "60");
+    QCommandLineOption height_option("height", "window height the track path is laid out for", "px", "800");
+    QCommandLineOption save_option("save", "save the log of every run into this directory", "dir");
+    QCommandLineOption bsfc_option("bsfc", "measured BSFC map of the engine (csv, see ConsumptionMap::load_bsfc_csv)", "file");
+    QCommandLineOption verbose_option("verbose", "show the debug output of the runs");
+    parser.addOption(runs_option);
+    parser.addOption(threads_option);
+    parser.addOption(seed_option);
+    parser.addOption(fps_option);
+    parser.addOption(height_option);
+    parser.addOption(save_option);
+    parser.addOption(bsfc_option);
+    parser.addOption(verbose_option);
+    parser.process(app);
+    verbose = parser.isSet(verbose_option);
+
+    const QString track_file = parser.positionalArguments().isEmpty() ? "tracks/track.bin" : parser.positionalArguments()[0];
+    const int n_runs = parser.value(runs_option).toInt();
+    const unsigned seed = parser.value(seed_option).toUInt();
+    const qreal frame_dt = 1. / std::max(1., parser.value(fps_option).toDouble());
+    const qreal height = parser.value(height_option).toDouble();
+    const QString save_dir = parser.value(save_option);
+    if (!save_dir.isEmpty() && !QDir().mkpath(save_dir)) {
+        fprintf(stderr, "can't create %s\n", save_dir.toLocal8Bit().constData());
+        return 1;
+    }
+
+    WorkStealingPool pool(parser.value(threads_option).toInt());
+    std::vector<std::unique_ptr<SimulationCore>> cores;
+    for (int i = 0; i < pool.size(); i++) {
+        cores.emplace_back(new SimulationCore());
+        if (!cores.back()->track.load(track_file)) {
+            fprintf(stderr, "can't load %s\n", track_file.toLocal8Bit().constData());
+            return 1;
+        }
+        cores.back()->prepare_track(height);
+        if (parser.isSet(bsfc_option) && !cores.back()->car.engine.load_bsfc_csv(parser.value(bsfc_option))) {
+            fprintf(stderr, "can't load %s\n", parser.value(bsfc_option).toLocal8Bit().constData());
+            return 1;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<RunResult> results(n_runs);
+    pool.parallel_for(0, n_runs, [&](const int i) {
+        SimulationCore& core = *cores[WorkStealingPool::current_worker()];
+        DriverModel driver(DriverStyle(), seed + i);
+        core.set_seed(seed + i); // the traffic lights too
+        RunResult& r = results[i];
+        r.finished = core.drive_run(driver, frame_dt);
+        if (!core.car.log)
+            return;
+        core.car.log->window_size = QSize(0, (int) height); // only the height matters for the track path
+        const Log& log = *core.car.log;
+        r.elapsed_time = log.elapsed_time;
+        r.liters = log.liters_used;
+        for (const LogEvent& e : log.events)
+            r.violations[e.type]++;
+        if (!save_dir.isEmpty())
+            log.save(QDir(save_dir).filePath(QString("run_%1.log").arg(i, 5, 10, QChar('0'))));
+    }, 1);
+    const qreal seconds = timer.nsecsElapsed() * 1e-9;
+
+    int finished = 0;
+    qreal elapsed_time = 0, liters = 0;
+    int violations[LogEvent::TooSlow + 1] = {};
+    for (const RunResult& r : results) {
+        if (!r.finished)
+            continue;
+        finished++;
+        elapsed_time += r.elapsed_time;
+        liters += r.liters;
+        for (int v = 0; v <= LogEvent::TooSlow; v++)
+            violations[v] += r.violations[v];
+    }
+    printf("%d of %d runs finished, %d threads\n", finished, n_runs, pool.size());
+    if (finished)
+        printf("mean: %.1f s, %.4f L\n", elapsed_time / finished, liters / finished);
+    printf("violations: speeding %d, stop sign %d, traffic light %d, too slow %d\n",
+           violations[LogEvent::Speeding], violations[LogEvent::StopSign], violations[LogEvent::TrafficLight], violations[LogEvent::TooSlow]);
+    printf("%.1f s: %.0f runs/hour, %.0fx real time\n", seconds, n_runs / seconds * 3600, elapsed_time / seconds);
+    return finished == n_runs ? 0 : 1;
+}
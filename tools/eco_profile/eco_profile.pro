@@ -0,0 +1,17 @@
+# Computes the eco-optimal speed profile of a track (dynamic programming over position, speed and gear)
+# build: qmake eco_profile.pro && make
+# usage: ./eco_profile [--ds 5] [--dv 1] [--max-time s] [--log file.log] [-o profile.json.zip] [track.bin]
+
+QT       += core gui svg
+
+TARGET = eco_profile
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../simulation_core.pri)
+
+SOURCES += main.cpp \
+    eco_profile_solver.cpp
+
+HEADERS += eco_profile_solver.h
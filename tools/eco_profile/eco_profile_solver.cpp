@@ -0,0 +1,252 @@
+#include "eco_profile_solver.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <limits>
+
+EcoProfileSolver::EcoProfileSolver(const Car& car, const Track& track, const EcoProfileSettings& settings, const int threads)
+    : settings(settings)
+    , engine(car.engine)
+    , gears(car.gearbox.gears)
+    , mass_factors(car.gearbox.mass_factors)
+    , end_transmission(car.gearbox.end_transmission)
+    , rolling_circumference(car.gearbox.rolling_circumference)
+    , wheel_radius(car.gearbox.wheel_radius)
+    , mass(car.mass)
+    , max_breaking_force(car.max_breaking_force)
+    , drag_resistance_coefficient(car.drag_resistance_coefficient)
+    , rolling_resistance_coefficient(car.rolling_resistance_coefficient)
+    , max_time(track.max_time)
+    , pool(threads)
+{
+    const qreal units = SimulationCore::PATH_UNITS_PER_METER;
+    dv = Gearbox::kmh2speed(settings.dv);
+    n_speeds = (int) (settings.max_kmh / settings.dv) + 1;
+    n_gears = gears.size();
+    start_pos = SimulationCore::initial_pos;
+
+    QPainterPath path;
+    track.get_path(path, 0); // the height only moves the path
+    TrackSampler sampler;
+    sampler.sample(path);
+    const qreal length = (sampler.length() - start_pos) / units; // [m]
+    n_stages = std::max(1, (int) ceil(length / settings.ds));
+    for (int k = 0; k < n_stages; k++)
+        alpha.append(SimulationCore::alpha_at(sampler, start_pos + (k + 0.5) * settings.ds * units));
+
+    // speed limit per stage boundary
+    max_speed.fill(n_speeds - 1, n_stages + 1);
+    QVector<Track::Sign> signs = track.signs;
+    std::sort(signs.begin(), signs.end());
+    for (const Track::Sign& s : signs) { // a speed sign is valid until the next one
+        if (!s.is_speed_sign())
+            continue;
+        const int limit = speed_index(Gearbox::kmh2speed(s.speed_limit()));
+        for (int i = stage_at(s.at_length); i <= n_stages; i++)
+            max_speed[i] = limit;
+    }
+    for (const Track::Sign& s : signs) {
+        const int k = stage_at(s.at_length);
+        if (s.type == Track::Sign::Stop) {
+            max_speed[k] = std::min(max_speed[k], speed_index(settings.stop_speed));
+        } else if (s.type == Track::Sign::TrafficLight) {
+            // the light turns yellow time_range.first [ms] after it was triggered:
+            // slower than trigger_distance / that time from the trigger on never arrives at red
+            const qreal t_yellow = s.traffic_light_info.time_range.first / 1000; // [s]
+            if (t_yellow > 0) {
+                const int limit = speed_index(s.traffic_light_info.trigger_distance / units / t_yellow);
+                for (int i = stage_at(s.at_length - s.traffic_light_info.trigger_distance); i <= k; i++)
+                    max_speed[i] = std::min(max_speed[i], limit);
+            }
+        }
+    }
+
+    // bounds of the acceleration, only used to skip hopeless transitions (with some margin for hills)
+    qreal max_force = 0;
+    qreal max_mass_factor = 1;
+    for (int g = 0; g < n_gears; g++) {
+        max_force = std::max(max_force, engine.max_torque * gears[g] * end_transmission / wheel_radius / mass_factors[g]);
+        max_mass_factor = std::max(max_mass_factor, mass_factors[g]);
+    }
+    a_max = max_force / mass + 0.5 * GRAVITY;
+    a_min = -(max_breaking_force + max_force) * max_mass_factor / mass - 0.5 * GRAVITY;
+}
+
+bool EcoProfileSolver::segment(const int k, const int vi, const int vj, const int g, qreal& liters, qreal& time) const
+{
+    const qreal v0 = vi * dv;
+    const qreal v1 = vj * dv;
+    if (v0 + v1 <= 0)
+        return false;
+    const qreal ds = settings.ds;
+    time = 2 * ds / (v0 + v1); // constant acceleration
+    const qreal a = (v1 * v1 - v0 * v0) / (2 * ds);
+    const qreal v = 0.5 * (v0 + v1);
+
+    const qreal ratio = gears[g] * end_transmission;
+    qreal rpm = v * 100 / rolling_circumference * ratio * 60; // Gearbox::speed2engine_rpm
+    if (rpm > engine.max_rpm)
+        return false;
+    if (rpm < settings.min_rpm) {
+        if (g > 0)
+            return false;
+        rpm = settings.min_rpm; // slipping clutch
+    }
+
+    // force the wheels have to deliver (inverse of Car::force2acceleration)
+    const qreal mass_factor = mass_factors[g];
+    const qreal F_net = a > 0 ? a * mass * mass_factor : a * mass / mass_factor;
+    const qreal F = F_net + resistances::drag(drag_resistance_coefficient, v)
+                          + resistances::rolling(rolling_resistance_coefficient, alpha[k], mass)
+                          + resistances::uphill(mass, alpha[k]);
+    qreal torque = F * wheel_radius / ratio + engine.braking_torque(rpm);
+    if (torque > engine.max_torque * engine.torque_map.get_torque(1, rpm / engine.max_rpm))
+        return false;
+    if (torque < 0) { // fuel cut, the brakes do the rest
+        if (-torque * ratio / wheel_radius > max_breaking_force)
+            return false;
+        torque = 0;
+    }
+    liters = engine.get_consumption(Engine::rpm2angular_velocity(rpm), torque) / 1000 / 0.75 / (60*60) * time; // [g/h] => [L]
+    return true;
+}
+
+bool EcoProfileSolver::solve(const qreal lambda)
+{
+    const qreal inf = std::numeric_limits<qreal>::infinity();
+    const int n_states = n_speeds * n_gears; // state: speed index * n_gears + gear (of the last segment)
+    QVector<qreal> cost(n_states, inf);
+    QVector<qreal> next(n_states, inf);
+    QVector<qreal> best_adjacent(n_states); // best cost of the states a gear may be changed from
+    QVector<int> best_adjacent_state(n_states);
+    QVector<int> pred(n_stages * n_states, -1);
+    cost[0] = 0; // standing, first gear
+    const qreal ds2 = 2 * settings.ds;
+
+    for (int k = 0; k < n_stages; k++) {
+        // at most one gear up or down per stage
+        for (int vi = 0; vi < n_speeds; vi++)
+            for (int g = 0; g < n_gears; g++) {
+                qreal best = inf;
+                int best_state = -1;
+                for (int h = std::max(0, g - 1); h <= std::min(n_gears - 1, g + 1); h++)
+                    if (cost[vi * n_gears + h] < best) {
+                        best = cost[vi * n_gears + h];
+                        best_state = vi * n_gears + h;
+                    }
+                best_adjacent[vi * n_gears + g] = best;
+                best_adjacent_state[vi * n_gears + g] = best_state;
+            }
+
+        int* const pred_k = pred.data() + k * n_states;
+        const int max_vj = max_speed[k + 1];
+        pool.parallel_for(0, n_speeds, [&](const int vj) {
+            const qreal v1 = vj * dv;
+            const int vi_begin = std::max(0, (int) ceil(sqrt(std::max(0., v1 * v1 - ds2 * a_max)) / dv));
+            const int vi_end = std::min(n_speeds - 1, (int) floor(sqrt(std::max(0., v1 * v1 - ds2 * a_min)) / dv));
+            for (int g = 0; g < n_gears; g++) {
+                qreal best = inf;
+                int best_state = -1;
+                if (vj <= max_vj) {
+                    for (int vi = vi_begin; vi <= vi_end; vi++) {
+                        const qreal c0 = best_adjacent[vi * n_gears + g];
+                        if (c0 == inf)
+                            continue;
+                        qreal liters, time;
+                        if (!segment(k, vi, vj, g, liters, time))
+                            continue;
+                        const qreal c = c0 + liters + lambda * time;
+                        if (c < best) {
+                            best = c;
+                            best_state = best_adjacent_state[vi * n_gears + g];
+                        }
+                    }
+                }
+                next[vj * n_gears + g] = best;
+                pred_k[vj * n_gears + g] = best_state;
+            }
+        });
+        cost.swap(next);
+    }
+
+    const int end = std::min_element(cost.begin(), cost.end()) - cost.begin();
+    if (cost[end] == inf)
+        return false;
+
+    // backtrack, then accumulate time & consumption from the start
+    QVector<int> states(n_stages + 1);
+    states[n_stages] = end;
+    for (int k = n_stages; k > 0; k--)
+        states[k-1] = pred[(k-1) * n_states + states[k]];
+    Q_ASSERT(states[0] == 0);
+    profile.clear();
+    qreal time = 0, liters = 0;
+    for (int k = 0; k <= n_stages; k++) {
+        const int v = states[k] / n_gears;
+        const int g = states[k] % n_gears;
+        if (k > 0) {
+            qreal l, t;
+            const bool ok = segment(k - 1, states[k-1] / n_gears, v, g, l, t);
+            Q_ASSERT(ok);
+            Q_UNUSED(ok);
+            liters += l;
+            time += t;
+        }
+        const qreal distance = k * settings.ds;
+        profile.append({ start_pos + distance * SimulationCore::PATH_UNITS_PER_METER, distance,
+                         Gearbox::speed2kmh(v * dv), g, time, liters });
+    }
+    return true;
+}
+
+bool EcoProfileSolver::solve()
+{
+    lambda = 0;
+    if (!solve(lambda))
+        return false;
+    if (max_time <= 0 || time() <= max_time)
+        return true;
+
+    // find a lambda that is fast enough, then bisect
+    qreal lo = 0, hi = 1e-4; // [L/s]
+    for (int i = 0; ; i++) {
+        if (!solve(hi))
+            return false;
+        if (time() <= max_time)
+            break;
+        if (i >= 20) {
+            qWarning() << "EcoProfileSolver: max_time" << max_time << "s not reachable, fastest:" << time() << "s";
+            return false;
+        }
+        lo = hi;
+        hi *= 4;
+    }
+    QVector<EcoProfilePoint> best = profile;
+    for (int i = 0; i < settings.lambda_iterations; i++) {
+        const qreal mid = 0.5 * (lo + hi);
+        if (solve(mid) && time() <= max_time) {
+            hi = mid;
+            best = profile;
+        } else
+            lo = mid;
+    }
+    profile = best;
+    lambda = hi;
+    return true;
+}
+
+void EcoProfileSolver::write(QJsonObject& j) const
+{
+    j["liters"] = liters();
+    j["time"] = time();
+    j["max_time"] = max_time;
+    j["lambda"] = lambda;
+    j["ds"] = settings.ds;
+    j["dv"] = settings.dv;
+    QJsonArray jprofile;
+    for (const EcoProfilePoint& p : profile) {
+        QJsonObject jp;
+        p.write(jp);
+        jprofile.append(jp);
+    }
+    j["profile"] = jprofile;
+}
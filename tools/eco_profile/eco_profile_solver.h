@@ -0,0 +1,98 @@
+#ifndef ECO_PROFILE_SOLVER_H
+#define ECO_PROFILE_SOLVER_H
+
+#include <QVector>
+#include <QJsonObject>
+#include "car.h"
+#include "track.h"
+#include "simulation_core.h"
+#include "work_stealing_pool.h"
+
+struct EcoProfileSettings {
+    qreal ds = 5; // [m] stage length
+    qreal dv = 1; // [km/h] speed resolution
+    qreal max_kmh = 130; // top of the speed grid (and the limit before the first speed sign)
+    qreal stop_speed = 3; // [m/s] at stop signs (as StopSignObserver)
+    qreal min_rpm = 1000; // the clutch slips below (only allowed in the first gear)
+    int lambda_iterations = 16; // bisection steps for max_time
+};
+
+struct EcoProfilePoint {
+    qreal pos; // on the track_path
+    qreal distance; // [m] from the start
+    qreal kmh;
+    int gear; // of the segment ending here
+    qreal time; // [s] since the start
+    qreal liters; // since the start
+    void write(QJsonObject& j) const {
+        j["pos"] = pos;
+        j["distance"] = distance;
+        j["speed"] = kmh;
+        j["gear"] = gear;
+        j["time"] = time;
+        j["liters"] = liters;
+    }
+};
+
+// EcoProfileSolver finds the speed & gear profile with the lowest consumption for a track, using dynamic programming
+// over (position, speed, gear) with the Engine (baked maps), gearbox and resistances of a car.
+// constraints: speed signs, stop signs, traffic lights (never arrive before they can turn yellow) and track.max_time.
+// the time limit is handled by a lagrange multiplier (cost = liters + lambda * seconds), found by bisection.
+// the stages are solved one after another, the states of every stage in parallel.
+class EcoProfileSolver
+{
+public:
+    EcoProfileSolver(const Car& car, const Track& track, const EcoProfileSettings& settings = EcoProfileSettings(), const int threads = 0);
+
+    // returns false if no profile fulfills the constraints
+    bool solve();
+
+    const QVector<EcoProfilePoint>& get_profile() const { return profile; }
+    qreal liters() const { return profile.size() ? profile.last().liters : 0; }
+    qreal time() const { return profile.size() ? profile.last().time : 0; }
+    qreal get_lambda() const { return lambda; }
+
+    void write(QJsonObject& j) const;
+    bool save_json(const QString filename) const { return misc::saveJson(filename, *this, true); }
+
+protected:
+    // one dynamic programming pass, fills profile. returns false if the end can't be reached
+    bool solve(const qreal lambda);
+    // fuel [L] and time [s] for the segment after stage k from speed index vi to vj in gear g. false if impossible
+    bool segment(const int k, const int vi, const int vj, const int g, qreal& liters, qreal& time) const;
+    // speed index (rounded down)
+    int speed_index(const qreal speed) const { return std::max(0, std::min(n_speeds - 1, (int) (speed / dv))); }
+    // nearest stage boundary of a track_path position
+    int stage_at(const qreal pos) const {
+        return std::max(0, std::min(n_stages, (int) round((pos - start_pos) / SimulationCore::PATH_UNITS_PER_METER / settings.ds)));
+    }
+
+    EcoProfileSettings settings;
+    qreal dv; // [m/s]
+    int n_speeds;
+    int n_gears;
+    int n_stages; // segments, there are n_stages + 1 stage boundaries
+    qreal start_pos;
+    QVector<qreal> alpha; // [rad] per segment
+    QVector<int> max_speed; // speed index per stage boundary
+
+    // car configuration
+    Engine engine;
+    QVector<qreal> gears;
+    QVector<qreal> mass_factors;
+    qreal end_transmission;
+    qreal rolling_circumference; // cm
+    qreal wheel_radius; // m
+    qreal mass;
+    qreal max_breaking_force;
+    qreal drag_resistance_coefficient;
+    qreal rolling_resistance_coefficient;
+    qreal max_time; // [s], 0: no limit
+    qreal a_min, a_max; // [m/s^2] bounds for pruning the transitions
+
+    WorkStealingPool pool;
+    QVector<EcoProfilePoint> profile;
+    qreal lambda = 0; // [L/s]
+};
+
+#endif // ECO_PROFILE_SOLVER_H
@@ -0,0 +1,69 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <stdio.h>
+#include "eco_profile_solver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Computes the speed & gear profile with the lowest consumption for a track "
+                                     "that respects its signs, traffic lights and time limit.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("track", "track file (default: tracks/track.bin)");
+    QCommandLineOption log_option("log", "take the track and the car configuration from a recorded .log file", "file");
+    QCommandLineOption ds_option("ds", "stage length [m]", "m", "5");
+    QCommandLineOption dv_option("dv", "speed resolution [km/h]", "kmh", "1");
+    QCommandLineOption max_time_option("max-time", "time limit [s] (default: the one of the track, 0: none)", "s");
+    QCommandLineOption threads_option("threads", "number of worker threads (default: all cores)", "n", "0");
+    QCommandLineOption output_option(QStringList() << "o" << "output", "write the profile as json", "file", "eco_profile.json.zip");
+    parser.addOption(log_option);
+    parser.addOption(ds_option);
+    parser.addOption(dv_option);
+    parser.addOption(max_time_option);
+    parser.addOption(threads_option);
+    parser.addOption(output_option);
+    parser.process(app);
+
+    SimulationCore core;
+    if (parser.isSet(log_option)) {
+        QFile f(parser.value(log_option));
+        if (!f.open(QIODevice::ReadOnly) || !core.load_log_data(f.readAll(), 0)) {
+            fprintf(stderr, "can't load %s\n", parser.value(log_option).toLocal8Bit().constData());
+            return 1;
+        }
+    } else {
+        const QString track_file = parser.positionalArguments().isEmpty() ? "tracks/track.bin" : parser.positionalArguments()[0];
+        if (!core.track.load(track_file)) {
+            fprintf(stderr, "can't load %s\n", track_file.toLocal8Bit().constData());
+            return 1;
+        }
+    }
+    if (parser.isSet(max_time_option))
+        core.track.max_time = parser.value(max_time_option).toInt();
+
+    EcoProfileSettings settings;
+    settings.ds = parser.value(ds_option).toDouble();
+    settings.dv = parser.value(dv_option).toDouble();
+    if (settings.ds <= 0 || settings.dv <= 0)
+        parser.showHelp(1);
+
+    QElapsedTimer timer;
+    timer.start();
+    EcoProfileSolver solver(core.car, core.track, settings, parser.value(threads_option).toInt());
+    if (!solver.solve()) {
+        fprintf(stderr, "no feasible profile\n");
+        return 1;
+    }
+    printf("%.4f L in %.1f s (limit %d s, lambda %g L/s), %d points, solved in %.2f s\n",
+           solver.liters(), solver.time(), core.track.max_time, solver.get_lambda(),
+           solver.get_profile().size(), timer.nsecsElapsed() * 1e-9);
+    if (!solver.save_json(parser.value(output_option))) {
+        fprintf(stderr, "can't write %s\n", parser.value(output_option).toLocal8Bit().constData());
+        return 1;
+    }
+    return 0;
+}
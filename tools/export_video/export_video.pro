@@ -0,0 +1,19 @@
+# Renders replays of logs offscreen into videos (numbered PNGs or a raw Y4M stream), frames in parallel
+# build: qmake export_video.pro && make
+# usage: ./export_video [--size WxH] [--fps N] [--format png|y4m] [--threads N] [--seed S] [-o dir] run.log ...
+
+QT       += core gui svg
+
+TARGET = export_video
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../simulation_core.pri)
+
+SOURCES += main.cpp \
+    ../../scene_renderer.cpp \
+    ../../hud.cpp
+
+HEADERS += ../../scene_renderer.h \
+    ../../hud.h
@@ -0,0 +1,217 @@
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <stdio.h>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include "scene_renderer.h"
+#include "work_stealing_pool.h"
+
+static bool verbose = false;
+
+// the replays are chatty, only warnings are shown by default
+static void message_handler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if (type == QtDebugMsg && !verbose)
+        return;
+    fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+}
+
+// the snapshots of a replay of file, one per frame of frame_dt (a step longer than a frame gives repeated frames)
+static bool record_frames(const QString& file, const qreal height, const qreal frame_dt,
+                          SimulationCore& core, std::vector<RenderSnapshot>& frames)
+{
+    if (!core.load_log(file, height))
+        return false;
+    core.reset();
+    quint64 steps = 0;
+    frames.clear();
+    frames.emplace_back();
+    frames.back().capture(core, steps);
+    qreal next_frame = core.time + frame_dt;
+    qreal dt;
+    while (core.read_replay_item(dt)) {
+        core.tick(dt);
+        steps++;
+        for ( ; core.time >= next_frame; next_frame += frame_dt) {
+            frames.emplace_back();
+            frames.back().capture(core, steps);
+        }
+    }
+    return true;
+}
+
+// 4:2:0 planes of img (full range BT.601, as C420jpeg), img has an even size
+static void to_yuv420(const QImage& img, QByteArray& out)
+{
+    const int w = img.width(), h = img.height();
+    out.resize(w * h * 3 / 2);
+    uchar* y_plane = (uchar*) out.data();
+    uchar* u_plane = y_plane + w * h;
+    uchar* v_plane = u_plane + w * h / 4;
+    // fixed point, 16 bits
+    for (int y = 0; y < h; y += 2) {
+        const QRgb* rows[2] = { (const QRgb*) img.constScanLine(y), (const QRgb*) img.constScanLine(y + 1) };
+        for (int x = 0; x < w; x += 2) {
+            int r_sum = 0, g_sum = 0, b_sum = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    const QRgb c = rows[dy][x + dx];
+                    const int r = qRed(c), g = qGreen(c), b = qBlue(c);
+                    y_plane[(y + dy) * w + x + dx] = (uchar) ((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+                    r_sum += r; g_sum += g; b_sum += b;
+                }
+            }
+            // the sums are 4 pixels: >> 18 is the mean
+            const int i = (y / 2) * (w / 2) + x / 2;
+            u_plane[i] = (uchar) qBound(0, (-11059 * r_sum - 21709 * g_sum + 32768 * b_sum + (128 << 18) + (1 << 17)) >> 18, 255);
+            v_plane[i] = (uchar) qBound(0, (32768 * r_sum - 27439 * g_sum - 5329 * b_sum + (128 << 18) + (1 << 17)) >> 18, 255);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen"); // no display needed (and the pixmaps work in the worker threads)
+    QGuiApplication app(argc, argv);
+    qInstallMessageHandler(message_handler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders replays of logs offscreen into numbered PNGs or Y4M videos, the frames in parallel.\n"
+                                     "Run it in the directory with media/ (as the car simulator).");
+    parser.addHelpOption();
+    parser.addPositionalArgument("logs", "log files", "run.log ...");
+    QCommandLineOption size_option("size", "frame size (even)", "WxH", "1280x720");
+    QCommandLineOption fps_option("fps", "frames per second", "fps", "30");
+    QCommandLineOption format_option("format", "png (numbered frames in a directory per log) or y4m (a video per log)", "format", "png");
+    QCommandLineOption threads_option("threads", "number of worker threads (default: all cores)", "n", "0");
+    QCommandLineOption seed_option("seed", "seed of the trees", "seed", "1");
+    QCommandLineOption output_option(QStringList() << "o" << "output", "output directory", "dir", ".");
+    QCommandLineOption verbose_option("verbose", "show the debug output of the replays");
+    parser.addOption(size_option);
+    parser.addOption(fps_option);
+    parser.addOption(format_option);
+    parser.addOption(threads_option);
+    parser.addOption(seed_option);
+    parser.addOption(output_option);
+    parser.addOption(verbose_option);
+    parser.process(app);
+    verbose = parser.isSet(verbose_option);
+
+    const QStringList logs = parser.positionalArguments();
+    if (logs.isEmpty())
+        parser.showHelp(1);
+    const QStringList size_str = parser.value(size_option).split('x');
+    const QSize size = size_str.size() == 2 ? QSize(size_str[0].toInt(), size_str[1].toInt()) : QSize();
+    if (size.width() <= 0 || size.height() <= 0 || size.width() % 2 || size.height() % 2) {
+        fprintf(stderr, "wrong size %s (WxH, even)\n", parser.value(size_option).toLocal8Bit().constData());
+        return 1;
+    }
+    const int fps = std::max(1, parser.value(fps_option).toInt());
+    const qreal frame_dt = 1. / fps;
+    const QString format = parser.value(format_option);
+    if (format != "png" && format != "y4m") {
+        fprintf(stderr, "unknown format %s\n", format.toLocal8Bit().constData());
+        return 1;
+    }
+    const bool y4m = format == "y4m";
+    const quint64 seed = parser.value(seed_option).toULongLong();
+    const QDir out_dir(parser.value(output_option));
+    if (!QDir().mkpath(out_dir.path())) {
+        fprintf(stderr, "can't create %s\n", out_dir.path().toLocal8Bit().constData());
+        return 1;
+    }
+
+    Track::images.load_sign_images();
+    WorkStealingPool pool(parser.value(threads_option).toInt());
+    // a renderer per worker (the caches of the drawing aren't shared), the same seed: the same trees
+    std::vector<std::unique_ptr<SceneRenderer>> renderers;
+    for (int i = 0; i < pool.size(); i++)
+        renderers.emplace_back(new SceneRenderer(seed));
+
+    int failed = 0;
+    quint64 total_frames = 0;
+    qreal total_time = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString& file : logs) {
+        const QString name = QFileInfo(file).completeBaseName();
+        SimulationCore core;
+        std::vector<RenderSnapshot> frames;
+        if (!record_frames(file, size.height(), frame_dt, core, frames)) {
+            fprintf(stderr, "can't load %s\n", file.toLocal8Bit().constData());
+            failed++;
+            continue;
+        }
+        for (std::unique_ptr<SceneRenderer>& r : renderers) {
+            r->set_track(core.track, size.height());
+            r->fill_trees();
+        }
+        const int n_frames = (int) frames.size();
+
+        // frame i of the replay into img
+        auto render = [&](const int i, QImage& img) {
+            SceneRenderer& renderer = *renderers[WorkStealingPool::current_worker()];
+            img = QImage(size, QImage::Format_RGB32);
+            img.fill(Qt::white);
+            QPainter painter(&img);
+            renderer.draw(painter, frames[i], size);
+        };
+
+        bool ok = true;
+        if (!y4m) {
+            const QDir dir(out_dir.filePath(name));
+            if (!QDir().mkpath(dir.path())) {
+                fprintf(stderr, "can't create %s\n", dir.path().toLocal8Bit().constData());
+                return 1;
+            }
+            std::vector<char> saved(n_frames, true);
+            pool.parallel_for(0, n_frames, [&](const int i) {
+                QImage img;
+                render(i, img);
+                saved[i] = img.save(dir.filePath(QString("frame_%1.png").arg(i, 6, 10, QChar('0'))));
+            });
+            ok = std::find(saved.begin(), saved.end(), false) == saved.end();
+        } else {
+            QFile video(out_dir.filePath(name + ".y4m"));
+            if (!video.open(QIODevice::WriteOnly)) {
+                fprintf(stderr, "can't write %s\n", video.fileName().toLocal8Bit().constData());
+                return 1;
+            }
+            video.write(QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n")
+                        .arg(size.width()).arg(size.height()).arg(fps).toLatin1());
+            // in batches: the frames are written in order, the memory stays bounded
+            const int batch = 4 * pool.size();
+            std::vector<QByteArray> planes(batch);
+            for (int first = 0; first < n_frames && ok; first += batch) {
+                const int last = std::min(first + batch, n_frames);
+                pool.parallel_for(first, last, [&](const int i) {
+                    QImage img;
+                    render(i, img);
+                    to_yuv420(img, planes[i - first]);
+                }, 1);
+                for (int i = first; i < last && ok; i++)
+                    ok = video.write("FRAME\n") > 0 && video.write(planes[i - first]) == planes[i - first].size();
+            }
+        }
+        if (!ok) {
+            fprintf(stderr, "can't write the frames of %s\n", file.toLocal8Bit().constData());
+            failed++;
+            continue;
+        }
+        total_frames += n_frames;
+        total_time += n_frames * frame_dt;
+        printf("%s: %d frames\n", name.toLocal8Bit().constData(), n_frames);
+        fflush(stdout);
+    }
+    const qreal seconds = timer.nsecsElapsed() * 1e-9;
+    printf("%d of %d logs, %llu frames %dx%d, %d threads\n", logs.size() - failed, logs.size(),
+           (unsigned long long) total_frames, size.width(), size.height(), pool.size());
+    printf("%.1f s: %.1f frames/s, %.1fx real time\n", seconds, total_frames / seconds, total_time / seconds);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+#include "gear_optimizer.h"
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+#include <limits>
+#include <algorithm>
+#include "simulation_core.h"
+#include "logging.h"
+
+QString GearConfig::to_string() const
+{
+    QString s;
+    QTextStream out(&s);
+    out << "gears {";
+    for (int i = 0; i < gears.size(); i++)
+        out << (i ? ", " : "") << QString::number(gears[i], 'f', 3);
+    out << "} end_transmission " << QString::number(end_transmission, 'f', 3);
+    return s;
+}
+
+GearOptimizer::GearOptimizer(const int threads)
+    : pool(threads)
+    , cores(pool.size())
+    , simulated_seconds_(pool.size(), 0)
+{
+}
+
+GearOptimizer::~GearOptimizer()
+{
+    pool.wait();
+}
+
+int GearOptimizer::load_logs(const QString& directory)
+{
+    const QStringList files = QDir(directory).entryList(QStringList() << "*.log", QDir::Files, QDir::Name);
+    SimulationCore core;
+    for (const QString& file : files) {
+        Trace trace;
+        trace.filename = QDir(directory).filePath(file);
+        QFile f(trace.filename);
+        if (!f.open(QIODevice::ReadOnly)) {
+            qWarning() << "can't open" << trace.filename;
+            continue;
+        }
+        trace.data = f.readAll();
+        if (!core.load_log_data(trace.data, 0)) {
+            qWarning() << "skipping" << trace.filename << "(wrong version)";
+            continue;
+        }
+        const Log& log = *core.log();
+        trace.height = log.has_window_size ? log.window_size.height() : 0;
+        trace.gears = core.car.gearbox.gears.size();
+        if (traces.isEmpty())
+            baseline_ = { core.car.gearbox.gears, core.car.gearbox.end_transmission };
+        else if (trace.gears != baseline_.gears.size()) {
+            qWarning() << "skipping" << trace.filename << "(" << trace.gears << "gears)";
+            continue;
+        }
+        traces.append(trace);
+    }
+    for (std::vector<std::unique_ptr<SimulationCore>>& worker_cores : cores)
+        worker_cores.resize(traces.size());
+    return traces.size();
+}
+
+qreal GearOptimizer::replay(const int trace, const GearConfig& config)
+{
+    const int w = WorkStealingPool::current_worker();
+    Q_ASSERT(w >= 0);
+    std::unique_ptr<SimulationCore>& loaded = cores[w][trace];
+    if (!loaded) {
+        loaded.reset(new SimulationCore());
+        if (!loaded->load_log_data(traces[trace].data, traces[trace].height)) {
+            loaded.reset();
+            return std::numeric_limits<qreal>::infinity();
+        }
+    } else
+        loaded->restart_replay();
+    SimulationCore& core = *loaded;
+    core.car.gearbox.gears = config.gears;
+    core.car.gearbox.end_transmission = config.end_transmission;
+    const qreal t0 = core.time;
+    core.log_run(false);
+    simulated_seconds_[w] += core.time - t0;
+    evaluations_++;
+    // the recorded inputs may not bring another gearbox to the end of the track (or further):
+    // scale to the full length so that the candidates are comparable
+    const qreal track_length = core.track_tiles.length() - core.initial_pos;
+    const qreal distance = core.current_pos - core.initial_pos;
+    if (distance <= 0)
+        return std::numeric_limits<qreal>::infinity();
+    return core.consumption_monitor.liters_used * track_length / distance;
+}
+
+QVector<qreal> GearOptimizer::evaluate(const QVector<GearConfig>& configs)
+{
+    const int n = traces.size();
+    if (n == 0) // nothing to compare with
+        return QVector<qreal>(configs.size(), std::numeric_limits<qreal>::infinity());
+    QVector<qreal> liters(configs.size() * n, 0); // [config][trace]
+    for (int c = 0; c < configs.size(); c++) {
+        if (!configs[c].valid() || configs[c].gears.size() != baseline_.gears.size()) {
+            liters[c * n] = std::numeric_limits<qreal>::infinity();
+            continue;
+        }
+        for (int t = 0; t < n; t++) {
+            qreal* const result = &liters[c * n + t];
+            const GearConfig* const config = &configs[c];
+            pool.submit([this, result, config, t] { *result = replay(t, *config); });
+        }
+    }
+    pool.wait();
+    QVector<qreal> total(configs.size(), 0);
+    for (int c = 0; c < configs.size(); c++)
+        for (int t = 0; t < n; t++)
+            total[c] += liters[c * n + t];
+    return total;
+}
+
+static GearConfig geometric_gears(const int n, const qreal first, const qreal last, const qreal end_transmission)
+{
+    GearConfig config;
+    config.end_transmission = end_transmission;
+    for (int i = 0; i < n; i++)
+        config.gears.append(first * pow(last / first, qreal(i) / (n - 1)));
+    return config;
+}
+
+GearEvaluation GearOptimizer::grid_search(const GearConfig& center, const int n, const qreal range)
+{
+    Q_ASSERT(n >= 2 && center.gears.size() >= 2);
+    QVector<GearConfig> configs;
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < n; j++) {
+            const qreal first = center.gears.first() * (1 - range + 2 * range * i / (n - 1));
+            const qreal last = center.gears.last() * (1 - range + 2 * range * j / (n - 1));
+            configs.append(geometric_gears(center.gears.size(), first, last, center.end_transmission));
+        }
+    const QVector<qreal> liters = evaluate(configs);
+    const int best = std::min_element(liters.begin(), liters.end()) - liters.begin();
+    return { configs[best], liters[best] };
+}
+
+GearEvaluation GearOptimizer::local_search(const GearEvaluation& start, qreal step, const qreal min_step)
+{
+    GearEvaluation best = start;
+    const int dim = best.config.gears.size() + 1; // gears + end transmission
+    while (step >= min_step) {
+        // all neighbours of one iteration are evaluated in parallel
+        QVector<GearConfig> configs;
+        for (int d = 0; d < dim; d++)
+            for (const qreal f : { 1 + step, 1 - step }) {
+                GearConfig c = best.config;
+                if (d < c.gears.size())
+                    c.gears[d] *= f;
+                else
+                    c.end_transmission *= f;
+                configs.append(c);
+            }
+        const QVector<qreal> liters = evaluate(configs);
+        const int i = std::min_element(liters.begin(), liters.end()) - liters.begin();
+        if (liters[i] < best.liters)
+            best = { configs[i], liters[i] };
+        else
+            step /= 2;
+    }
+    return best;
+}
+
+qreal GearOptimizer::simulated_seconds() const
+{
+    qreal sum = 0;
+    for (const qreal s : simulated_seconds_)
+        sum += s;
+    return sum;
+}
@@ -0,0 +1,84 @@
+#ifndef GEAR_OPTIMIZER_H
+#define GEAR_OPTIMIZER_H
+
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include "work_stealing_pool.h"
+
+class SimulationCore;
+
+struct GearConfig {
+    QVector<qreal> gears; // gear-transmissions, must be decreasing
+    qreal end_transmission;
+
+    bool valid() const {
+        for (int i = 1; i < gears.size(); i++)
+            if (gears[i] >= gears[i-1])
+                return false;
+        return gears.size() && gears.last() > 0 && end_transmission > 0;
+    }
+    QString to_string() const;
+};
+
+struct GearEvaluation {
+    GearConfig config;
+    qreal liters; // total over all logs, scaled to the full track length
+};
+
+// GearOptimizer replays the recorded inputs (throttle, braking, gear) of a set of logs with candidate
+// gearboxes and searches the ratios with the lowest total consumption.
+// every (candidate, log) pair is a full headless replay and one task in a work-stealing pool.
+// every worker thread parses every log once, into its own SimulationCore per log, and then only swaps the
+// ratios and restarts the replay for each candidate.
+class GearOptimizer
+{
+public:
+    GearOptimizer(const int threads = 0);
+    ~GearOptimizer();
+
+    // loads all *.log files in directory, returns the number of usable logs
+    int load_logs(const QString& directory);
+    int logs() const { return traces.size(); }
+    int threads() const { return pool.size(); }
+
+    // the gearbox of the first log
+    GearConfig baseline() const { return baseline_; }
+
+    // total liters (all logs) for every config, invalid configs get +inf
+    QVector<qreal> evaluate(const QVector<GearConfig>& configs);
+    GearEvaluation evaluate(const GearConfig& config) { return { config, evaluate(QVector<GearConfig>{ config })[0] }; }
+
+    // n x n grid over the first and the last gear (+-range around center), the gears between are spaced geometrically
+    GearEvaluation grid_search(const GearConfig& center, const int n, const qreal range = 0.3);
+    // pattern search over all ratios and the end transmission (relative steps, halved when stuck)
+    GearEvaluation local_search(const GearEvaluation& start, qreal step = 0.1, const qreal min_step = 0.005);
+
+    // statistics
+    int evaluations() const { return evaluations_; }
+    qreal simulated_seconds() const;
+    int steals() const { return pool.steals; }
+
+protected:
+    struct Trace {
+        QString filename;
+        QByteArray data; // content of the log file
+        qreal height; // of the track path (only moves it)
+        int gears; // number of gears of the recorded car
+    };
+
+    // one replay of traces[trace] on the calling worker, returns liters scaled to the full track length
+    qreal replay(const int trace, const GearConfig& config);
+
+    QVector<Trace> traces;
+    GearConfig baseline_;
+    WorkStealingPool pool;
+    std::vector<std::vector<std::unique_ptr<SimulationCore>>> cores; // [worker][trace], loaded on first use
+    std::atomic<int> evaluations_ { 0 };
+    std::vector<qreal> simulated_seconds_; // per worker
+};
+
+#endif // GEAR_OPTIMIZER_H
@@ -0,0 +1,17 @@
+# Searches the gear ratios with the lowest consumption for a directory of recorded .log files
+# build: qmake gear_optimizer.pro && make
+# usage: ./gear_optimizer [--threads N] [--grid N] <log directory>
+
+QT       += core gui svg
+
+TARGET = gear_optimizer
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../simulation_core.pri)
+
+SOURCES += main.cpp \
+    gear_optimizer.cpp
+
+HEADERS += gear_optimizer.h
@@ -0,0 +1,68 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <stdio.h>
+#include "gear_optimizer.h"
+
+static bool verbose = false;
+
+// the replays are chatty (observers, log loading), only warnings are shown by default
+static void message_handler(QtMsgType type, const QMessageLogContext&, const QString& msg)
+{
+    if (type == QtDebugMsg && !verbose)
+        return;
+    fprintf(stderr, "%s\n", msg.toLocal8Bit().constData());
+}
+
+static void print(const char* name, const GearEvaluation& e, const qreal baseline)
+{
+    printf("%-10s %.4f L (%+.2f %%)  %s\n", name, e.liters, (e.liters / baseline - 1) * 100,
+           e.config.to_string().toLocal8Bit().constData());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    qInstallMessageHandler(message_handler);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays the recorded inputs of all logs in a directory with candidate gearboxes "
+                                     "and searches the gear ratios with the lowest total consumption.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("directory", "directory with .log files");
+    QCommandLineOption threads_option("threads", "number of worker threads (default: all cores)", "n", "0");
+    QCommandLineOption grid_option("grid", "grid points per axis (first & last gear)", "n", "7");
+    QCommandLineOption step_option("step", "initial relative step of the local search", "step", "0.1");
+    QCommandLineOption verbose_option("verbose", "show the debug output of the replays");
+    parser.addOption(threads_option);
+    parser.addOption(grid_option);
+    parser.addOption(step_option);
+    parser.addOption(verbose_option);
+    parser.process(app);
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+    verbose = parser.isSet(verbose_option);
+
+    GearOptimizer optimizer(parser.value(threads_option).toInt());
+    if (!optimizer.load_logs(parser.positionalArguments()[0])) {
+        fprintf(stderr, "no usable logs in %s\n", parser.positionalArguments()[0].toLocal8Bit().constData());
+        return 1;
+    }
+    printf("%d logs, %d threads\n", optimizer.logs(), optimizer.threads());
+
+    QElapsedTimer timer;
+    timer.start();
+    const GearEvaluation baseline = optimizer.evaluate(optimizer.baseline());
+    print("baseline", baseline, baseline.liters);
+    const GearEvaluation grid = optimizer.grid_search(baseline.config, std::max(2, parser.value(grid_option).toInt()));
+    print("grid", grid, baseline.liters);
+    const GearEvaluation best = optimizer.local_search(grid.liters < baseline.liters ? grid : baseline, parser.value(step_option).toDouble());
+    print("local", best, baseline.liters);
+
+    const qreal seconds = timer.nsecsElapsed() * 1e-9;
+    printf("%d replays in %.1f s: %.1f replays/s, %.0fx real time (%.0fx per thread), %d steals\n",
+           optimizer.evaluations(), seconds, optimizer.evaluations() / seconds,
+           optimizer.simulated_seconds() / seconds, optimizer.simulated_seconds() / seconds / optimizer.threads(),
+           optimizer.steals());
+    return 0;
+}
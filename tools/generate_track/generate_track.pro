@@ -0,0 +1,14 @@
+# Generates a random track of any length (elevation, speed limits, stop signs, traffic lights, turn signs)
+# build: qmake generate_track.pro && make
+# usage: ./generate_track [--length km] [--seed S] [--max-time-kmh kmh] [-o tracks/generated.bin or .trk]
+
+QT       += core gui svg
+
+TARGET = generate_track
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+include(../../simulation_core.pri)
+
+SOURCES += main.cpp
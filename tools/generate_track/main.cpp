@@ -0,0 +1,64 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <stdio.h>
+#include "track_generator.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generates a random track (the same seed gives the same track), for load tests and benchmarks.");
+    parser.addHelpOption();
+    QCommandLineOption length_option("length", "length of the track [km]", "km", "10");
+    QCommandLineOption seed_option("seed", "random seed", "seed", "1");
+    QCommandLineOption segment_option("segment", "length of the bezier segments [m]", "m", "100");
+    QCommandLineOption stop_option("stop-signs", "mean distance between stop signs [m] (0: none)", "m", "3000");
+    QCommandLineOption lights_option("traffic-lights", "mean distance between traffic lights [m] (0: none)", "m", "2000");
+    QCommandLineOption turns_option("turn-signs", "mean distance between turn signs [m] (0: none)", "m", "1000");
+    QCommandLineOption max_time_option("max-time-kmh", "time limit of the track at this average speed (0: none)", "kmh", "0");
+    QCommandLineOption output_option(QStringList() << "o" << "output", "track file (.trk: v2 with the baked data)", "file", "tracks/generated.bin");
+    parser.addOption(length_option);
+    parser.addOption(seed_option);
+    parser.addOption(segment_option);
+    parser.addOption(stop_option);
+    parser.addOption(lights_option);
+    parser.addOption(turns_option);
+    parser.addOption(max_time_option);
+    parser.addOption(output_option);
+    parser.process(app);
+
+    TrackGeneratorSettings settings;
+    settings.length = parser.value(length_option).toDouble() * 1000;
+    settings.segment_length = parser.value(segment_option).toDouble();
+    settings.stop_sign_distance = parser.value(stop_option).toDouble();
+    settings.traffic_light_distance = parser.value(lights_option).toDouble();
+    settings.turn_sign_distance = parser.value(turns_option).toDouble();
+    settings.max_time_kmh = parser.value(max_time_option).toDouble();
+    if (settings.length <= 0 || settings.segment_length <= 0)
+        parser.showHelp(1);
+
+    QElapsedTimer timer;
+    timer.start();
+    Track track;
+    TrackGenerator(settings, parser.value(seed_option).toUInt()).generate(track);
+    const qreal seconds = timer.nsecsElapsed() * 1e-9;
+
+    int counts[Track::Sign::__length] = {};
+    for (const Track::Sign& s : track.signs)
+        counts[s.type]++;
+    int speed_signs = 0;
+    for (int t = Track::Sign::Speed30; t <= Track::Sign::Speed130; t++)
+        speed_signs += counts[t];
+    printf("%d segments, %d signs (%d speed, %d stop, %d traffic lights, %d turn), max time %d s, generated in %.1f ms\n",
+           track.num_points, track.signs.size(), speed_signs, counts[Track::Sign::Stop], counts[Track::Sign::TrafficLight],
+           counts[Track::Sign::TurnLeft] + counts[Track::Sign::TurnRight], track.max_time, seconds * 1000);
+
+    const QString output = parser.value(output_option);
+    if (!track.save(output)) {
+        fprintf(stderr, "can't write %s\n", output.toLocal8Bit().constData());
+        return 1;
+    }
+    return 0;
+}
@@ -1,18 +1,28 @@
 #ifndef TORQUE_MAP_H
 #define TORQUE_MAP_H
 
+#include <QList>
+#include <QVector>
+#include <QPointF>
+#include <QDataStream>
+#include "grid2d.h"
+
 #define ARR_SIZE(x) (sizeof(x)/sizeof(x[0]))
 static qreal throttle10[][2] = { {0.0, 0.2}, {0.2,0.8}, {0.5,1}, {0.8,0.8}, {1.0,0} };
 static qreal throttle5[][2] = { {0.0, 0.2}, {0.2,0.65}, {0.5,0.55}, {0.7,0.4}, {1.0,0} };
 
 // TorqueMap translates rpm and throttle into torque
 // both rpm and throttle are relative! (range: 0..1)
+// the ramps are baked into a uniform throttle x rpm grid, get_torque() is a bilinear lookup in that grid.
+// the grid is exact where the knots of the ramps lie on grid lines (true for the default ramps),
+// otherwise the error is bounded by (slope change at the knot) * (cell width) / 4
 struct TorqueMap {
     TorqueMap() {
         // load default ramps
         torque_ramps.append(TorqueRamp(.5, throttle5, ARR_SIZE(throttle5)));
         torque_ramps.append(TorqueRamp(1, throttle10, ARR_SIZE(throttle10)));
         //TorqueRamp tr(throttle5, )
+        bake();
     }
     // maps (relative) rpm to (relative) torque for a given throttle
     struct TorqueRamp {
@@ -26,7 +36,7 @@ struct TorqueMap {
 
         // simple linear interpolation
         // this could be replaced e.g. by something "spliny" ..
-        qreal get_torque(qreal rpm) {
+        qreal get_torque(qreal rpm) const {
             //Q_ASSERT(rpm >= 0 && rpm <= 1);
             if (rpm <= rpm2torque[0].x())
                 return rpm2torque[0].y();
@@ -49,7 +59,17 @@ struct TorqueMap {
     };
 
     // throttle (0..1), rpm (0..1)
-    inline qreal get_torque(qreal const throttle, qreal const rpm) {
+    // bilinear lookup in the baked grid
+    inline qreal get_torque(qreal const throttle, qreal const rpm) const {
+        Q_ASSERT(throttle >= 0); // && rpm <= 1);
+        return grid.get(rpm, throttle);
+    }
+    // the baked grid (x=rpm, y=throttle)
+    const Grid2D& get_grid() const { return grid; }
+
+    // throttle (0..1), rpm (0..1)
+    // piecewise linear interpolation of the ramps (used for baking the grid)
+    qreal get_torque_ramps(qreal const throttle, qreal const rpm) const {
         Q_ASSERT(throttle >= 0); // && rpm <= 1);
         if (throttle <= torque_ramps[0].throttle)
             return linear_interp(throttle, 0, torque_ramps[0].throttle, 0, torque_ramps[0].get_torque(rpm));
@@ -64,7 +84,26 @@ struct TorqueMap {
         return 0;
     }
 
-    static qreal linear_interp(qreal x, QPointF& p0, QPointF& p1) {
+    const QList<TorqueRamp>& get_torque_ramps() const { return torque_ramps; }
+    // TorqueMaps: must be sorted (by throttle-value)!
+    void set_torque_ramps(const QList<TorqueRamp>& torque_ramps) {
+        Q_ASSERT(!torque_ramps.isEmpty());
+        this->torque_ramps = torque_ramps;
+        bake();
+    }
+
+    // number of grid points along throttle and rpm (>= 2 each)
+    // the defaults put all knots of the default ramps on grid lines (steps 0.025 and 0.01)
+    void set_resolution(int const n_throttle, int const n_rpm) {
+        Q_ASSERT(n_throttle >= 2 && n_rpm >= 2);
+        grid_n_throttle = n_throttle;
+        grid_n_rpm = n_rpm;
+        bake();
+    }
+    int resolution_throttle() const { return grid_n_throttle; }
+    int resolution_rpm() const { return grid_n_rpm; }
+
+    static qreal linear_interp(qreal x, const QPointF& p0, const QPointF& p1) {
         return linear_interp(x, p0.x(), p1.x(), p0.y(), p1.y());
     }
     static qreal linear_interp(qreal x, qreal x0, qreal x1, qreal y0, qreal y1) {
@@ -81,9 +120,28 @@ struct TorqueMap {
 //            return y0 * (1-mu2) + y1 * mu2;
 //        }
 
+protected:
+    // samples the ramps into the grid
+    // rpm range: 0..1, extended to the knots of all ramps (the ramps are constant outside their knots)
+    // throttle range: 0..throttle of the last ramp (constant above)
+    void bake() {
+        qreal rpm_min = 0;
+        qreal rpm_max = 1;
+        for (const TorqueRamp& tr : torque_ramps) {
+            Q_ASSERT(!tr.rpm2torque.isEmpty());
+            rpm_min = std::min(rpm_min, tr.rpm2torque.first().x());
+            rpm_max = std::max(rpm_max, tr.rpm2torque.last().x());
+        }
+        grid.resize(grid_n_rpm, grid_n_throttle, rpm_min, rpm_max, 0, torque_ramps.last().throttle);
+        grid.bake([this](qreal rpm, qreal throttle) { return get_torque_ramps(throttle, rpm); });
+    }
+
     // TorqueMaps: must be sorted (by throttle-value)!
     QList<TorqueRamp> torque_ramps;
 
+    Grid2D grid; // x=rpm, y=throttle
+    int grid_n_throttle = 41;
+    int grid_n_rpm = 101;
 };
 
 inline QDataStream &operator<<(QDataStream &out, const TorqueMap::TorqueRamp &tr)
@@ -98,4 +156,20 @@ inline QDataStream &operator>>(QDataStream &in, TorqueMap::TorqueRamp &tr)
     return in;
 }
 
+// only the ramps are stored, the grid is rebaked on load
+inline QDataStream &operator<<(QDataStream &out, const TorqueMap &tm)
+{
+    out << tm.get_torque_ramps();
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, TorqueMap &tm)
+{
+    QList<TorqueMap::TorqueRamp> torque_ramps;
+    in >> torque_ramps;
+    if (!torque_ramps.isEmpty())
+        tm.set_torque_ramps(torque_ramps);
+    return in;
+}
+
 #endif // TORQUE_MAP_H
@@ -4,10 +4,17 @@
 #include <QPainterPath>
 #include <QDir>
 #include <QImage>
+#include <QPixmap>
+#include <QHash>
 #include <QPainter>
 #include <QSvgRenderer>
+#include <QJsonArray>
+#include <memory>
 #include <hud.h>
 #include "misc.h"
+#include "track_sampler.h"
+#include "track_file.h"
+#include "sign_raster_cache.h"
 
 struct TreeType {
     struct SpeedyImage {
@@ -23,15 +30,33 @@ struct TreeType {
         img.load(path);
     }
     void draw_scaled(QPainter& painter, const QPointF pos, qreal kmh, qreal scale = 1) const {
+        const QPixmap& sprite = this->sprite(kmh, scale, painter.device() ? painter.device()->devicePixelRatioF() : 1);
         scale *= this->scale;
         QSizeF size(img.width() * scale, img.height() * scale);
-        const QImage* img = &this->img;
+        painter.drawPixmap(QPointF(pos.x() - 0.5 * size.width(), pos.y() - size.height() + y_offset * scale), sprite);
+    }
+    // the image for kmh pre-scaled to its size on the device (scale: of the tree, ratio: device pixel ratio),
+    // once per scale (in 1/64 steps) and ratio: drawing it is a blit without resampling
+    const QPixmap& sprite(const qreal kmh, const qreal scale, const qreal ratio) const {
+        int image = -1; // img
         for (int i = 0; i < speedy_images.size(); i++) {
             if (kmh >= speedy_images[i].kmh)
-                img = &speedy_images[i].img;
+                image = i;
+        }
+        const qint64 key = (qint64(image + 1) << 48) | (qint64(qRound(ratio * 16)) << 32) | qRound(scale * 64);
+        auto it = sprites.find(key);
+        if (it == sprites.end()) {
+            // all speed images are drawn in the size of img
+            const QSize size = (QSizeF(img.size()) * (qRound(scale * 64) / 64. * this->scale * ratio)).toSize();
+            const QImage& src = image < 0 ? img : speedy_images[image].img;
+            QPixmap pixmap = QPixmap::fromImage(src.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+            pixmap.setDevicePixelRatio(ratio);
+            it = sprites.insert(key, pixmap);
         }
-        painter.drawImage(QRectF(pos.x() - 0.5 * size.width(), pos.y() - size.height() + y_offset * scale, size.width(), size.height()), *img);
+        return *it;
     }
+    // e.g. when the window moved to a screen with another device pixel ratio
+    void clear_sprites() const { sprites.clear(); }
     void add_speedy_image(QString path, const qreal kmh) {
         speedy_images.append(SpeedyImage{QImage(path), kmh});
     }
@@ -40,6 +65,7 @@ struct TreeType {
     QVector<SpeedyImage> speedy_images;
     qreal scale;
     qreal y_offset;
+    mutable QHash<qint64, QPixmap> sprites; // see sprite()
 };
 
 struct Tree {
@@ -57,6 +83,54 @@ struct Tree {
     qreal speed_scale = 1; // speed-multiplier
 };
 
+// TreeIndex holds the trees sorted by position, one layer per speed_scale: the trees with track_x in a range are
+// found with a binary search per layer, the cost per frame only depends on the visible trees
+class TreeIndex {
+public:
+    void clear() { layers.clear(); }
+    // sort() when all are added
+    void add(const Tree& tree) {
+        Q_ASSERT(tree.speed_scale > 0);
+        int i = 0;
+        while (i < layers.size() && layers[i].speed_scale != tree.speed_scale)
+            i++;
+        if (i == layers.size())
+            layers.append(Layer{ tree.speed_scale, QVector<Tree>() });
+        layers[i].trees.append(tree);
+    }
+    void sort() {
+        std::sort(layers.begin(), layers.end(), [](const Layer& a, const Layer& b) { return a.speed_scale < b.speed_scale; });
+        for (Layer& l : layers)
+            std::stable_sort(l.trees.begin(), l.trees.end(), [](const Tree& a, const Tree& b) { return a.pos < b.pos; });
+    }
+    int size() const {
+        int n = 0;
+        for (const Layer& l : layers)
+            n += l.trees.size();
+        return n;
+    }
+    // f(tree, track_x) for the trees with Tree::track_x(cur_x) in [from, to], by layer (slowest first) and position
+    template<typename F>
+    void for_each_visible(const qreal cur_x, const qreal from, const qreal to, F f) const {
+        for (const Layer& l : layers) {
+            // track_x = cur_x + (pos - cur_x) * speed_scale
+            const qreal pos_from = cur_x + (from - cur_x) / l.speed_scale;
+            const qreal pos_to = cur_x + (to - cur_x) / l.speed_scale;
+            auto it = std::lower_bound(l.trees.begin(), l.trees.end(), pos_from,
+                                       [](const Tree& t, const qreal pos) { return t.pos < pos; });
+            for ( ; it != l.trees.end() && it->pos <= pos_to; ++it)
+                f(*it, cur_x + (it->pos - cur_x) * l.speed_scale);
+        }
+    }
+
+protected:
+    struct Layer {
+        qreal speed_scale;
+        QVector<Tree> trees;
+    };
+    QVector<Layer> layers; // by speed_scale
+};
+
 struct Track {
     struct SignImage {
         bool load(const QString filename, const QString name, const qreal scale) {
@@ -121,11 +195,12 @@ struct Track {
         Sign() {}
         Sign(const Type type, const qreal at_length) : type(type), at_length(at_length) {}
         bool operator<(const Sign& s2) const { return at_length < s2.at_length; }
-        bool get_position(QRectF& pos, QRectF& pole_pos, QPainterPath& path) {
-            if (at_length > path.length())
+        // path: TrackSampler or TiledTrack
+        template<typename Path>
+        bool get_position(QRectF& pos, QRectF& pole_pos, const Path& path) {
+            if (path.empty() || at_length > path.length())
                 return false;
-            qreal const percent = path.percentAtLength(at_length);
-            const QPointF p = path.pointAtPercent(percent);
+            const QPointF p = path.point_at(at_length);
             QSizeF& size = (type == TrafficLight ? images.traffic_light_images[traffic_light_state]
                                                  : images.sign_images[type]).size;
             pos = QRectF(p.x() - size.width()/2, p.y() - size.height() - images.pole_size.height(),
@@ -133,16 +208,17 @@ struct Track {
             pole_pos = QRectF(p.x() - 0.5 * images.pole_size.width(), p.y() - images.pole_size.height(), images.pole_size.width(), images.pole_size.height());
             return true;
         }
-        bool draw(QPainter& painter, QPainterPath& path, bool editor = false) {
+        template<typename Path>
+        bool draw(QPainter& painter, const Path& path, bool editor = false) {
             if (!editor && (type == TurnLeft || type == TurnRight))
                 return false;
             QRectF pos, pole_pos;
             if (!get_position(pos, pole_pos, path))
                 return false;
-            images.pole_image.render(&painter, pole_pos);
+            images.raster.draw(painter, images.pole_image, pole_pos);
             Track::SignImage& img = type == TrafficLight ? images.traffic_light_images[traffic_light_state]
                                                  : images.sign_images[type];
-            img.is_svg ? img.svg->render(&painter, pos) : painter.drawImage(pos, *img.img);
+            img.is_svg ? images.raster.draw(painter, *img.svg, pos) : images.raster.draw(painter, *img.img, pos);
             if (editor && type == TrafficLight) {
                 // draw time range
                 QFont font("Eurostile", 12);
@@ -156,8 +232,7 @@ struct Track {
                 p.setY(p.y() - 1.1 * fm.height());
                 misc::draw_centered_text(painter, fm, s, p);
                 // draw trigger distance
-                qreal const percent = path.percentAtLength(at_length - traffic_light_info.trigger_distance);
-                p = path.pointAtPercent(percent);
+                p = path.point_at(at_length - traffic_light_info.trigger_distance);
                 painter.drawLine(p + QPointF(0, 5), p - QPointF(0, 10));
             }
             if (editor && is_turn_sign()) {
@@ -217,12 +292,14 @@ struct Track {
     int width = 1000;
     QVector<Sign> signs;
     int max_time = 0; // how much time the user has to finish the track
+    std::shared_ptr<const TrackFile> file; // the v2 file the track was loaded from, for its baked data
 
     struct Images {
         QVector<SignImage> sign_images;
         QSvgRenderer pole_image;
         QSize pole_size;
         SignImage traffic_light_images[Sign::__State_length];
+        SignRasterCache raster; // of all the images above (and the turn sign of QCarViz)
         void load_sign_images() {
             pole_image.load(QString("media/signs/pole.svg"));
             pole_size = pole_image.defaultSize() * 1;
@@ -245,9 +322,15 @@ struct Track {
     };
     static Images images;
 
-    inline bool save(const QString filename = "tracks/track.bin") const { return misc::saveObj(filename, *this); }
+    // .trk: v2 TrackFile, QDataStream otherwise
+    inline bool save(const QString filename = "tracks/track.bin") const {
+        return filename.endsWith(".trk") ? TrackFile::save(filename, *this) : misc::saveObj(filename, *this);
+    }
     inline bool saveJSON(const QString filename = "tracks/track.json") const { return misc::saveJson(filename, *this, false); }
-    inline bool load(const QString filename = "tracks/track.bin") { return misc::loadObj(filename, *this); }
+    inline bool loadJSON(const QString filename = "tracks/track.json") { return misc::loadJson(filename, *this); }
+    inline bool load(const QString filename = "tracks/track.bin") {
+        return TrackFile::is_track_file(filename) ? TrackFile::load(filename, *this) : misc::loadObj(filename, *this);
+    }
     void get_path(QPainterPath& path, const qreal height) const {
         if (!points.size())
             return;
@@ -280,6 +363,7 @@ struct Track {
     }
     void write(QJsonObject& j) const {
         j["width"] = width;
+        j["max_time"] = max_time;
         QJsonArray jpoints;
         for (auto i : points) {
             QJsonObject ji;
@@ -306,18 +390,52 @@ struct Track {
             if (i.type == Track::Sign::TrafficLight) {
                 Track::Sign::TrafficLightInfo& ti = i.traffic_light_info;
                 ji["time_range_from"] = ti.time_range.first;
-                ji["time_range_to"] = ti.time_range.first;
+                ji["time_range_to"] = ti.time_range.second;
                 ji["trigger_distance"] = ti.trigger_distance;
                 ji["trigger_distance_percent"] = path.percentAtLength(ti.trigger_distance);
             } else if (i.type >= Track::Sign::TurnLeft) {
                 Track::Sign::SteeringInfo& si = i.steering_info;
                 ji["intensity"] = si.intensity;
                 ji["duration"] = si.duration;
+                ji["fade_in"] = si.fade_in;
+                ji["fade_out"] = si.fade_out;
             }
             jsigns.append(ji);
         }
         j["signs"] = jsigns;
     }
+    // the json of write() (the derived "percent" and "point" values are not read)
+    void read(const QJsonObject& j) {
+        width = j["width"].toInt(width);
+        max_time = j["max_time"].toInt(0);
+        points.clear();
+        for (const QJsonValue& v : j["points"].toArray()) {
+            const QJsonObject ji = v.toObject();
+            points.append(QPointF(ji["x"].toDouble(), ji["y"].toDouble()));
+        }
+        num_points = (points.size() - 1) / 3;
+        signs.clear();
+        for (const QJsonValue& v : j["signs"].toArray()) {
+            const QJsonObject ji = v.toObject();
+            Sign s((Sign::Type) ji["type"].toInt(), ji["at_length"].toDouble());
+            if (s.type == Track::Sign::TrafficLight) {
+                Track::Sign::TrafficLightInfo& ti = s.traffic_light_info;
+                ti.time_range.first = ji["time_range_from"].toDouble(ti.time_range.first);
+                ti.time_range.second = ji["time_range_to"].toDouble(ti.time_range.first);
+                ti.trigger_distance = ji["trigger_distance"].toDouble(ti.trigger_distance);
+            } else if (s.type >= Track::Sign::TurnLeft) {
+                Track::Sign::SteeringInfo& si = s.steering_info;
+                si.intensity = ji["intensity"].toDouble(si.intensity);
+                si.duration = ji["duration"].toDouble(si.duration);
+                si.fade_in = ji["fade_in"].toDouble(si.fade_in);
+                si.fade_out = ji["fade_out"].toDouble(si.fade_out);
+                si.left = s.type == Track::Sign::TurnLeft;
+            }
+            signs.append(s);
+        }
+        file.reset();
+        prepare_track();
+    }
 };
 
 inline QDataStream &operator<<(QDataStream &out, const Track &track) {
@@ -327,6 +445,7 @@ inline QDataStream &operator<<(QDataStream &out, const Track &track) {
 
 inline QDataStream &operator>>(QDataStream &in, Track &track) {
     in >> track.points >> track.num_points >> track.width >> track.signs >> track.max_time;
+    track.file.reset();
     track.prepare_track();
     return in;
 }
@@ -0,0 +1,225 @@
+#include "track_file.h"
+#include "track.h"
+#include "tiled_track.h"
+#include "min_speed_profile.h"
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <climits>
+
+static_assert(sizeof(QPointF) == 2 * sizeof(qreal), "the points are mapped as QPointF");
+static_assert(sizeof(TrackFile::Header) == 24 && sizeof(TrackFile::Section) == 24, "file layout");
+static_assert(sizeof(TrackFile::SignRecord) == 72 && sizeof(TrackSampler::Sample) == 32, "file layout");
+
+namespace {
+
+struct SectionData {
+    TrackFile::SectionId id;
+    quint32 stride;
+    QByteArray bytes;
+};
+
+template<typename T>
+SectionData section_data(const TrackFile::SectionId id, const T* values, const int n)
+{
+    return { id, (quint32) sizeof(T), QByteArray(reinterpret_cast<const char*>(values), n * (int) sizeof(T)) };
+}
+
+inline quint64 aligned(const quint64 offset)
+{
+    return (offset + TrackFile::ALIGNMENT - 1) / TrackFile::ALIGNMENT * TrackFile::ALIGNMENT;
+}
+
+// the element size of a known section (0 for sections of newer writers, they are skipped)
+quint32 stride_of(const quint32 id)
+{
+    switch (id) {
+        case TrackFile::InfoSection: return sizeof(TrackFile::Info);
+        case TrackFile::PointsSection: return sizeof(QPointF);
+        case TrackFile::SignsSection: return sizeof(TrackFile::SignRecord);
+        case TrackFile::SegmentStartSection: return sizeof(qreal);
+        case TrackFile::SamplesSection: return sizeof(TrackSampler::Sample);
+        case TrackFile::MinSpeedKeySection: return sizeof(char);
+        case TrackFile::MinSpeedSection: return sizeof(qreal);
+    }
+    return 0;
+}
+
+} // namespace
+
+bool TrackFile::open(const QString& filename)
+{
+    auto fail = [this]() {
+        if (data)
+            file.unmap(const_cast<uchar*>(data));
+        file.close();
+        data = nullptr;
+        size = 0;
+        return false;
+    };
+    file.setFileName(filename);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < (qint64) sizeof(Header))
+        return fail();
+    size = file.size();
+    data = file.map(0, size);
+    if (!data)
+        return fail();
+
+    const Header& header = *reinterpret_cast<const Header*>(data);
+    if (header.magic != MAGIC || header.version != VERSION || header.header_size != sizeof(Header)
+            || header.file_size != (quint64) size
+            || sizeof(Header) + (quint64) header.section_count * sizeof(Section) > (quint64) size)
+        return fail();
+    const Section* sections = reinterpret_cast<const Section*>(data + sizeof(Header));
+    for (quint32 i = 0; i < header.section_count; i++) {
+        const Section& s = sections[i];
+        // count * stride may overflow: compare with the elements that fit
+        if (s.offset % ALIGNMENT || s.offset > (quint64) size || s.stride == 0
+                || s.count > ((quint64) size - s.offset) / s.stride || s.count > (quint64) INT_MAX)
+            return fail();
+        const quint32 stride = stride_of(s.id);
+        if (stride && s.stride != stride)
+            return fail();
+    }
+    if (count(InfoSection) != 1 || !array<Info>(InfoSection) || !signs())
+        return fail();
+    for (int i = 0; i < count(SignsSection); i++) {
+        if (signs()[i].type < 0 || signs()[i].type >= Track::Sign::__length)
+            return fail();
+    }
+    const int num_points = info().num_points;
+    if (num_points < 1 || count(PointsSection) != 3 * num_points + 1 || !points()
+            || count(SegmentStartSection) != num_points + 1 || !segment_start())
+        return fail();
+    return true;
+}
+
+const TrackFile::Section* TrackFile::section(const SectionId id) const
+{
+    if (!data)
+        return nullptr;
+    const Header& header = *reinterpret_cast<const Header*>(data);
+    const Section* sections = reinterpret_cast<const Section*>(data + sizeof(Header));
+    for (quint32 i = 0; i < header.section_count; i++) {
+        if (sections[i].id == (quint32) id)
+            return &sections[i];
+    }
+    return nullptr;
+}
+
+bool TrackFile::is_track_file(const QString& filename)
+{
+    QFile file(filename);
+    quint32 magic = 0;
+    return file.open(QIODevice::ReadOnly)
+            && file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) == sizeof(magic) && magic == MAGIC;
+}
+
+bool TrackFile::load(const QString& filename, Track& track)
+{
+    std::shared_ptr<TrackFile> track_file = std::make_shared<TrackFile>();
+    if (!track_file->open(filename))
+        return false;
+    track_file->read(track);
+    track.file = track_file;
+    return true;
+}
+
+void TrackFile::read(Track& track) const
+{
+    const Info& i = info();
+    track.num_points = i.num_points;
+    track.width = i.width;
+    track.max_time = i.max_time;
+    track.points.resize(count(PointsSection));
+    std::copy(points(), points() + track.points.size(), track.points.begin());
+    track.signs.resize(count(SignsSection));
+    for (int k = 0; k < track.signs.size(); k++) {
+        const SignRecord& r = signs()[k];
+        Track::Sign& s = track.signs[k];
+        s.type = (Track::Sign::Type) r.type;
+        s.at_length = r.at_length;
+        s.traffic_light_info.trigger_distance = r.trigger_distance;
+        s.traffic_light_info.time_range = { r.time_from, r.time_to };
+        s.steering_info.left = r.left;
+        s.steering_info.intensity = r.intensity;
+        s.steering_info.duration = r.duration;
+        s.steering_info.fade_in = r.fade_in;
+        s.steering_info.fade_out = r.fade_out;
+    }
+}
+
+bool TrackFile::matches(const Track& track) const
+{
+    return data && track.num_points == info().num_points && track.points.size() == count(PointsSection)
+            && std::equal(track.points.begin(), track.points.end(), points());
+}
+
+bool TrackFile::save(const QString& filename, const Track& track)
+{
+    if (track.num_points < 1 || track.points.size() != 3 * track.num_points + 1)
+        return false;
+    Track prepared = track;
+    prepared.file.reset(); // everything is computed again
+    prepared.prepare_track();
+
+    // the path as SimulationCore lays it out, for height 0
+    TiledTrack tiles;
+    tiles.set_track(prepared, 0);
+    QPainterPath path;
+    prepared.get_path(path, 0);
+    TrackSampler sampler;
+    sampler.sample(path);
+    MinSpeedProfile profile;
+    profile.update(prepared, tiles.length());
+
+    Info info = {};
+    info.num_points = prepared.num_points;
+    info.width = prepared.width;
+    info.max_time = prepared.max_time;
+    info.path_length = sampler.length();
+    info.min_speed_mult = profile.track_mult;
+    const QRectF bounds = tiles.bounding_rect();
+    info.bounds[0] = bounds.x();
+    info.bounds[1] = bounds.y();
+    info.bounds[2] = bounds.width();
+    info.bounds[3] = bounds.height();
+
+    QVector<SignRecord> signs;
+    for (const Track::Sign& s : prepared.signs) {
+        const Track::Sign::SteeringInfo& si = s.steering_info;
+        const Track::Sign::TrafficLightInfo& ti = s.traffic_light_info;
+        signs.append({ (qint32) s.type, si.left, s.at_length, ti.trigger_distance, ti.time_range.first,
+                       ti.time_range.second, si.intensity, si.duration, si.fade_in, si.fade_out });
+    }
+    const QByteArray key = profile.get_key();
+
+    QVector<SectionData> sections;
+    sections.append(section_data(InfoSection, &info, 1));
+    sections.append(section_data(PointsSection, prepared.points.constData(), prepared.points.size()));
+    sections.append(section_data(SignsSection, signs.constData(), signs.size()));
+    sections.append(section_data(SegmentStartSection, tiles.get_segment_start().constData(), tiles.get_segment_start().size()));
+    sections.append(section_data(SamplesSection, sampler.get_samples(), sampler.size()));
+    sections.append(section_data(MinSpeedKeySection, key.constData(), key.size()));
+    sections.append(section_data(MinSpeedSection, profile.get_values(), profile.size()));
+
+    Header header = { MAGIC, VERSION, sizeof(Header), (quint32) sections.size(), 0 };
+    QVector<Section> table;
+    quint64 offset = sizeof(Header) + sections.size() * sizeof(Section);
+    for (const SectionData& s : sections) {
+        offset = aligned(offset);
+        table.append({ (quint32) s.id, s.stride, offset, s.bytes.size() / s.stride });
+        offset += s.bytes.size();
+    }
+    header.file_size = offset;
+
+    QByteArray bytes(offset, 0);
+    memcpy(bytes.data(), &header, sizeof(Header));
+    memcpy(bytes.data() + sizeof(Header), table.constData(), table.size() * sizeof(Section));
+    for (int i = 0; i < sections.size(); i++)
+        memcpy(bytes.data() + table[i].offset, sections[i].bytes.constData(), sections[i].bytes.size());
+
+    QDir().mkpath(QFileInfo(filename).absolutePath());
+    QSaveFile out(filename);
+    return out.open(QIODevice::WriteOnly) && out.write(bytes) == bytes.size() && out.commit();
+}
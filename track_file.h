@@ -0,0 +1,110 @@
+#ifndef TRACK_FILE_H
+#define TRACK_FILE_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QPointF>
+#include <memory>
+#include "track_sampler.h"
+
+struct Track;
+
+// TrackFile is the track format v2 (.trk): a header, a section table and 64 byte aligned arrays that are mapped
+// (QFile::map) and used in place, no parsing and no prepare_track on load:
+//   Info          one TrackFile::Info
+//   Points        control points (editor coordinates), 3 * num_points + 1
+//   Signs         TrackFile::SignRecord, prepared (sorted, trigger distances checked)
+//   SegmentStart  path length at the start of every bezier segment (+ the total length), num_points + 1
+//   Samples       TrackSampler::Sample of the path laid out for height 0
+//   MinSpeedKey   the key (hash) of the MinSpeedProfile of the track
+//   MinSpeed      the values of the MinSpeedProfile
+// the byte order is the one of the machine that wrote it (the magic doesn't match on the others).
+// the .bin (QDataStream) and the json of Track::saveJSON are converted with tools/convert_track
+class TrackFile
+{
+public:
+    static const quint32 MAGIC = 0x4b545345; // "ESTK"
+    static const quint32 VERSION = 2;
+    static const int ALIGNMENT = 64;
+
+    enum SectionId {
+        InfoSection = 1,
+        PointsSection,
+        SignsSection,
+        SegmentStartSection,
+        SamplesSection,
+        MinSpeedKeySection,
+        MinSpeedSection
+    };
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        quint32 header_size; // sizeof(Header)
+        quint32 section_count; // the section table follows the header
+        quint64 file_size;
+    };
+    struct Section {
+        quint32 id; // SectionId
+        quint32 stride; // size of an element
+        quint64 offset; // from the start of the file, aligned
+        quint64 count; // elements
+    };
+    struct Info {
+        qint32 num_points;
+        qint32 width;
+        qint32 max_time;
+        qint32 reserved;
+        qreal path_length; // length of the sampled path (TrackSampler::length())
+        qreal min_speed_mult; // MinSpeedProfile::track_mult
+        qreal bounds[4]; // x, y, width, height of the path for height 0
+    };
+    struct SignRecord {
+        qint32 type;
+        qint32 left;
+        qreal at_length;
+        qreal trigger_distance;
+        qreal time_from, time_to; // [ms]
+        qreal intensity, duration, fade_in, fade_out;
+    };
+
+    // maps filename, false if it is no valid v2 track file (of this machine)
+    bool open(const QString& filename);
+    // true if filename starts with the magic of a v2 file
+    static bool is_track_file(const QString& filename);
+    // reads the track from filename, track.file keeps the file mapped for its baked data
+    static bool load(const QString& filename, Track& track);
+    // writes track with the baked data (path, samples and profile are computed here)
+    static bool save(const QString& filename, const Track& track);
+
+    // the track in the file (without prepare_track: it was prepared when written)
+    void read(Track& track) const;
+    // true if the baked data belongs to track (same control points), the track may have been edited since
+    bool matches(const Track& track) const;
+
+    const Info& info() const { return *array<Info>(InfoSection); }
+    const QPointF* points() const { return array<QPointF>(PointsSection); }
+    const SignRecord* signs() const { return array<SignRecord>(SignsSection); }
+    const qreal* segment_start() const { return array<qreal>(SegmentStartSection); }
+    const TrackSampler::Sample* samples() const { return array<TrackSampler::Sample>(SamplesSection); }
+    QByteArray min_speed_key() const {
+        return QByteArray::fromRawData(array<char>(MinSpeedKeySection), count(MinSpeedKeySection));
+    }
+    const qreal* min_speed() const { return array<qreal>(MinSpeedSection); }
+    // of the section (0 if it doesn't exist)
+    int count(const SectionId id) const { const Section* s = section(id); return s ? (int) s->count : 0; }
+
+protected:
+    const Section* section(const SectionId id) const;
+    template<typename T>
+    const T* array(const SectionId id) const {
+        const Section* s = section(id);
+        return s && s->stride == sizeof(T) ? reinterpret_cast<const T*>(data + s->offset) : nullptr;
+    }
+
+    QFile file;
+    const uchar* data = nullptr;
+    qint64 size = 0;
+};
+
+#endif // TRACK_FILE_H
@@ -0,0 +1,108 @@
+#include "track_generator.h"
+#include "simulation_core.h"
+#include <boost/algorithm/clamp.hpp>
+
+void TrackGenerator::generate(Track& track)
+{
+    generate_points(track);
+    QPainterPath path;
+    track.get_path(path, 0);
+    generate_signs(track, path.length());
+    track.max_time = settings.max_time_kmh > 0
+            ? (int) ceil(path.length() / SimulationCore::PATH_UNITS_PER_METER / Gearbox::kmh2speed(settings.max_time_kmh)) : 0;
+}
+
+void TrackGenerator::generate_points(Track& track)
+{
+    const qreal dx = settings.segment_length * SimulationCore::PATH_UNITS_PER_METER;
+    const int n = std::max(1, (int) ceil(settings.length / settings.segment_length));
+    const qreal low = settings.base_height - settings.height_range;
+    const qreal high = settings.base_height + settings.height_range;
+    std::normal_distribution<qreal> normal(0, settings.grade_change);
+
+    // heights of the end points: a random walk of the grade, flat at the start
+    QVector<qreal> y(n + 1);
+    y[0] = settings.base_height;
+    qreal grade = 0;
+    for (int k = 1; k <= n; k++) {
+        if (k > 1)
+            grade = boost::algorithm::clamp(grade + normal(rng), -settings.max_grade, settings.max_grade);
+        if (y[k-1] + grade * dx > high || y[k-1] + grade * dx < low)
+            grade = -grade; // turn back at the edges of the height range
+        y[k] = boost::algorithm::clamp(y[k-1] + grade * dx, low, high);
+    }
+
+    // control points on a third of the segment along the slope at the end points (catmull-rom): smooth joins
+    track.points.resize(3 * n + 1);
+    auto slope = [&](const int k) {
+        return (y[std::min(k + 1, n)] - y[std::max(k - 1, 0)]) / (dx * (std::min(k + 1, n) - std::max(k - 1, 0)));
+    };
+    qreal m = slope(0);
+    for (int k = 0; k < n; k++) {
+        const qreal x = k * dx;
+        const qreal m_next = slope(k + 1);
+        track.points[3*k] = QPointF(x, y[k]);
+        track.points[3*k+1] = QPointF(x + dx / 3, y[k] + m * dx / 3);
+        track.points[3*k+2] = QPointF(x + 2 * dx / 3, y[k+1] - m_next * dx / 3);
+        m = m_next;
+    }
+    track.points[3*n] = QPointF(n * dx, y[n]);
+    track.num_points = n;
+    track.width = (int) ceil(n * dx);
+}
+
+void TrackGenerator::generate_signs(Track& track, const qreal length)
+{
+    typedef Track::Sign Sign;
+    const qreal units = SimulationCore::PATH_UNITS_PER_METER;
+    const qreal start = SimulationCore::initial_pos + 30 * units;
+    const qreal end = length - settings.min_sign_distance * units;
+    track.signs.clear();
+
+    // speed limit zones: the limit wanders between 30 and 130 km/h
+    int limit = 50;
+    for (qreal at = start; at < end; at += uniform(settings.min_zone, settings.max_zone) * units) {
+        track.signs.push_back(Sign((Sign::Type) (Sign::Speed30 + (limit - 30) / 10), at));
+        const int change = std::uniform_int_distribution<int>(1, 3)(rng) * 10;
+        limit += (limit - change < 30 || (limit + change <= 130 && rng() % 2)) ? change : -change;
+    }
+
+    for (qreal at = start + next_distance(settings.stop_sign_distance * units); at >= start && at < end;
+         at += next_distance(settings.stop_sign_distance * units))
+        track.signs.push_back(Sign(Sign::Stop, at));
+
+    // at least 100 m apart, so that the trigger distances don't reach back to the previous light
+    for (qreal at = start + next_distance(settings.traffic_light_distance * units); at >= start && at < end;
+         at += std::max(next_distance(settings.traffic_light_distance * units), 100 * units)) {
+        Sign s(Sign::TrafficLight, at);
+        std::pair<qreal,qreal>& time_range = s.traffic_light_info.time_range;
+        time_range.first = 100 * round(uniform(30, 80)); // [ms]
+        time_range.second = time_range.first + 100 * round(uniform(0, 30));
+        track.signs.push_back(s);
+    }
+
+    for (qreal at = start + next_distance(settings.turn_sign_distance * units); at >= start && at < end;
+         at += next_distance(settings.turn_sign_distance * units)) {
+        Sign s(rng() % 2 ? Sign::TurnLeft : Sign::TurnRight, at);
+        Sign::SteeringInfo& info = s.steering_info;
+        info.intensity = uniform(0.3, 0.8);
+        info.duration = uniform(0.5, 1.5);
+        info.fade_in = uniform(0.2, 0.4);
+        info.fade_out = uniform(0.2, 0.4);
+        info.left = s.type == Sign::TurnLeft;
+        track.signs.push_back(s);
+    }
+
+    // keep the signs apart (moving them forward), then the trigger distances of the traffic lights
+    track.sort_signs();
+    QVector<Sign> signs;
+    signs.reserve(track.signs.size());
+    for (Sign& s : track.signs) {
+        if (!signs.isEmpty())
+            s.at_length = std::max(s.at_length, signs.last().at_length + settings.min_sign_distance * units);
+        if (s.at_length < end)
+            signs.push_back(s);
+    }
+    track.signs.swap(signs);
+    track.prepare_track();
+}
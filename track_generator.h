@@ -0,0 +1,47 @@
+#ifndef TRACK_GENERATOR_H
+#define TRACK_GENERATOR_H
+
+#include <random>
+#include "track.h"
+
+// what a generated track looks like. distances in meters (the track is laid out in track_path units)
+struct TrackGeneratorSettings {
+    qreal length = 10000; // [m]
+    qreal segment_length = 100; // [m] between the end points of the bezier segments
+    qreal base_height = 120; // [track units] the elevation wanders around it
+    qreal height_range = 60; // [track units] max deviation from base_height
+    qreal max_grade = 0.06; // max slope of a segment (dy/dx)
+    qreal grade_change = 0.02; // standard deviation of the grade change per segment
+    qreal min_zone = 300, max_zone = 2000; // [m] length of a speed limit zone
+    qreal stop_sign_distance = 3000; // [m] mean distance between stop signs (0: none)
+    qreal traffic_light_distance = 2000; // [m] mean distance between traffic lights (0: none)
+    qreal turn_sign_distance = 1000; // [m] mean distance between turn signs (0: none)
+    qreal min_sign_distance = 20; // [m] between any two signs
+    qreal max_time_kmh = 0; // the time limit is the time at this average speed (0: no limit)
+};
+
+// TrackGenerator creates tracks of any length from a seed: a smooth random elevation profile (cubic beziers
+// with continuous slopes, as the QTrackEditor makes them) with speed limit zones, stop signs, traffic lights
+// (trigger distances as check_traffic_light_distance wants them) and turn signs. the same seed gives the same track
+class TrackGenerator
+{
+public:
+    TrackGenerator(const TrackGeneratorSettings& settings = TrackGeneratorSettings(), const unsigned seed = 0)
+        : settings(settings), rng(seed) {}
+
+    // replaces points and signs of track
+    void generate(Track& track);
+
+    TrackGeneratorSettings settings;
+
+protected:
+    void generate_points(Track& track);
+    void generate_signs(Track& track, const qreal length);
+    qreal uniform(const qreal a, const qreal b) { return std::uniform_real_distribution<qreal>(a, b)(rng); }
+    // distance to the next event with the given mean (exponentially distributed)
+    qreal next_distance(const qreal mean) { return mean > 0 ? std::exponential_distribution<qreal>(1 / mean)(rng) : -1; }
+
+    std::mt19937_64 rng;
+};
+
+#endif // TRACK_GENERATOR_H
@@ -0,0 +1,114 @@
+#include "track_sampler.h"
+#include <QLineF>
+
+namespace {
+
+// a cubic bezier (lines are stored as beziers with the control points at 1/3 and 2/3)
+struct Segment {
+    QPointF p0, p1, p2, p3;
+    qreal length; // as QPainterPath::length() counts it
+
+    QPointF point(qreal const t) const {
+        const qreal u = 1 - t;
+        return u*u*u * p0 + 3*u*u*t * p1 + 3*u*t*t * p2 + t*t*t * p3;
+    }
+    QPointF derivative(qreal const t) const {
+        const qreal u = 1 - t;
+        return 3*u*u * (p1 - p0) + 6*u*t * (p2 - p1) + 3*t*t * (p3 - p2);
+    }
+};
+
+} // namespace
+
+void TrackSampler::sample(const QPainterPath& path, const qreal max_step)
+{
+    clear();
+    QVector<Segment> segments;
+    QPointF current;
+    for (int i = 0; i < path.elementCount(); i++) {
+        const QPainterPath::Element& e = path.elementAt(i);
+        if (e.type == QPainterPath::LineToElement) {
+            const QPointF p = e;
+            segments.append({ current, current + (p - current) / 3, current + (p - current) * 2 / 3, p, QLineF(current, p).length() });
+        } else if (e.type == QPainterPath::CurveToElement) {
+            Q_ASSERT(i + 2 < path.elementCount());
+            const QPointF p1 = path.elementAt(i), p2 = path.elementAt(i+1), p3 = path.elementAt(i+2);
+            QPainterPath bezier(current);
+            bezier.cubicTo(p1, p2, p3);
+            segments.append({ current, p1, p2, p3, bezier.length() });
+            i += 2;
+        }
+        current = path.elementAt(i);
+    }
+    length_ = path.length();
+    if (segments.isEmpty() || length_ <= 0)
+        return;
+
+    const int n = std::max(2, (int) ceil(length_ / max_step) + 1);
+    const qreal step = length_ / (n - 1);
+    inv_step = 1 / step;
+    samples.resize(n);
+
+    // per segment: the lengths at K+1 uniform parameters t (sum of chords, scaled to the segment length)
+    QVector<qreal> table;
+    int K = 0;
+    auto prepare = [&](const Segment& s) {
+        K = std::min(std::max((int) ceil(s.length / step * 4), 16), 1 << 16);
+        table.resize(K + 1);
+        table[0] = 0;
+        QPointF prev = s.p0;
+        for (int j = 1; j <= K; j++) {
+            const QPointF p = s.point(qreal(j) / K);
+            table[j] = table[j-1] + QLineF(prev, p).length();
+            prev = p;
+        }
+        if (table[K] > 0)
+            for (int j = 1; j <= K; j++)
+                table[j] *= s.length / table[K];
+    };
+
+    int si = 0;
+    qreal s0 = 0; // length at the start of segment si
+    int j = 0; // table index
+    prepare(segments[0]);
+    for (int i = 0; i < n; i++) {
+        const qreal l = i == n - 1 ? length_ : i * step;
+        while (si + 1 < segments.size() && (l > s0 + segments[si].length || segments[si].length <= 0)) {
+            s0 += segments[si].length;
+            si++;
+            prepare(segments[si]);
+            j = 0;
+        }
+        const Segment& s = segments[si];
+        const qreal local = std::min(std::max(l - s0, 0.), s.length);
+        while (j + 1 < K && table[j+1] < local)
+            j++;
+        const qreal dl = table[j+1] - table[j];
+        const qreal t = s.length > 0 ? (j + (dl > 0 ? (local - table[j]) / dl : 0)) / K : 0;
+
+        Sample& sample = samples[i];
+        const QPointF p = s.point(t);
+        sample.x = p.x();
+        sample.y = p.y();
+        QPointF d = s.derivative(t);
+        if (QPointF::dotProduct(d, d) < 1e-18) // control point on the end point: direction of the secant
+            d = s.point(std::min(t + 1e-4, 1.)) - s.point(std::max(t - 1e-4, 0.));
+        const qreal norm = sqrt(QPointF::dotProduct(d, d));
+        sample.tx = norm > 0 ? d.x() / norm : 1;
+        sample.ty = norm > 0 ? d.y() / norm : 0;
+    }
+    data = samples.constData();
+    count = samples.size();
+}
+
+void TrackSampler::map(const Sample* mapped, const int n, const qreal length, const qreal y_offset)
+{
+    clear();
+    if (n < 2 || length <= 0)
+        return;
+    data = mapped;
+    count = n;
+    length_ = length;
+    inv_step = (n - 1) / length;
+    this->y_offset = y_offset;
+}
@@ -0,0 +1,83 @@
+#ifndef TRACK_SAMPLER_H
+#define TRACK_SAMPLER_H
+
+#include <QPainterPath>
+#include <QPointF>
+#include <QVector>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+// TrackSampler is an arc-length table of a QPainterPath: point and tangent, sampled every <= max_step units
+// of length once (sample()). The lookups by length are O(1) (index + linear interpolation) and replace
+// QPainterPath::percentAtLength / pointAtPercent / slopeAtPercent / angleAtPercent, which walk all the
+// bezier segments on every call.
+class TrackSampler
+{
+public:
+    // samples the path (lines & cubic beziers), length() is the one of QPainterPath::length()
+    void sample(const QPainterPath& path, const qreal max_step = 1);
+    void clear() { samples.clear(); data = nullptr; count = 0; length_ = 0; y_offset = 0; }
+
+    struct Sample {
+        qreal x, y; // point
+        qreal tx, ty; // unit tangent
+    };
+    // uses n samples (evenly spaced over length) of memory it doesn't own, e.g. a mapped TrackFile, in place.
+    // the points are moved down by y_offset (the samples of a track are stored for height 0)
+    void map(const Sample* mapped, const int n, const qreal length, const qreal y_offset = 0);
+    const Sample* get_samples() const { return data; }
+    int size() const { return count; }
+
+    bool empty() const { return count < 2; }
+    qreal length() const { return length_; }
+
+    // all at length l [path units], clamped to the path:
+    // same as pointAtPercent(percentAtLength(l))
+    QPointF point_at(qreal const l) const {
+        Lookup k = lookup(l);
+        return QPointF(k.a.x + k.f * (k.b.x - k.a.x), y_offset + k.a.y + k.f * (k.b.y - k.a.y));
+    }
+    // same as slopeAtPercent(percentAtLength(l)) (dy/dx)
+    qreal slope_at(qreal const l) const {
+        qreal tx, ty;
+        tangent_at(l, tx, ty);
+        if (tx)
+            return ty / tx;
+        return ty < 0 ? -std::numeric_limits<qreal>::infinity() : std::numeric_limits<qreal>::infinity();
+    }
+    // same as angleAtPercent(percentAtLength(l)) [degrees], counterclockwise (0..360)
+    qreal angle_at(qreal const l) const {
+        qreal tx, ty;
+        tangent_at(l, tx, ty);
+        const qreal angle = atan2(-ty, tx) * 180 / M_PI;
+        return angle < 0 ? angle + 360 : angle;
+    }
+
+protected:
+    struct Lookup {
+        const Sample& a;
+        const Sample& b;
+        qreal f; // (0..1) between a and b
+    };
+    Lookup lookup(qreal const l) const {
+        Q_ASSERT(!empty());
+        qreal const g = std::min(std::max(l * inv_step, 0.), qreal(count - 1));
+        int const i = std::min(int(g), count - 2);
+        return { data[i], data[i+1], g - i };
+    }
+    void tangent_at(qreal const l, qreal& tx, qreal& ty) const {
+        Lookup k = lookup(l);
+        tx = k.a.tx + k.f * (k.b.tx - k.a.tx);
+        ty = k.a.ty + k.f * (k.b.ty - k.a.ty);
+    }
+
+    QVector<Sample> samples; // at i * step (if sampled)
+    const Sample* data = nullptr; // samples or mapped
+    int count = 0;
+    qreal length_ = 0;
+    qreal inv_step = 1;
+    qreal y_offset = 0;
+};
+
+#endif // TRACK_SAMPLER_H
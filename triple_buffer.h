@@ -0,0 +1,40 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// TripleBuffer hands values from one producer thread to one consumer thread without locks and without waiting:
+// the producer fills write_buffer() and publish()es it, the consumer read()s the latest published value.
+// three slots: the one being written, the one being read and the latest published one in between (swapped
+// atomically). the consumer skips values it didn't read in time, the producer never waits for the consumer.
+template<typename T>
+class TripleBuffer
+{
+public:
+    // producer: the slot to fill (not seen by the consumer until publish())
+    T& write_buffer() { return buffers[back]; }
+    // producer: makes the filled slot the latest one, continues on the previous latest one
+    void publish() {
+        back = middle.exchange(back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // consumer: the latest published value, it stays valid (and unchanged) until the next read()
+    const T& read() {
+        if (middle.load(std::memory_order_relaxed) & DIRTY)
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return buffers[front];
+    }
+    // consumer: true if something was published since the last read()
+    bool updated() const { return middle.load(std::memory_order_relaxed) & DIRTY; }
+
+protected:
+    static const int INDEX = 3;
+    static const int DIRTY = 4; // the middle slot was published and not read yet
+
+    T buffers[3];
+    std::atomic<int> middle{1}; // index of the latest published slot (| DIRTY)
+    int back = 0; // producer only
+    int front = 2; // consumer only
+};
+
+#endif // TRIPLE_BUFFER_H
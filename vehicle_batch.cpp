@@ -0,0 +1,397 @@
+#include "vehicle_batch.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+    #define VEHICLE_BATCH_SIMD
+#endif
+
+namespace {
+
+#ifdef VEHICLE_BATCH_SIMD
+static_assert(sizeof(qreal) == sizeof(double), "the SIMD kernels expect qreal to be double");
+
+// thin wrappers, so that the kernels read the same for AVX2 and SSE2
+#ifdef __AVX2__
+typedef __m256d vec;
+const int lanes = 4;
+inline vec load(const double* p) { return _mm256_loadu_pd(p); }
+inline void store(double* p, const vec v) { _mm256_storeu_pd(p, v); }
+inline vec set1(const double x) { return _mm256_set1_pd(x); }
+inline vec add(const vec a, const vec b) { return _mm256_add_pd(a, b); }
+inline vec sub(const vec a, const vec b) { return _mm256_sub_pd(a, b); }
+inline vec mul(const vec a, const vec b) { return _mm256_mul_pd(a, b); }
+inline vec div(const vec a, const vec b) { return _mm256_div_pd(a, b); }
+inline vec max(const vec a, const vec b) { return _mm256_max_pd(a, b); }
+inline vec min(const vec a, const vec b) { return _mm256_min_pd(a, b); }
+inline vec gt(const vec a, const vec b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+inline vec ge(const vec a, const vec b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+inline vec lt(const vec a, const vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+inline vec and_(const vec a, const vec b) { return _mm256_and_pd(a, b); }
+inline vec select(const vec mask, const vec a, const vec b) { return _mm256_blendv_pd(b, a, mask); } // mask ? a : b
+typedef __m128i ivec; // one int32 per lane
+inline ivec to_int(const vec v) { return _mm256_cvttpd_epi32(v); } // truncates
+inline vec to_vec(const ivec v) { return _mm256_cvtepi32_pd(v); }
+// the masked form with a zero source (the unmasked one makes gcc warn about its undefined source)
+inline vec gather(const double* base, const ivec i) {
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, i, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+#else
+typedef __m128d vec;
+const int lanes = 2;
+inline vec load(const double* p) { return _mm_loadu_pd(p); }
+inline void store(double* p, const vec v) { _mm_storeu_pd(p, v); }
+inline vec set1(const double x) { return _mm_set1_pd(x); }
+inline vec add(const vec a, const vec b) { return _mm_add_pd(a, b); }
+inline vec sub(const vec a, const vec b) { return _mm_sub_pd(a, b); }
+inline vec mul(const vec a, const vec b) { return _mm_mul_pd(a, b); }
+inline vec div(const vec a, const vec b) { return _mm_div_pd(a, b); }
+inline vec max(const vec a, const vec b) { return _mm_max_pd(a, b); }
+inline vec min(const vec a, const vec b) { return _mm_min_pd(a, b); }
+inline vec gt(const vec a, const vec b) { return _mm_cmpgt_pd(a, b); }
+inline vec ge(const vec a, const vec b) { return _mm_cmpge_pd(a, b); }
+inline vec lt(const vec a, const vec b) { return _mm_cmplt_pd(a, b); }
+inline vec and_(const vec a, const vec b) { return _mm_and_pd(a, b); }
+inline vec select(const vec mask, const vec a, const vec b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+typedef __m128i ivec; // one int32 per lane (in the lower half)
+inline ivec to_int(const vec v) { return _mm_cvttpd_epi32(v); } // truncates
+inline vec to_vec(const ivec v) { return _mm_cvtepi32_pd(v); }
+// SSE2 has no gather instruction: two scalar loads
+inline vec gather(const double* base, const ivec i) {
+    return _mm_set_pd(base[_mm_cvtsi128_si32(_mm_srli_si128(i, 4))], base[_mm_cvtsi128_si32(i)]);
+}
+#endif
+
+// Grid2D::get for all lanes (the same clamping and interpolation), the 4 corners of the cells are gathered
+inline vec lookup(const Grid2D& g, const vec x, const vec y) {
+    const vec zero = set1(0);
+    const vec gx = min(max(mul(sub(x, set1(g.min_x())), set1(g.scale_x())), zero), set1(g.size_x() - 1));
+    const vec gy = min(max(mul(sub(y, set1(g.min_y())), set1(g.scale_y())), zero), set1(g.size_y() - 1));
+    const vec ix = min(to_vec(to_int(gx)), set1(g.size_x() - 2)); // gx >= 0: truncation is floor
+    const vec iy = min(to_vec(to_int(gy)), set1(g.size_y() - 2));
+    const vec fx = sub(gx, ix);
+    const vec fy = sub(gy, iy);
+    const int nx = g.size_x();
+    const ivec i = to_int(add(mul(iy, set1(nx)), ix));
+    const double* const p = g.data();
+    const vec p00 = gather(p, i), p01 = gather(p + 1, i), p10 = gather(p + nx, i), p11 = gather(p + nx + 1, i);
+    const vec v0 = add(p00, mul(fx, sub(p01, p00)));
+    const vec v1 = add(p10, mul(fx, sub(p11, p10)));
+    return add(v0, mul(fy, sub(v1, v0)));
+}
+
+// sin and cos for |x| <= pi/2 (Taylor series up to x^17 and x^18 in Horner form, error < 1e-13)
+inline void sincos(const vec x, vec& s, vec& c) {
+    const vec x2 = mul(x, x), one = set1(1);
+    s = one;
+    for (int k = 8; k >= 1; k--)
+        s = sub(one, mul(mul(x2, set1(1. / ((2*k) * (2*k + 1)))), s));
+    s = mul(x, s);
+    c = one;
+    for (int k = 9; k >= 1; k--)
+        c = sub(one, mul(mul(x2, set1(1. / ((2*k - 1) * (2*k)))), c));
+}
+#else
+const int lanes = 1;
+#endif
+
+// Engine::update_torque and the clutch torque of Gearbox::torque2force_engine2wheels (the force itself is
+// calculated by the ForceKernel). the engine braking comes from a table (see VehicleBatch::braking_grid)
+struct TorqueKernel {
+    const qreal *angular_velocity, *throttle, *gear_t, *engage, *clutch_t, *clutch_w_t0, *clutch_a_w, *speed, *ratio;
+    qreal *torque, *torque_out, *counter;
+    const Grid2D &torque_grid, &braking_grid;
+    qreal speed2av, t_gear_change, t_shift, min_throttle, max_rpm, max_torque, inertia, dt;
+
+    inline void scalar(const int i) const {
+        const qreal rpm = Engine::angular_velocity2rpm(angular_velocity[i]);
+        qreal thr = gear_t[i] < t_gear_change ? 0 : throttle[i];
+        if (thr < min_throttle && rpm < 700)
+            thr = min_throttle;
+        torque[i] = max_torque * torque_grid.get(rpm / max_rpm, thr);
+        torque_out[i] = torque[i] - braking_grid.get(rpm, 0);
+        if (engage[i] > 0.5 && clutch_t[i] < t_shift) {
+            const qreal w_t = clutch_w_t0[i] + clutch_t[i] * clutch_a_w[i];
+            const qreal w_t_real = angular_velocity[i] - speed[i] * ratio[i] * speed2av;
+            counter[i] = torque_out[i] - inertia * (w_t - w_t_real) / dt;
+        } else
+            counter[i] = engage[i] > 0.5 ? torque_out[i] : 0;
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef VEHICLE_BATCH_SIMD
+        const vec zero = set1(0), v_half = set1(0.5), v_min_throttle = set1(min_throttle), v_700 = set1(700),
+                  v_av2rpm = set1(30 / M_PI), v_max_rpm = set1(max_rpm), v_max_torque = set1(max_torque),
+                  v_t_gear_change = set1(t_gear_change), v_t_shift = set1(t_shift), v_speed2av = set1(speed2av),
+                  v_inertia = set1(inertia), v_dt = set1(dt);
+        for ( ; i + lanes <= n; i += lanes) {
+            const vec av = load(angular_velocity + i);
+            const vec rpm = mul(av, v_av2rpm);
+            vec thr = select(lt(load(gear_t + i), v_t_gear_change), zero, load(throttle + i));
+            thr = select(and_(lt(thr, v_min_throttle), lt(rpm, v_700)), v_min_throttle, thr);
+            const vec t = mul(v_max_torque, lookup(torque_grid, div(rpm, v_max_rpm), thr));
+            const vec t_out = sub(t, lookup(braking_grid, rpm, zero));
+            const vec engaged = gt(load(engage + i), v_half);
+            const vec acting = and_(engaged, lt(load(clutch_t + i), v_t_shift));
+            const vec w_t = add(load(clutch_w_t0 + i), mul(load(clutch_t + i), load(clutch_a_w + i)));
+            const vec w_t_real = sub(av, mul(mul(load(speed + i), load(ratio + i)), v_speed2av));
+            const vec c_acting = sub(t_out, div(mul(v_inertia, sub(w_t, w_t_real)), v_dt));
+            store(torque + i, t);
+            store(torque_out + i, t_out);
+            store(counter + i, select(acting, c_acting, and_(engaged, t_out)));
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+// cos and sin of the slopes (alpha = 0.8 * atan(slope), see SimulationCore::alpha_at: |alpha| < pi/2)
+struct SlopeKernel {
+    const qreal* alpha;
+    qreal *cos_alpha, *sin_alpha;
+
+    inline void scalar(const int i) const {
+        cos_alpha[i] = cos(alpha[i]);
+        sin_alpha[i] = sin(alpha[i]);
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef VEHICLE_BATCH_SIMD
+        for ( ; i + lanes <= n; i += lanes) {
+            vec s, c;
+            sincos(load(alpha + i), s, c);
+            store(cos_alpha + i, c);
+            store(sin_alpha + i, s);
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+// wheel force minus all resisting forces [N] (Car::tick)
+struct ForceKernel {
+    const qreal *counter, *ratio, *speed, *cos_alpha, *sin_alpha, *braking;
+    qreal* force;
+    qreal inv_wheel_radius, drag, rolling_mg, mg, max_breaking_force;
+
+    inline void scalar(const int i) const {
+        const qreal resistance = drag * speed[i] * speed[i] + rolling_mg * cos_alpha[i] + mg * sin_alpha[i];
+        force[i] = counter[i] * ratio[i] * inv_wheel_radius - resistance - braking[i] * max_breaking_force;
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef VEHICLE_BATCH_SIMD
+        const vec v_inv_r = set1(inv_wheel_radius), v_drag = set1(drag), v_rolling = set1(rolling_mg),
+                  v_mg = set1(mg), v_brake = set1(max_breaking_force);
+        for ( ; i + lanes <= n; i += lanes) {
+            const vec s = load(speed + i);
+            const vec resistance = add(mul(v_drag, mul(s, s)), add(mul(v_rolling, load(cos_alpha + i)), mul(v_mg, load(sin_alpha + i))));
+            const vec f = mul(mul(load(counter + i), load(ratio + i)), v_inv_r);
+            store(force + i, sub(sub(f, resistance), mul(load(braking + i), v_brake)));
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+// acceleration (with mass factor) and explicit euler step of the speed (Car::tick)
+struct SpeedKernel {
+    const qreal *force, *mass_factor;
+    qreal *speed, *acceleration;
+    qreal mass, dt;
+
+    inline void scalar(const int i) const {
+        const qreal F = force[i];
+        const qreal a = F > 0 ? F / (mass * mass_factor[i]) : F * mass_factor[i] / mass;
+        acceleration[i] = a;
+        speed[i] = std::max(speed[i] + a * dt, 0.);
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef VEHICLE_BATCH_SIMD
+        const vec v_mass = set1(mass), v_dt = set1(dt), zero = set1(0);
+        for ( ; i + lanes <= n; i += lanes) {
+            const vec F = load(force + i);
+            const vec mf = load(mass_factor + i);
+            const vec a = select(gt(F, zero), div(F, mul(v_mass, mf)), div(mul(F, mf), v_mass));
+            store(acceleration + i, a);
+            store(speed + i, max(add(load(speed + i), mul(a, v_dt)), zero));
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+// engine speed: locked to the wheels if the clutch is fully engaged, free otherwise (Gearbox::update_engine_speed)
+struct EngineSpeedKernel {
+    const qreal *engage, *clutch_t, *speed, *ratio, *torque_out, *counter;
+    qreal* angular_velocity;
+    qreal speed2av, t_shift, inv_inertia, dt;
+
+    inline void scalar(const int i) const {
+        if (engage[i] > 0.5 && clutch_t[i] >= t_shift)
+            angular_velocity[i] = speed[i] * ratio[i] * speed2av;
+        else
+            angular_velocity[i] += (torque_out[i] - counter[i]) * inv_inertia * dt;
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef VEHICLE_BATCH_SIMD
+        const vec v_speed2av = set1(speed2av), v_t_shift = set1(t_shift), v_half = set1(0.5),
+                  v_inv_inertia_dt = set1(inv_inertia * dt);
+        for ( ; i + lanes <= n; i += lanes) {
+            const vec locked = and_(gt(load(engage + i), v_half), ge(load(clutch_t + i), v_t_shift));
+            const vec w_locked = mul(mul(load(speed + i), load(ratio + i)), v_speed2av);
+            const vec w_free = add(load(angular_velocity + i), mul(sub(load(torque_out + i), load(counter + i)), v_inv_inertia_dt));
+            store(angular_velocity + i, select(locked, w_locked, w_free));
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+// fuel consumption [L] (Engine::get_consumption_L_s, ConsumptionMonitor::tick)
+struct ConsumptionKernel {
+    const qreal *angular_velocity, *torque;
+    qreal* liters_used;
+    const Grid2D& consumption_grid;
+    qreal max_rpm, max_torque;
+    qreal factor; // base_consumption [g/kWh] -> [L/s] and * dt
+
+    inline void scalar(const int i) const {
+        const qreal rel_consumption = consumption_grid.get(Engine::angular_velocity2rpm(angular_velocity[i]) / max_rpm,
+                                                           torque[i] / max_torque);
+        liters_used[i] += factor * rel_consumption * angular_velocity[i] * torque[i];
+    }
+    void run(const int n) const {
+        int i = 0;
+#ifdef VEHICLE_BATCH_SIMD
+        const vec v_factor = set1(factor), v_av2rpm = set1(30 / M_PI), v_max_rpm = set1(max_rpm),
+                  v_max_torque = set1(max_torque);
+        for ( ; i + lanes <= n; i += lanes) {
+            const vec av = load(angular_velocity + i);
+            const vec t = load(torque + i);
+            const vec rel_consumption = lookup(consumption_grid, div(mul(av, v_av2rpm), v_max_rpm), div(t, v_max_torque));
+            const vec c = mul(mul(rel_consumption, av), t);
+            store(liters_used + i, add(load(liters_used + i), mul(v_factor, c)));
+        }
+#endif
+        for ( ; i < n; i++)
+            scalar(i);
+    }
+};
+
+} // namespace
+
+VehicleBatch::VehicleBatch(const Car& prototype, const int n)
+    : engine(prototype.engine)
+    , gears(prototype.gearbox.gears)
+    , mass_factors(prototype.gearbox.mass_factors)
+    , end_transmission(prototype.gearbox.end_transmission)
+    , rolling_circumference(prototype.gearbox.rolling_circumference)
+    , wheel_radius(prototype.gearbox.wheel_radius)
+    , t_gear_change(prototype.gearbox.t_gear_change)
+    , t_shift(prototype.gearbox.clutch.t_shift)
+    , mass(prototype.mass)
+    , max_breaking_force(prototype.max_breaking_force)
+    , drag_resistance_coefficient(prototype.drag_resistance_coefficient)
+    , rolling_resistance_coefficient(prototype.rolling_resistance_coefficient)
+{
+    // 5 rpm steps: the linear interpolation of pow(rpm / 60, 1.1) is off by < 1e-4 N*m above 60 rpm
+    const qreal braking_rpm_max = 2 * engine.max_rpm;
+    braking_grid.resize(int(braking_rpm_max / 5) + 1, 2, 0, braking_rpm_max, 0, 1);
+    braking_grid.bake([this](qreal rpm, qreal) { return engine.braking_torque(rpm); });
+    resize(n);
+}
+
+void VehicleBatch::resize(const int n)
+{
+    const int old_n = this->n;
+    this->n = n;
+    for (std::vector<qreal>* v : { &throttle, &braking, &alpha, &speed, &angular_velocity, &torque, &torque_out,
+                                   &torque_counter, &acceleration, &liters_used, &gear_t, &clutch_t, &clutch_w_t0,
+                                   &clutch_a_w, &clutch_engage, &ratio, &mass_factor, &cos_alpha, &sin_alpha,
+                                   &force })
+        v->resize(n, 0);
+    gear.resize(n, 0);
+    for (int i = old_n; i < n; i++) {
+        gear_t[i] = t_gear_change;
+        clutch_t[i] = t_shift;
+        angular_velocity[i] = Engine::rpm2angular_velocity(700); // Engine::reset()
+        update_gear_constants(i);
+    }
+}
+
+void VehicleBatch::reset()
+{
+    for (int i = 0; i < n; i++) {
+        angular_velocity[i] = Engine::rpm2angular_velocity(700);
+        clutch_engage[i] = 0;
+        gear[i] = 0;
+        speed[i] = 0;
+        throttle[i] = 0;
+        braking[i] = 0;
+        liters_used[i] = 0;
+        update_gear_constants(i);
+    }
+}
+
+void VehicleBatch::update_gear_constants(const int i)
+{
+    ratio[i] = gears[gear[i]] * end_transmission;
+    mass_factor[i] = mass_factors[gear[i]];
+}
+
+void VehicleBatch::set_gear(const int i, int gear)
+{
+    gear = std::min(std::max(gear, 0), gears.size() - 1);
+    if (this->gear[i] == gear)
+        return;
+    this->gear[i] = gear;
+    update_gear_constants(i);
+    if (t_gear_change > 0) {
+        clutch_engage[i] = 0;
+        if (!gear_change(i))
+            gear_t[i] = 0;
+    }
+}
+
+void VehicleBatch::tick(const qreal dt)
+{
+    if (dt <= 0)
+        return;
+    const qreal speed2av = 100. / rolling_circumference * 2 * M_PI; // [m/s] -> [rad/s] (without transmission)
+
+    // scalar part: the state machine of the auto clutch (Gearbox::auto_clutch_control, before Car::tick),
+    // it only switches once per gear change
+    for (int i = 0; i < n; i++) {
+        if (clutch_engage[i] < 0.5 && rpm(i) > 1000 && !gear_change(i)) {
+            clutch_t[i] = 0;
+            clutch_w_t0[i] = angular_velocity[i] - speed[i] * ratio[i] * speed2av;
+            clutch_a_w[i] = -clutch_w_t0[i] / t_shift;
+            clutch_engage[i] = 1;
+        }
+        // Gearbox::tick
+        gear_t[i] += dt;
+        clutch_t[i] += dt;
+    }
+
+    TorqueKernel{ angular_velocity.data(), throttle.data(), gear_t.data(), clutch_engage.data(), clutch_t.data(),
+                  clutch_w_t0.data(), clutch_a_w.data(), speed.data(), ratio.data(), torque.data(), torque_out.data(),
+                  torque_counter.data(), engine.torque_map.get_grid(), braking_grid, speed2av, t_gear_change, t_shift,
+                  engine.min_throttle, engine.max_rpm, engine.max_torque, engine.inertia, dt }.run(n);
+    SlopeKernel{ alpha.data(), cos_alpha.data(), sin_alpha.data() }.run(n);
+    ForceKernel{ torque_counter.data(), ratio.data(), speed.data(), cos_alpha.data(), sin_alpha.data(), braking.data(),
+                 force.data(), 1. / wheel_radius, drag_resistance_coefficient,
+                 rolling_resistance_coefficient * mass * GRAVITY, mass * GRAVITY, max_breaking_force }.run(n);
+    SpeedKernel{ force.data(), mass_factor.data(), speed.data(), acceleration.data(), mass, dt }.run(n);
+    EngineSpeedKernel{ clutch_engage.data(), clutch_t.data(), speed.data(), ratio.data(), torque_out.data(),
+                       torque_counter.data(), angular_velocity.data(), speed2av, t_shift, 1. / engine.inertia, dt }.run(n);
+    ConsumptionKernel{ angular_velocity.data(), torque.data(), liters_used.data(), engine.consumption_map.get_grid(),
+                       engine.max_rpm, engine.max_torque,
+                       dt * engine.base_consumption / 1000 / 1000 / 0.75 / (60*60) }.run(n);
+}
@@ -0,0 +1,84 @@
+#ifndef VEHICLE_BATCH_H
+#define VEHICLE_BATCH_H
+
+#include <vector>
+#include "car.h"
+
+// VehicleBatch steps N vehicles of the same configuration (engine, gearbox, mass, ..) at once.
+// The state is kept as structure of arrays, so that the resistance, torque and consumption math (including the
+// lookups in the torque & consumption maps) runs through SIMD kernels (AVX2 if compiled with CONFIG+=avx2, SSE2
+// otherwise). Only the auto clutch state machine is scalar.
+// One tick corresponds to SimulationCore::tick with a started track:
+// auto clutch control, Car::tick and ConsumptionMonitor::tick.
+class VehicleBatch
+{
+public:
+    // copies the configuration of the prototype
+    VehicleBatch(const Car& prototype, const int n = 0);
+
+    void resize(const int n);
+    int size() const { return n; }
+    // same as Car::reset(false) for all vehicles
+    void reset();
+
+    // same semantics as Gearbox::set_gear (a gear change disengages the clutch)
+    void set_gear(const int i, int gear);
+    void gear_up(const int i) { set_gear(i, gear[i] + 1); }
+    void gear_down(const int i) { set_gear(i, gear[i] - 1); }
+    bool gear_change(const int i) const { return gear_t[i] < t_gear_change; }
+
+    // dt [s], uses throttle, braking, gear and alpha of every vehicle
+    void tick(const qreal dt);
+
+    qreal rpm(const int i) const { return Engine::angular_velocity2rpm(angular_velocity[i]); }
+    qreal kmh(const int i) const { return Gearbox::speed2kmh(speed[i]); }
+
+    // input
+    std::vector<qreal> throttle; // (0..1)
+    std::vector<qreal> braking; // (0..1)
+    std::vector<qreal> alpha; // up/downhill [rad]
+    std::vector<int> gear;
+
+    // state
+    std::vector<qreal> speed; // [m/s]
+    std::vector<qreal> angular_velocity; // [rad/s]
+    std::vector<qreal> torque; // [N*m]
+    std::vector<qreal> torque_out; // [N*m]
+    std::vector<qreal> torque_counter; // [N*m]
+    std::vector<qreal> acceleration; // [m/s^2]
+    std::vector<qreal> liters_used; // [L]
+    std::vector<qreal> gear_t; // time since last gear change
+    std::vector<qreal> clutch_t; // time since beginning of clutch engagement
+    std::vector<qreal> clutch_w_t0;
+    std::vector<qreal> clutch_a_w;
+    std::vector<qreal> clutch_engage; // 0 or 1 (qreal, so that it can be used as a SIMD mask)
+
+protected:
+    void update_gear_constants(const int i);
+
+    // per vehicle constants depending on the current gear
+    std::vector<qreal> ratio; // gears[gear] * end_transmission
+    std::vector<qreal> mass_factor;
+
+    // scratch buffers of the kernels
+    std::vector<qreal> cos_alpha, sin_alpha, force;
+
+    int n = 0;
+
+    // configuration (copied from the prototype)
+    Engine engine; // only used for the torque & consumption maps
+    Grid2D braking_grid; // Engine::braking_torque over rpm (y: unused), gathered as the maps
+    QVector<qreal> gears;
+    QVector<qreal> mass_factors;
+    qreal end_transmission;
+    qreal rolling_circumference; // cm
+    qreal wheel_radius; // m
+    qreal t_gear_change;
+    qreal t_shift;
+    qreal mass;
+    qreal max_breaking_force;
+    qreal drag_resistance_coefficient;
+    qreal rolling_resistance_coefficient;
+};
+
+#endif // VEHICLE_BATCH_H
@@ -0,0 +1,35 @@
+#include "vehicle_spec.h"
+
+namespace {
+
+template<class Spec>
+std::unique_ptr<VehicleKernel> make(const Car& car, const char* name)
+{
+    if (!Spec::fits(car))
+        return nullptr;
+    return std::unique_ptr<VehicleKernel>(new SpecializedVehicle<Spec>(car, name));
+}
+
+struct Entry {
+    const char* name;
+    std::unique_ptr<VehicleKernel> (*make)(const Car& car, const char* name);
+};
+
+// the layouts of the cars we drive (default maps each): the default car has 5 gears
+const Entry entries[] = {
+    { "5 gears", make<VehicleSpec<5>> },
+    { "6 gears", make<VehicleSpec<6>> },
+    { "4 gears", make<VehicleSpec<4>> },
+};
+
+} // namespace
+
+std::unique_ptr<VehicleKernel> VehicleRegistry::create(const Car& car)
+{
+    for (const Entry& e : entries) {
+        std::unique_ptr<VehicleKernel> kernel = e.make(car, e.name);
+        if (kernel)
+            return kernel;
+    }
+    return nullptr;
+}
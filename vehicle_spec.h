@@ -0,0 +1,180 @@
+#ifndef VEHICLE_SPEC_H
+#define VEHICLE_SPEC_H
+
+#include <array>
+#include <memory>
+#include "car.h"
+
+// VehicleKernel advances the physics of a Car like Car::tick with the semi-implicit euler scheme (bit for bit),
+// with the configuration of the car copied into a compile time layout (see VehicleSpec, VehicleRegistry).
+// the state (speed, engine, gear, clutch) stays in the Car.
+class VehicleKernel
+{
+public:
+    virtual ~VehicleKernel() {}
+    // same as car.tick(dt, alpha, Integrator::SemiImplicitEuler)
+    virtual qreal tick(Car& car, qreal const dt, qreal const alpha) const = 0;
+    // same as engine.get_consumption_L_s()
+    virtual qreal consumption_L_s(const Engine& engine) const = 0;
+    // name of the specialization (for debugging)
+    virtual const char* name() const = 0;
+};
+
+// VehicleSpec is the layout of a vehicle known at compile time: the number of gears and the resolution of the maps.
+// the values (ratios, maps, masses, ..) are copied from a Car into fixed size arrays
+template<int N_GEARS, int TORQUE_N_RPM = 101, int TORQUE_N_THROTTLE = 41,
+         int CONSUMPTION_N_RPM = ConsumptionMap::GRID_N_RPM, int CONSUMPTION_N_TORQUE = ConsumptionMap::GRID_N_TORQUE>
+struct VehicleSpec
+{
+    static constexpr int n_gears = N_GEARS;
+
+    static bool fits(const Car& car) {
+        return car.gearbox.gears.size() == N_GEARS && car.gearbox.mass_factors.size() == N_GEARS
+                && decltype(torque_map)::fits(car.engine.torque_map.get_grid())
+                && decltype(consumption_map)::fits(car.engine.consumption_map.get_grid());
+    }
+
+    explicit VehicleSpec(const Car& car) {
+        Q_ASSERT(fits(car));
+        const Gearbox& g = car.gearbox;
+        std::copy(g.gears.constBegin(), g.gears.constEnd(), gears.begin());
+        std::copy(g.mass_factors.constBegin(), g.mass_factors.constEnd(), mass_factors.begin());
+        end_transmission = g.end_transmission;
+        rolling_circumference = g.rolling_circumference;
+        wheel_radius = g.wheel_radius;
+        const Engine& e = car.engine;
+        torque_map.assign(e.torque_map.get_grid());
+        consumption_map.assign(e.consumption_map.get_grid());
+        max_rpm = e.max_rpm;
+        max_torque = e.max_torque;
+        engine_braking_coefficient = e.engine_braking_coefficient;
+        engine_braking_offset = e.engine_braking_offset;
+        min_throttle = e.min_throttle;
+        inertia = e.inertia;
+        base_consumption = e.base_consumption;
+        mass = car.mass;
+        max_breaking_force = car.max_breaking_force;
+        drag_resistance_coefficient = car.drag_resistance_coefficient;
+        rolling_resistance_coefficient = car.rolling_resistance_coefficient;
+    }
+
+    // Gearbox::speed2engine_rpm
+    inline qreal speed2engine_rpm(qreal const speed, int const gear) const {
+        qreal rpm = speed * 100 / rolling_circumference; // [u/sek]
+        rpm *= (gears[gear] * end_transmission);
+        return rpm * 60; // [u/min]
+    }
+    // Engine::braking_torque
+    inline qreal braking_torque(qreal const rpm) const {
+        return engine_braking_coefficient * pow(std::max(rpm, 0.) / 60, 1.1) + engine_braking_offset;
+    }
+
+    // gearbox
+    std::array<qreal, N_GEARS> gears;
+    std::array<qreal, N_GEARS> mass_factors;
+    qreal end_transmission;
+    qreal rolling_circumference; // cm
+    qreal wheel_radius; // m
+    // engine
+    FixedGrid2D<TORQUE_N_RPM, TORQUE_N_THROTTLE> torque_map; // x=rpm, y=throttle
+    FixedGrid2D<CONSUMPTION_N_RPM, CONSUMPTION_N_TORQUE> consumption_map; // x=rpm, y=torque
+    qreal max_rpm;
+    qreal max_torque;
+    qreal engine_braking_coefficient;
+    qreal engine_braking_offset;
+    qreal min_throttle;
+    qreal inertia;
+    qreal base_consumption;
+    // car
+    qreal mass;
+    qreal max_breaking_force;
+    qreal drag_resistance_coefficient;
+    qreal rolling_resistance_coefficient;
+};
+
+// SpecializedVehicle: the tick of Car (gearbox, clutch, engine, resistances) inlined for one VehicleSpec.
+// the operations are the same as in Car, Gearbox and Engine (in the same order), so the result is identical
+template<class Spec>
+class SpecializedVehicle : public VehicleKernel
+{
+public:
+    explicit SpecializedVehicle(const Car& car, const char* name) : spec(car), name_(name) {}
+
+    const char* name() const override { return name_; }
+
+    qreal tick(Car& car, qreal const dt, qreal const alpha) const override {
+        if (dt <= 0)
+            return 0;
+        Engine& engine = car.engine;
+        Gearbox& gearbox = car.gearbox;
+        Clutch& clutch = gearbox.clutch;
+        const int gear = gearbox.get_gear();
+        Q_ASSERT(gear >= 0 && gear < Spec::n_gears);
+        gearbox.tick(dt);
+
+        // Engine::update_torque
+        qreal throttle = gearbox.gear_change() ? 0 : car.throttle;
+        if (throttle < spec.min_throttle && engine.rpm() < 700)
+            throttle = spec.min_throttle;
+        engine.torque = spec.max_torque * spec.torque_map.get(engine.rpm() / spec.max_rpm, throttle);
+        engine.torque_out = engine.torque - spec.braking_torque(engine.rpm());
+
+        // Gearbox::torque2force_engine2wheels
+        if (clutch.acting()) {
+            // Clutch::counter_torque
+            const qreal w_t = clutch.w_t0 + clutch.t * clutch.a_w;
+            const qreal rpm = spec.speed2engine_rpm(car.speed, gear);
+            const qreal w_t_real = engine.angular_velocity - Engine::rpm2angular_velocity(rpm);
+            const qreal a_w_e = (w_t - w_t_real) / dt;
+            engine.torque_counter = engine.torque_out - spec.inertia * a_w_e;
+        } else if (clutch.engage)
+            engine.torque_counter = engine.torque_out;
+        else
+            engine.torque_counter = 0;
+        qreal F = engine.torque_counter * spec.gears[gear] * spec.end_transmission / spec.wheel_radius;
+
+        // Car::net_force
+        const qreal drag_resistance = resistances::drag(spec.drag_resistance_coefficient, car.speed);
+        const qreal rolling_resistance = resistances::rolling(spec.rolling_resistance_coefficient, alpha, spec.mass);
+        const qreal uphill_resistance = resistances::uphill(spec.mass, alpha);
+        car.current_single_resistance = drag_resistance;
+        car.current_accumulated_resistance = drag_resistance + rolling_resistance + uphill_resistance;
+        F -= car.current_accumulated_resistance;
+        F -= car.braking * spec.max_breaking_force;
+
+        // Car::force2acceleration, Car::step_euler
+        const qreal mass_factor = spec.mass_factors[gear];
+        const qreal a = F > 0 ? F / (spec.mass * mass_factor) : F * mass_factor / spec.mass;
+        car.speed += a * dt;
+        if (car.speed < 0)
+            car.speed = 0;
+
+        // Gearbox::update_engine_speed
+        if (clutch.engage && !clutch.acting())
+            engine.set_rpm(spec.speed2engine_rpm(car.speed, gear));
+        else
+            engine.angular_velocity += (engine.torque_out - engine.torque_counter) / spec.inertia * dt;
+        car.current_acceleration = a;
+        return a;
+    }
+
+    // Engine::get_consumption_L_s
+    qreal consumption_L_s(const Engine& engine) const override {
+        const qreal power = engine.angular_velocity * engine.torque / 1000;
+        const qreal rel_consumption = spec.consumption_map.get(engine.angular_velocity * 60 / (2*M_PI) / spec.max_rpm, engine.torque / spec.max_torque);
+        return rel_consumption * spec.base_consumption * power / 1000 / 0.75 / (60*60);
+    }
+
+protected:
+    const Spec spec;
+    const char* const name_;
+};
+
+// VehicleRegistry knows the compiled specializations and picks the one that fits a Car
+struct VehicleRegistry
+{
+    // nullptr if none fits (then Car::tick has to be used)
+    static std::unique_ptr<VehicleKernel> create(const Car& car);
+};
+
+#endif // VEHICLE_SPEC_H
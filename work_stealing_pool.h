@@ -0,0 +1,150 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// WorkStealingPool runs tasks on a fixed number of threads.
+// every worker has its own queue: it takes its own tasks from the back (most recent, cache friendly)
+// and, when it runs dry, steals from the front of the others. tasks submitted from outside the pool
+// are spread round robin, tasks submitted by a worker go to its own queue.
+class WorkStealingPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    WorkStealingPool(int threads = 0) {
+        if (threads <= 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < threads; i++)
+            queues.emplace_back(new Queue);
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back(&WorkStealingPool::run, this, i);
+    }
+    ~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        work_available.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+    }
+
+    int size() const { return (int) workers.size(); }
+
+    void submit(Task task) {
+        const int w = worker_index() >= 0 && worker_pool() == this ? worker_index() : (int) (next_queue++ % queues.size());
+        pending++;
+        {
+            std::lock_guard<std::mutex> lock(queues[w]->mutex);
+            queues[w]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued++;
+        }
+        work_available.notify_one();
+    }
+
+    // blocks until all submitted tasks are done (must not be called from a worker)
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        all_done.wait(lock, [this] { return pending == 0; });
+    }
+
+    // runs f(i) for all i in [begin, end) in chunks on the pool and waits for them (must not be called from a worker)
+    template<class F>
+    void parallel_for(const int begin, const int end, F f, int chunk = 0) {
+        if (chunk <= 0)
+            chunk = std::max(1, (end - begin) / (4 * size()));
+        for (int i = begin; i < end; i += chunk) {
+            const int chunk_end = std::min(i + chunk, end);
+            submit([i, chunk_end, &f] {
+                for (int j = i; j < chunk_end; j++)
+                    f(j);
+            });
+        }
+        wait();
+    }
+
+    // index of the calling worker thread (0..size()-1), -1 outside of the pool
+    static int current_worker() { return worker_index(); }
+
+protected:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static int& worker_index() { static thread_local int index = -1; return index; }
+    static WorkStealingPool*& worker_pool() { static thread_local WorkStealingPool* pool = nullptr; return pool; }
+
+    bool pop(const int w, Task& task) {
+        {
+            Queue& own = *queues[w];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue& victim = *queues[(w + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(const int w) {
+        worker_index() = w;
+        worker_pool() = this;
+        for ( ; ; ) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [this] { return stop || queued > 0; });
+                if (stop && queued == 0)
+                    return;
+                queued--; // reserve one task (it is in one of the queues)
+            }
+            Task task;
+            while (!pop(w, task)) // the reserved task is in transit (submit pushes before counting)
+                std::this_thread::yield();
+            task();
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                all_done.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex; // guards queued & stop
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    int queued = 0; // tasks in the queues that no worker reserved yet
+    bool stop = false;
+    std::atomic<int> pending { 0 }; // submitted and not finished
+    std::atomic<unsigned> next_queue { 0 };
+
+public:
+    std::atomic<int> steals { 0 }; // statistics
+};
+
+#endif // WORK_STEALING_POOL_H